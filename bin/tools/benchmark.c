@@ -32,11 +32,12 @@ typedef struct {
     gboolean test_software;
     gboolean test_external;
     gboolean test_readout;
+    gint batch_size;
 
     gsize n_bytes;
 } Options;
 
-typedef guint (*GrabFrameFunc) (UcaCamera *, gpointer, guint, UcaCameraTriggerSource, GTimer *);
+typedef guint (*GrabFrameFunc) (UcaCamera *, gpointer *, guint, guint, UcaCameraTriggerSource, GTimer *);
 
 static UcaCamera *camera = NULL;
 
@@ -82,31 +83,36 @@ log_handler (const gchar *log_domain, GLogLevelFlags log_level, const gchar *mes
 }
 
 static guint
-grab_frames_sync (UcaCamera *camera, gpointer buffer, guint n_frames, UcaCameraTriggerSource trigger_source, GTimer *timer)
+grab_frames_sync (UcaCamera *camera, gpointer *frames, guint batch_size, guint n_frames, UcaCameraTriggerSource trigger_source, GTimer *timer)
 {
     GError *error = NULL;
     guint total;
+    guint n_batch;
+    guint n_done;
 
     g_object_set (camera, "trigger-source", trigger_source, NULL);
     uca_camera_start_recording (camera, &error);
     total = 0;
 
     g_timer_start (timer);
-    for (guint i = 0; i < n_frames; i++) {
-        if (trigger_source == UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE)
-            uca_camera_trigger (camera, &error);
+    for (guint i = 0; i < n_frames; i += n_batch) {
+        n_batch = MIN (batch_size, n_frames - i);
 
-        if (!uca_camera_grab (camera, buffer, &error))
+        if (trigger_source == UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE) {
+            for (guint j = 0; j < n_batch; j++)
+                uca_camera_trigger (camera, &error);
+        }
+
+        if (!uca_camera_grab_many (camera, frames, n_batch, &n_done, &error))
             g_warning ("Data stream ended");
 
+        total += n_done;
+
         if (error != NULL) {
-            g_warning ("Error grabbing frame %02i/%i: `%s'", i, n_frames, error->message);
+            g_warning ("Error grabbing frame %02i/%i: `%s'", i + n_done, n_frames, error->message);
             g_error_free (error);
             error = NULL;
         }
-        else {
-            total++;
-        }
     }
     g_timer_stop (timer);
 
@@ -115,10 +121,12 @@ grab_frames_sync (UcaCamera *camera, gpointer buffer, guint n_frames, UcaCameraT
 }
 
 static guint
-grab_frames_readout (UcaCamera *camera, gpointer buffer, guint n_frames, UcaCameraTriggerSource trigger_source, GTimer *timer)
+grab_frames_readout (UcaCamera *camera, gpointer *frames, guint batch_size, guint n_frames, UcaCameraTriggerSource trigger_source, GTimer *timer)
 {
     GError *error = NULL;
     guint recorded_frames = 0;
+    guint n_batch;
+    guint n_done;
 
     g_object_set(camera, "trigger-source", trigger_source, NULL);
     uca_camera_start_recording(camera, &error);
@@ -136,10 +144,12 @@ grab_frames_readout (UcaCamera *camera, gpointer buffer, guint n_frames, UcaCame
     
     /*This is required because its possible that the camera has recorded frames more
     than what is required. Index starts at 1 for consistency (camRAM index start from 1)*/
-    for(int i = 1; i <= n_frames; i++) {
-        uca_camera_grab (camera, buffer, &error);
+    for (guint i = 1; i <= n_frames; i += n_batch) {
+        n_batch = MIN (batch_size, n_frames - i + 1);
+        uca_camera_grab_many (camera, frames, n_batch, &n_done, &error);
         if(error != NULL){
-            g_warning("There was an error grabbing frame %d during readout from camRAM",i+1);
+            g_warning("There was an error grabbing frame %d during readout from camRAM", i + n_done);
+            g_error_free (error);
             error = NULL;
         }
     }
@@ -162,7 +172,7 @@ grab_callback (gpointer data, gpointer user_data)
 }
 
 static guint
-grab_frames_async (UcaCamera *camera, gpointer buffer, guint n_frames, UcaCameraTriggerSource trigger_source, GTimer *timer)
+grab_frames_async (UcaCamera *camera, gpointer *frames, guint batch_size, guint n_frames, UcaCameraTriggerSource trigger_source, GTimer *timer)
 {
     GError *error = NULL;
     guint n_acquired_frames = 0;
@@ -185,7 +195,7 @@ grab_frames_async (UcaCamera *camera, gpointer buffer, guint n_frames, UcaCamera
 }
 
 static void
-benchmark_method (UcaCamera *camera, gpointer buffer, GrabFrameFunc func, Options *options, UcaCameraTriggerSource trigger_source)
+benchmark_method (UcaCamera *camera, gpointer *frames, GrabFrameFunc func, Options *options, UcaCameraTriggerSource trigger_source)
 {
     GTimer *timer;
     gdouble fps;
@@ -221,7 +231,7 @@ benchmark_method (UcaCamera *camera, gpointer buffer, GrabFrameFunc func, Option
         g_print ("%i/%i", run + 1, options->n_runs);
         g_message ("Start run %i of %i", run + 1, options->n_runs);
 
-        num_frames_acquired += func (camera, buffer, options->n_frames, trigger_source, timer);
+        num_frames_acquired += func (camera, frames, options->batch_size, options->n_frames, trigger_source, timer);
 
         total_time += g_timer_elapsed (timer, NULL);
         g_print ("\b\b\b");
@@ -247,16 +257,14 @@ benchmark (UcaCamera *camera, Options *options)
     guint sensor_height;
     guint roi_width;
     guint roi_height;
-    guint bits;
-    gsize n_bytes_per_pixel;
     gdouble exposure_time;
     gpointer buffer;
+    gpointer *frames;
 
     g_object_get (G_OBJECT (camera),
                   "name", &name,
                   "sensor-width", &sensor_width,
                   "sensor-height", &sensor_height,
-                  "sensor-bitdepth", &bits,
                   "roi-width", &roi_width,
                   "roi-height", &roi_height,
                   "exposure-time", &exposure_time,
@@ -268,36 +276,40 @@ benchmark (UcaCamera *camera, Options *options)
     g_free (name);
 
     /* Synchronous frame acquisition */
-    n_bytes_per_pixel = bits > 8 ? 2 : 1;
-    options->n_bytes = roi_width * roi_height * n_bytes_per_pixel;
-    buffer = g_malloc0 (options->n_bytes);
+    options->n_bytes = uca_camera_get_frame_size (camera);
+    buffer = g_malloc0 (options->n_bytes * options->batch_size);
+    frames = g_new (gpointer, options->batch_size);
+
+    for (gint i = 0; i < options->batch_size; i++)
+        frames[i] = ((guint8 *) buffer) + i * options->n_bytes;
 
     g_object_set (G_OBJECT(camera), "transfer-asynchronously", FALSE, NULL);
 
     if(options->test_readout)
-        benchmark_method (camera, buffer, grab_frames_readout, options, UCA_CAMERA_TRIGGER_SOURCE_AUTO);
+        benchmark_method (camera, frames, grab_frames_readout, options, UCA_CAMERA_TRIGGER_SOURCE_AUTO);
     else
-        benchmark_method (camera, buffer, grab_frames_sync, options, UCA_CAMERA_TRIGGER_SOURCE_AUTO);
+        benchmark_method (camera, frames, grab_frames_sync, options, UCA_CAMERA_TRIGGER_SOURCE_AUTO);
 
     if (options->test_software)
-        benchmark_method (camera, buffer, grab_frames_sync, options, UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE);
+        benchmark_method (camera, frames, grab_frames_sync, options, UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE);
 
     if (options->test_external)
-        benchmark_method (camera, buffer, grab_frames_sync, options, UCA_CAMERA_TRIGGER_SOURCE_EXTERNAL);
+        benchmark_method (camera, frames, grab_frames_sync, options, UCA_CAMERA_TRIGGER_SOURCE_EXTERNAL);
 
     /* Asynchronous frame acquisition */
     if (options->test_async) {
         g_object_set (G_OBJECT(camera), "transfer-asynchronously", TRUE, NULL);
 
-        benchmark_method (camera, buffer, grab_frames_async, options, UCA_CAMERA_TRIGGER_SOURCE_AUTO);
+        benchmark_method (camera, frames, grab_frames_async, options, UCA_CAMERA_TRIGGER_SOURCE_AUTO);
 
         if (options->test_software)
-            benchmark_method (camera, buffer, grab_frames_async, options, UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE);
+            benchmark_method (camera, frames, grab_frames_async, options, UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE);
 
         if (options->test_external)
-            benchmark_method (camera, buffer, grab_frames_async, options, UCA_CAMERA_TRIGGER_SOURCE_EXTERNAL);
+            benchmark_method (camera, frames, grab_frames_async, options, UCA_CAMERA_TRIGGER_SOURCE_EXTERNAL);
     }
 
+    g_free (frames);
     g_free (buffer);
 }
 
@@ -316,6 +328,7 @@ main (int argc, char *argv[])
         .test_software = FALSE,
         .test_external = FALSE,
         .test_readout = FALSE,
+        .batch_size = 16,
     };
 
     static GOptionEntry entries[] = {
@@ -325,6 +338,7 @@ main (int argc, char *argv[])
         { "software", 0, 0, G_OPTION_ARG_NONE, &options.test_software, "Test software trigger mode", NULL },
         { "external", 0, 0, G_OPTION_ARG_NONE, &options.test_external, "Test external trigger mode", NULL },
         { "readout", 0, 0, G_OPTION_ARG_NONE, &options.test_readout, "Test readout from camRAM instead of sync acquisition", NULL},
+        { "batch-size", 'b', 0, G_OPTION_ARG_INT, &options.batch_size, "Number of frames grabbed per call", "N" },
         { NULL }
     };
 
@@ -356,6 +370,11 @@ main (int argc, char *argv[])
     g_assert_no_error (error);
     g_log_set_handler (NULL, G_LOG_LEVEL_MASK, log_handler, log_channel);
 
+    if (options.batch_size < 1) {
+        g_printerr ("Batch size must be at least 1\n");
+        goto cleanup_manager;
+    }
+
     camera = uca_common_get_camera (manager, argv[argc - 1], &error);
 
     if (camera == NULL) {
@@ -39,12 +39,9 @@ typedef struct {
 #endif
 } Options;
 
+/* Maximum number of frames transferred with one uca_camera_grab_many() call */
+#define GRAB_BATCH_SIZE 16
 
-static guint
-get_bytes_per_pixel (guint bits_per_pixel)
-{
-    return bits_per_pixel > 8 ? 2 : 1;
-}
 
 static guint
 count_format_specifiers (const gchar *template)
@@ -68,6 +65,12 @@ count_format_specifiers (const gchar *template)
 }
 
 #ifdef HAVE_LIBTIFF
+static guint
+get_bytes_per_pixel (guint bits_per_pixel)
+{
+    return bits_per_pixel > 8 ? 2 : 1;
+}
+
 static void
 write_tiff (UcaRingBuffer *buffer,
             Options *opts,
@@ -166,10 +169,7 @@ write_raw (UcaRingBuffer *buffer,
 static GError *
 record_frames (UcaCamera *camera, Options *opts)
 {
-    guint roi_width;
-    guint roi_height;
-    guint bits;
-    guint pixel_size;
+    UcaCameraGeometry geometry;
     gsize size;
     gint n_frames;
     guint n_allocated;
@@ -179,16 +179,15 @@ record_frames (UcaCamera *camera, Options *opts)
     GTimer *frame_timer;
     gdouble elapsed;
     UcaRingBuffer *buffer;
+    gpointer frames[GRAB_BATCH_SIZE];
+    UcaRingBufferMetadata *metadata[GRAB_BATCH_SIZE];
+    UcaRingBufferMetadata last;
+    guint n_batch;
+    guint n_done;
     GError *error = NULL;
 
-    g_object_get (G_OBJECT (camera),
-                  "roi-width", &roi_width,
-                  "roi-height", &roi_height,
-                  "sensor-bitdepth", &bits,
-                  NULL);
-
-    pixel_size = get_bytes_per_pixel (bits);
-    size = roi_width * roi_height * pixel_size;
+    uca_camera_get_geometry (camera, &geometry);
+    size = geometry.frame_size;
     n_allocated = opts->n_frames > 0 ? opts->n_frames : 256;
     buffer = uca_ring_buffer_new (size, n_allocated);
     total_timer = g_timer_new();
@@ -196,7 +195,7 @@ record_frames (UcaCamera *camera, Options *opts)
     g_timer_stop (frame_timer);
 
     g_print ("Acquiring %i images at %ix%i with %i bits per pixel\n",
-             opts->n_frames, roi_width, roi_height, bits);
+             opts->n_frames, geometry.width, geometry.height, geometry.bitdepth);
 
     uca_camera_start_recording (camera, &error);
 
@@ -209,15 +208,33 @@ record_frames (UcaCamera *camera, Options *opts)
     g_timer_start (total_timer);
 
     while (1) {
+        if (opts->n_frames > 0)
+            n_batch = MIN (GRAB_BATCH_SIZE, opts->n_frames - n_frames);
+        else
+            n_batch = GRAB_BATCH_SIZE;
+
+        /* We are the only user of the buffer, so blocks can be claimed first */
+        for (guint i = 0; i < n_batch; i++) {
+            frames[i] = uca_ring_buffer_get_write_pointer (buffer);
+            metadata[i] = uca_ring_buffer_get_write_metadata (buffer);
+            uca_ring_buffer_write_advance (buffer);
+        }
+
         g_timer_continue (frame_timer);
-        uca_camera_grab (camera, uca_ring_buffer_get_write_pointer (buffer), &error);
+        uca_camera_grab_many (camera, frames, n_batch, &n_done, &error);
         g_timer_stop (frame_timer);
-        uca_ring_buffer_write_advance (buffer);
+        uca_camera_get_last_metadata (camera, &last);
+
+        for (guint i = 0; i < n_done; i++) {
+            *metadata[i] = last;
+            metadata[i]->sequence = last.sequence - (n_done - 1 - i);
+        }
 
         if (error != NULL)
             return error;
 
-        g_print (fmt_string, ++n_frames, opts->n_frames);
+        n_frames += n_done;
+        g_print (fmt_string, n_frames, opts->n_frames);
 
         if (n_frames == opts->n_frames)
             break;
@@ -240,7 +257,7 @@ record_frames (UcaCamera *camera, Options *opts)
     else {
 #ifdef HAVE_LIBTIFF
         if (g_str_has_suffix (opts->filename, ".tif") || g_str_has_suffix (opts->filename, ".tiff"))
-            write_tiff (buffer, opts, roi_width, roi_height, bits);
+            write_tiff (buffer, opts, geometry.width, geometry.height, geometry.bitdepth);
         else
             write_raw (buffer, opts);
 #else
@@ -58,6 +58,7 @@ struct _UcaFileCameraPrivate {
     guint bitdepth;
     GList *fnames;
     GList *current;
+    gboolean path_changed;
 };
 
 static void
@@ -75,7 +76,7 @@ read_tiff_meta_data (UcaFileCameraPrivate *priv, const gchar *fname)
 }
 
 static gboolean
-read_tiff_data (UcaFileCameraPrivate *priv, const gchar *fname, gpointer buffer)
+read_tiff_data (UcaFileCameraPrivate *priv, const gchar *fname, gpointer buffer, GCancellable *cancellable)
 {
     TIFF *file;
     guint16 bitdepth;
@@ -101,10 +102,17 @@ read_tiff_data (UcaFileCameraPrivate *priv, const gchar *fname, gpointer buffer)
     step *= priv->bitdepth / 8;
 
     for (guint32 i = 0; i < priv->height; i++) {
+        if (g_cancellable_is_cancelled (cancellable)) {
+            TIFFClose (file);
+            return FALSE;
+        }
+
         result = TIFFReadScanline (file, ((gchar *) buffer) + offset, i, 0);
 
-        if (result == -1)
+        if (result == -1) {
+            TIFFClose (file);
             return FALSE;
+        }
 
         offset += step;
     }
@@ -180,9 +188,14 @@ static gboolean
 uca_file_camera_grab (UcaCamera *camera, gpointer data, GError **error)
 {
     UcaFileCameraPrivate *priv;
+    GCancellable *cancellable;
     g_return_val_if_fail (UCA_IS_FILE_CAMERA (camera), FALSE);
 
     priv = UCA_FILE_CAMERA_GET_PRIVATE (camera);
+    cancellable = uca_camera_get_cancellable (camera);
+
+    if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        return FALSE;
 
     if (priv->current == NULL) {
         g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM,
@@ -190,9 +203,10 @@ uca_file_camera_grab (UcaCamera *camera, gpointer data, GError **error)
         return FALSE;
     }
 
-    if (!read_tiff_data (priv, (const gchar *) priv->current->data, data)) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM,
-                     "Error reading file");
+    if (!read_tiff_data (priv, (const gchar *) priv->current->data, data, cancellable)) {
+        if (!g_cancellable_set_error_if_cancelled (cancellable, error))
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM,
+                         "Error reading file");
         return FALSE;
     }
 
@@ -200,28 +214,48 @@ uca_file_camera_grab (UcaCamera *camera, gpointer data, GError **error)
     return TRUE;
 }
 
+static void
+apply_path (GObject *object, UcaFileCameraPrivate *priv)
+{
+    update_fnames (priv);
+    priv->path_changed = FALSE;
+
+    g_object_notify (object, "roi-width");
+    g_object_notify (object, "roi-height");
+    g_object_notify (object, "sensor-bitdepth");
+}
+
+static gboolean
+uca_file_camera_commit (UcaCamera *camera, GError **error)
+{
+    UcaFileCameraPrivate *priv = UCA_FILE_CAMERA_GET_PRIVATE (camera);
+
+    /* Rescan the directory once, no matter how often the path was set */
+    if (priv->path_changed)
+        apply_path (G_OBJECT (camera), priv);
+
+    return TRUE;
+}
+
 static void
 uca_file_camera_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
 {
     g_return_if_fail(UCA_IS_FILE_CAMERA(object));
     UcaFileCameraPrivate *priv = UCA_FILE_CAMERA_GET_PRIVATE(object);
 
-    if (uca_camera_is_recording (UCA_CAMERA(object)) &&
-        !uca_camera_is_writable_during_acquisition (UCA_CAMERA (object), pspec->name)) {
-        g_warning ("Property '%s' cant be changed during acquisition", pspec->name);
+    /* Settings that cannot change during acquisition are applied between frames */
+    if (uca_camera_queue_property (UCA_CAMERA (object), pspec, value))
         return;
-    }
 
     switch (property_id) {
         case PROP_PATH:
             g_free (priv->path);
             priv->path = g_strdup (g_value_get_string (value));
             priv->path = g_strstrip (priv->path);
-            update_fnames (priv);
+            priv->path_changed = TRUE;
 
-            g_object_notify (object, "roi-width");
-            g_object_notify (object, "roi-height");
-            g_object_notify (object, "sensor-bitdepth");
+            if (!uca_camera_is_batch_pending (UCA_CAMERA (object)))
+                apply_path (object, priv);
             break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -319,6 +353,7 @@ uca_file_camera_class_init(UcaFileCameraClass *klass)
     camera_class->stop_recording = uca_file_camera_stop_recording;
     camera_class->grab = uca_file_camera_grab;
     camera_class->trigger = uca_file_camera_trigger;
+    camera_class->commit = uca_file_camera_commit;
 
     for (guint i = 0; file_overrideables[i] != 0; i++)
         g_object_class_override_property (gobject_class, file_overrideables[i], uca_camera_props[file_overrideables[i]]);
@@ -348,6 +383,7 @@ uca_file_camera_init(UcaFileCamera *self)
     priv->bitdepth = 8;
 
     priv->fnames = NULL;
+    priv->path_changed = FALSE;
     update_fnames (priv);
 }
 
@@ -56,6 +56,7 @@ static GParamSpec *mock_properties[N_PROPERTIES] = { NULL, };
 
 static GMutex signal_mutex;
 static GCond signal_cond;
+static guint signal_count;
 
 struct _UcaMockCameraPrivate {
     guint width;
@@ -76,7 +77,12 @@ struct _UcaMockCameraPrivate {
     gboolean thread_running;
 
     GThread *grab_thread;
-    GAsyncQueue *trigger_queue;
+
+    /* Protects n_triggers, grab_cond wakes up waiting grabs */
+    GMutex grab_mutex;
+    GCond grab_cond;
+    guint n_triggers;
+    gulong cancelled_id;
 };
 
 static const char g_digits[16][20] = {
@@ -250,12 +256,30 @@ mock_grab_func(gpointer data)
 
     UcaMockCameraPrivate *priv = UCA_MOCK_CAMERA_GET_PRIVATE(mock_camera);
     UcaCamera *camera = UCA_CAMERA(mock_camera);
+    GError *error = NULL;
     gdouble fps = 0;
     g_object_get (G_OBJECT (data), "frames-per-second", &fps, NULL);
     const gulong sleep_time = (gulong) G_USEC_PER_SEC / fps;
 
+    if (!uca_camera_setup_thread (camera, &error)) {
+        g_warning ("Could not set up grab thread: %s", error->message);
+        g_error_free (error);
+    }
+
     while (priv->thread_running) {
-        camera->grab_func(priv->dummy_data, camera->user_data);
+        gpointer buffer;
+
+        uca_camera_apply_queued_properties (camera);
+
+        /* A real camera would transfer straight into the delivery buffer */
+        buffer = uca_camera_get_delivery_buffer (camera);
+
+        if (buffer != NULL)
+            memcpy (buffer, priv->dummy_data, priv->roi_width * priv->roi_height * priv->bytes);
+        else
+            buffer = priv->dummy_data;
+
+        uca_camera_deliver_frame (camera, buffer);
         g_usleep(sleep_time);
     }
 
@@ -266,7 +290,20 @@ static void
 handle_sigusr1 (int signum)
 {
     g_mutex_lock (&signal_mutex);
-    g_cond_signal (&signal_cond);
+    signal_count++;
+    g_cond_broadcast (&signal_cond);
+    g_mutex_unlock (&signal_mutex);
+}
+
+static void
+on_cancelled (GCancellable *cancellable, UcaMockCameraPrivate *priv)
+{
+    g_mutex_lock (&priv->grab_mutex);
+    g_cond_broadcast (&priv->grab_cond);
+    g_mutex_unlock (&priv->grab_mutex);
+
+    g_mutex_lock (&signal_mutex);
+    g_cond_broadcast (&signal_cond);
     g_mutex_unlock (&signal_mutex);
 }
 
@@ -283,7 +320,7 @@ uca_mock_camera_start_recording(UcaCamera *camera, GError **error)
     /* TODO: check that roi_x + roi_width < priv->width */
     priv->dummy_data = (guint8 *) g_malloc0(priv->roi_width * priv->roi_height * priv->bytes);
 
-    g_object_get(G_OBJECT(camera), "transfer-asynchronously", &transfer_async, NULL);
+    transfer_async = uca_camera_get_transfer_asynchronously (camera);
 
     /*
      * In case asynchronous transfer is requested, we start a new thread that
@@ -313,17 +350,15 @@ uca_mock_camera_stop_recording(UcaCamera *camera, GError **error)
     g_return_if_fail(UCA_IS_MOCK_CAMERA(camera));
 
     priv = UCA_MOCK_CAMERA_GET_PRIVATE(camera);
-    g_free(priv->dummy_data);
-    priv->dummy_data = NULL;
-
-    g_object_get(G_OBJECT(camera),
-            "transfer-asynchronously", &transfer_async,
-            NULL);
+    transfer_async = uca_camera_get_transfer_asynchronously (camera);
 
     if (transfer_async) {
         priv->thread_running = FALSE;
         g_thread_join(priv->grab_thread);
     }
+
+    g_free(priv->dummy_data);
+    priv->dummy_data = NULL;
 }
 
 static void
@@ -334,7 +369,10 @@ uca_mock_camera_trigger (UcaCamera *camera, GError **error)
     g_return_if_fail(UCA_IS_MOCK_CAMERA (camera));
     priv = UCA_MOCK_CAMERA_GET_PRIVATE (camera);
 
-    g_async_queue_push (priv->trigger_queue, g_malloc0 (1));
+    g_mutex_lock (&priv->grab_mutex);
+    priv->n_triggers++;
+    g_cond_broadcast (&priv->grab_cond);
+    g_mutex_unlock (&priv->grab_mutex);
 }
 
 static gboolean
@@ -342,28 +380,57 @@ uca_mock_camera_grab (UcaCamera *camera, gpointer data, GError **error)
 {
     UcaMockCameraPrivate *priv;
     UcaCameraTriggerSource trigger_source;
+    GCancellable *cancellable;
     gdouble exposure_time;
+    gint64 end_time;
 
     g_return_val_if_fail (UCA_IS_MOCK_CAMERA(camera), FALSE);
 
 
     priv = UCA_MOCK_CAMERA_GET_PRIVATE (camera);
+    cancellable = uca_camera_get_cancellable (camera);
 
-    g_object_get (G_OBJECT (camera),
-                  "exposure-time", &exposure_time,
-                  "trigger-source", &trigger_source, NULL);
+    /* Read settings directly instead of through the property system */
+    exposure_time = priv->exposure_time;
+    trigger_source = uca_camera_get_trigger_source (camera);
 
-    if (trigger_source == UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE)
-        g_free (g_async_queue_pop (priv->trigger_queue));
+    if (trigger_source == UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE) {
+        g_mutex_lock (&priv->grab_mutex);
+
+        while (priv->n_triggers == 0 && !g_cancellable_is_cancelled (cancellable))
+            g_cond_wait (&priv->grab_cond, &priv->grab_mutex);
+
+        if (priv->n_triggers > 0 && !g_cancellable_is_cancelled (cancellable))
+            priv->n_triggers--;
+
+        g_mutex_unlock (&priv->grab_mutex);
+    }
 
     if (trigger_source == UCA_CAMERA_TRIGGER_SOURCE_EXTERNAL) {
+        guint count;
+
         /* wait for signal to arrive */
         g_mutex_lock (&signal_mutex);
-        g_cond_wait (&signal_cond, &signal_mutex);
+        count = signal_count;
+
+        while (signal_count == count && !g_cancellable_is_cancelled (cancellable))
+            g_cond_wait (&signal_cond, &signal_mutex);
+
         g_mutex_unlock (&signal_mutex);
     }
 
-    g_usleep (G_USEC_PER_SEC * exposure_time);
+    /* Expose, unless we are stopped in the meantime */
+    end_time = g_get_monotonic_time () + (gint64) (G_USEC_PER_SEC * exposure_time);
+    g_mutex_lock (&priv->grab_mutex);
+
+    while (!g_cancellable_is_cancelled (cancellable) &&
+           g_cond_wait_until (&priv->grab_cond, &priv->grab_mutex, end_time))
+        ;
+
+    g_mutex_unlock (&priv->grab_mutex);
+
+    if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        return FALSE;
 
     if (priv->fill_data) {
         print_current_frame (priv, priv->dummy_data, FALSE);
@@ -392,16 +459,33 @@ uca_mock_camera_readout (UcaCamera *camera, gpointer data, guint index, GError *
     return TRUE;
 }
 
+static gboolean
+uca_mock_camera_commit (UcaCamera *camera, GError **error)
+{
+    UcaMockCameraPrivate *priv = UCA_MOCK_CAMERA_GET_PRIVATE (camera);
+
+    /* The region can only be checked once all of its values are known */
+    if (priv->roi_x + priv->roi_width > priv->width ||
+        priv->roi_y + priv->roi_height > priv->height) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY,
+                     "Region of interest %ux%u+%u+%u exceeds sensor of %ux%u",
+                     priv->roi_width, priv->roi_height, priv->roi_x, priv->roi_y,
+                     priv->width, priv->height);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 static void
 uca_mock_camera_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
 {
     g_return_if_fail (UCA_IS_MOCK_CAMERA (object));
     UcaMockCameraPrivate *priv = UCA_MOCK_CAMERA_GET_PRIVATE (object);
 
-    if (uca_camera_is_recording (UCA_CAMERA (object)) && !uca_camera_is_writable_during_acquisition (UCA_CAMERA (object), pspec->name)) {
-        g_warning ("Property '%s' cant be changed during acquisition", pspec->name);
+    /* Settings that cannot change during acquisition are applied between frames */
+    if (uca_camera_queue_property (UCA_CAMERA (object), pspec, value))
         return;
-    }
 
     switch (property_id) {
         case PROP_EXPOSURE_TIME:
@@ -501,7 +585,9 @@ uca_mock_camera_finalize(GObject *object)
     }
 
     g_free (priv->dummy_data);
-    g_async_queue_unref (priv->trigger_queue);
+    g_cancellable_disconnect (uca_camera_get_cancellable (UCA_CAMERA (object)), priv->cancelled_id);
+    g_mutex_clear (&priv->grab_mutex);
+    g_cond_clear (&priv->grab_cond);
 
     G_OBJECT_CLASS (uca_mock_camera_parent_class)->finalize(object);
 }
@@ -555,6 +641,7 @@ uca_mock_camera_class_init(UcaMockCameraClass *klass)
     camera_class->grab = uca_mock_camera_grab;
     camera_class->readout = uca_mock_camera_readout;
     camera_class->trigger = uca_mock_camera_trigger;
+    camera_class->commit = uca_mock_camera_commit;
 
     for (guint i = 0; mock_overrideables[i] != 0; i++)
         g_object_class_override_property(gobject_class, mock_overrideables[i], uca_camera_props[mock_overrideables[i]]);
@@ -618,7 +705,11 @@ uca_mock_camera_init(UcaMockCamera *self)
     self->priv->bits = 8;
     self->priv->bytes = 0;
     self->priv->max_val = 0;
-    self->priv->trigger_queue = g_async_queue_new ();
+    self->priv->n_triggers = 0;
+    g_mutex_init (&self->priv->grab_mutex);
+    g_cond_init (&self->priv->grab_cond);
+    self->priv->cancelled_id = g_cancellable_connect (uca_camera_get_cancellable (UCA_CAMERA (self)),
+                                                      G_CALLBACK (on_cancelled), self->priv, NULL);
 
     uca_camera_register_unit (UCA_CAMERA (self), "degree-value", UCA_UNIT_DEGREE_CELSIUS);
 }
@@ -0,0 +1,688 @@
+/* Copyright (C) 2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-accumulator
+ * @Short_description: Per-pixel statistics over many frames
+ * @Title: UcaAccumulator
+ *
+ * A #UcaAccumulator keeps the running mean, variance, minimum and maximum of
+ * every pixel, so that long series such as dark frames for detector
+ * characterisation need neither disk space nor a second pass. The mean and
+ * variance are updated with Welford's algorithm in double precision, which
+ * stays accurate over any number of frames.
+ *
+ * Frames are added with uca_accumulator_add() or uca_accumulator_acquire().
+ * An accumulator is also a #UcaFilter that leaves frames unchanged, so adding
+ * it to a camera with uca_camera_add_filter() accumulates every frame of a
+ * recording. Statistics are stored in blocks of pixels with a lock each, so
+ * that the filter threads of a buffered camera update different blocks at
+ * the same time. The update uses AVX2 on x86 processors supporting it and
+ * NEON on 64-bit ARM, with a scalar fallback.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "uca-accumulator.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+/* Vectors of doubles are only available on 64-bit ARM */
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define HAVE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+#define UCA_ACCUMULATOR_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_ACCUMULATOR, UcaAccumulatorPrivate))
+
+/*
+ * Pixels per block, so that the statistics of a block and its part of the
+ * frame fit into the L2 cache
+ */
+#define BLOCK_PIXELS        4096
+#define STATISTICS_ALIGNMENT 64
+
+static void uca_accumulator_interface_init (UcaFilterInterface *iface);
+
+#ifdef HAVE_AVX2_KERNELS
+static gboolean have_avx2 = FALSE;
+#endif
+
+G_DEFINE_TYPE_WITH_CODE (UcaAccumulator, uca_accumulator, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_accumulator_interface_init))
+
+typedef struct {
+    GMutex lock;
+    guint64 count;
+} Block;
+
+struct _UcaAccumulatorPrivate {
+    /*
+     * Adding frames takes the reader lock and then each block lock in turn,
+     * changing the geometry or reading results takes the writer lock.
+     */
+    GRWLock lock;
+    guint width;
+    guint height;
+    UcaPixelFormat format;
+    guint n_blocks;
+    Block *blocks;
+    gdouble *mean;
+    gdouble *m2;
+    guint16 *min;
+    guint16 *max;
+};
+
+static gpointer
+alloc_aligned (gsize size)
+{
+    gpointer data;
+
+    if (posix_memalign (&data, STATISTICS_ALIGNMENT, MAX (size, 1)) != 0)
+        g_error ("Could not allocate %" G_GSIZE_FORMAT " bytes of statistics", size);
+
+    return data;
+}
+
+/* Must be called with the writer lock held */
+static void
+free_statistics (UcaAccumulatorPrivate *priv)
+{
+    for (guint i = 0; i < priv->n_blocks; i++)
+        g_mutex_clear (&priv->blocks[i].lock);
+
+    g_free (priv->blocks);
+    free (priv->mean);
+    free (priv->m2);
+    free (priv->min);
+    free (priv->max);
+
+    priv->blocks = NULL;
+    priv->mean = NULL;
+    priv->m2 = NULL;
+    priv->min = NULL;
+    priv->max = NULL;
+    priv->n_blocks = 0;
+    priv->width = 0;
+    priv->height = 0;
+}
+
+/* Must be called with the writer lock held */
+static void
+alloc_statistics (UcaAccumulatorPrivate *priv, const UcaFrameInfo *info)
+{
+    gsize n_pixels;
+
+    n_pixels = (gsize) info->width * info->height;
+
+    priv->width = info->width;
+    priv->height = info->height;
+    priv->format = info->format;
+    priv->n_blocks = (n_pixels + BLOCK_PIXELS - 1) / BLOCK_PIXELS;
+    priv->blocks = g_new0 (Block, priv->n_blocks);
+    priv->mean = alloc_aligned (n_pixels * sizeof (gdouble));
+    priv->m2 = alloc_aligned (n_pixels * sizeof (gdouble));
+    priv->min = alloc_aligned (n_pixels * sizeof (guint16));
+    priv->max = alloc_aligned (n_pixels * sizeof (guint16));
+
+    memset (priv->mean, 0, n_pixels * sizeof (gdouble));
+    memset (priv->m2, 0, n_pixels * sizeof (gdouble));
+    memset (priv->min, 0xff, n_pixels * sizeof (guint16));
+    memset (priv->max, 0, n_pixels * sizeof (guint16));
+
+    for (guint i = 0; i < priv->n_blocks; i++)
+        g_mutex_init (&priv->blocks[i].lock);
+}
+
+/*
+ * Welford update of contiguous pixels, starting at index i. The vector
+ * kernels widen eight pixels at a time to 16 bits for the minimum and
+ * maximum and to doubles for the mean, and return how many pixels they
+ * updated. Their additions and multiplications are the same as those of the
+ * scalar loop, so results do not depend on the processor.
+ */
+#define UPDATE_PIXELS(type)                                                 \
+    static void                                                             \
+    update_pixels_##type (const type *restrict x, gdouble *restrict mean,   \
+                          gdouble *restrict m2, guint16 *restrict min,      \
+                          guint16 *restrict max, gdouble inv_count,         \
+                          gsize i, gsize n)                                 \
+    {                                                                       \
+        for (; i < n; i++) {                                                \
+            gdouble value = x[i];                                           \
+            gdouble delta = value - mean[i];                                \
+                                                                            \
+            mean[i] += delta * inv_count;                                   \
+            m2[i] += delta * (value - mean[i]);                             \
+            min[i] = x[i] < min[i] ? x[i] : min[i];                         \
+            max[i] = x[i] > max[i] ? x[i] : max[i];                         \
+        }                                                                   \
+    }
+
+UPDATE_PIXELS (guint8)
+UPDATE_PIXELS (guint16)
+
+#ifdef HAVE_AVX2_KERNELS
+__attribute__ ((target ("avx2")))
+static void
+welford_avx2 (__m256d value, gdouble *mean, gdouble *m2, __m256d inv_count)
+{
+    __m256d m = _mm256_loadu_pd (mean);
+    __m256d delta = _mm256_sub_pd (value, m);
+
+    m = _mm256_add_pd (m, _mm256_mul_pd (delta, inv_count));
+    _mm256_storeu_pd (mean, m);
+    _mm256_storeu_pd (m2, _mm256_add_pd (_mm256_loadu_pd (m2),
+                                         _mm256_mul_pd (delta, _mm256_sub_pd (value, m))));
+}
+
+__attribute__ ((target ("avx2")))
+static void
+update_8_avx2 (__m128i x, gdouble *mean, gdouble *m2, guint16 *min, guint16 *max, __m256d inv_count)
+{
+    __m128i lower = _mm_cvtepu16_epi32 (x);
+    __m128i upper = _mm_cvtepu16_epi32 (_mm_srli_si128 (x, 8));
+
+    welford_avx2 (_mm256_cvtepi32_pd (lower), mean, m2, inv_count);
+    welford_avx2 (_mm256_cvtepi32_pd (upper), mean + 4, m2 + 4, inv_count);
+    _mm_storeu_si128 ((__m128i *) min, _mm_min_epu16 (_mm_loadu_si128 ((const __m128i *) min), x));
+    _mm_storeu_si128 ((__m128i *) max, _mm_max_epu16 (_mm_loadu_si128 ((const __m128i *) max), x));
+}
+
+__attribute__ ((target ("avx2")))
+static gsize
+update_pixels_guint8_avx2 (const guint8 *x, gdouble *mean, gdouble *m2,
+                           guint16 *min, guint16 *max, gdouble inv_count, gsize n)
+{
+    __m256d inv = _mm256_set1_pd (inv_count);
+    gsize i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i pixels = _mm_cvtepu8_epi16 (_mm_loadl_epi64 ((const __m128i *) (x + i)));
+        update_8_avx2 (pixels, mean + i, m2 + i, min + i, max + i, inv);
+    }
+
+    return i;
+}
+
+__attribute__ ((target ("avx2")))
+static gsize
+update_pixels_guint16_avx2 (const guint16 *x, gdouble *mean, gdouble *m2,
+                            guint16 *min, guint16 *max, gdouble inv_count, gsize n)
+{
+    __m256d inv = _mm256_set1_pd (inv_count);
+    gsize i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i pixels = _mm_loadu_si128 ((const __m128i *) (x + i));
+        update_8_avx2 (pixels, mean + i, m2 + i, min + i, max + i, inv);
+    }
+
+    return i;
+}
+#endif
+
+#ifdef HAVE_NEON_KERNELS
+static void
+welford_neon (float64x2_t value, gdouble *mean, gdouble *m2, float64x2_t inv_count)
+{
+    float64x2_t m = vld1q_f64 (mean);
+    float64x2_t delta = vsubq_f64 (value, m);
+
+    m = vaddq_f64 (m, vmulq_f64 (delta, inv_count));
+    vst1q_f64 (mean, m);
+    vst1q_f64 (m2, vaddq_f64 (vld1q_f64 (m2), vmulq_f64 (delta, vsubq_f64 (value, m))));
+}
+
+static void
+update_8_neon (uint16x8_t x, gdouble *mean, gdouble *m2, guint16 *min, guint16 *max, float64x2_t inv_count)
+{
+    uint32x4_t lower = vmovl_u16 (vget_low_u16 (x));
+    uint32x4_t upper = vmovl_u16 (vget_high_u16 (x));
+
+    welford_neon (vcvtq_f64_u64 (vmovl_u32 (vget_low_u32 (lower))), mean, m2, inv_count);
+    welford_neon (vcvtq_f64_u64 (vmovl_u32 (vget_high_u32 (lower))), mean + 2, m2 + 2, inv_count);
+    welford_neon (vcvtq_f64_u64 (vmovl_u32 (vget_low_u32 (upper))), mean + 4, m2 + 4, inv_count);
+    welford_neon (vcvtq_f64_u64 (vmovl_u32 (vget_high_u32 (upper))), mean + 6, m2 + 6, inv_count);
+    vst1q_u16 (min, vminq_u16 (vld1q_u16 (min), x));
+    vst1q_u16 (max, vmaxq_u16 (vld1q_u16 (max), x));
+}
+
+static gsize
+update_pixels_guint8_neon (const guint8 *x, gdouble *mean, gdouble *m2,
+                           guint16 *min, guint16 *max, gdouble inv_count, gsize n)
+{
+    float64x2_t inv = vdupq_n_f64 (inv_count);
+    gsize i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+        update_8_neon (vmovl_u8 (vld1_u8 (x + i)), mean + i, m2 + i, min + i, max + i, inv);
+
+    return i;
+}
+
+static gsize
+update_pixels_guint16_neon (const guint16 *x, gdouble *mean, gdouble *m2,
+                            guint16 *min, guint16 *max, gdouble inv_count, gsize n)
+{
+    float64x2_t inv = vdupq_n_f64 (inv_count);
+    gsize i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+        update_8_neon (vld1q_u16 (x + i), mean + i, m2 + i, min + i, max + i, inv);
+
+    return i;
+}
+#endif
+
+static void
+update_pixels (UcaPixelFormat format, gconstpointer x, gdouble *mean, gdouble *m2,
+               guint16 *min, guint16 *max, gdouble inv_count, gsize n)
+{
+    gsize i = 0;
+
+    if (format == UCA_PIXEL_FORMAT_MONO8) {
+#ifdef HAVE_AVX2_KERNELS
+        if (have_avx2)
+            i = update_pixels_guint8_avx2 (x, mean, m2, min, max, inv_count, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+        i = update_pixels_guint8_neon (x, mean, m2, min, max, inv_count, n);
+#endif
+        update_pixels_guint8 (x, mean, m2, min, max, inv_count, i, n);
+    }
+    else {
+#ifdef HAVE_AVX2_KERNELS
+        if (have_avx2)
+            i = update_pixels_guint16_avx2 (x, mean, m2, min, max, inv_count, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+        i = update_pixels_guint16_neon (x, mean, m2, min, max, inv_count, n);
+#endif
+        update_pixels_guint16 (x, mean, m2, min, max, inv_count, i, n);
+    }
+}
+
+/* Must be called with the block lock held */
+static void
+update_block (UcaAccumulatorPrivate *priv, guint index, gconstpointer data, gsize stride)
+{
+    gsize first, last;
+    gdouble inv_count;
+
+    first = (gsize) index * BLOCK_PIXELS;
+    last = MIN (first + BLOCK_PIXELS, (gsize) priv->width * priv->height);
+    inv_count = 1.0 / (gdouble) ++priv->blocks[index].count;
+
+    /* A block spans parts of several rows */
+    while (first < last) {
+        guint y = first / priv->width;
+        guint x = first % priv->width;
+        gsize n = MIN (last - first, (gsize) priv->width - x);
+        const guint8 *row = ((const guint8 *) data) + y * stride;
+        gconstpointer pixels;
+
+        if (priv->format == UCA_PIXEL_FORMAT_MONO8)
+            pixels = row + x;
+        else
+            pixels = ((const guint16 *) row) + x;
+
+        update_pixels (priv->format, pixels, priv->mean + first, priv->m2 + first,
+                       priv->min + first, priv->max + first, inv_count, n);
+
+        first += n;
+    }
+}
+
+/**
+ * uca_accumulator_new:
+ *
+ * Returns: (transfer full): A new #UcaAccumulator without frames.
+ * Since: 2.4
+ */
+UcaAccumulator *
+uca_accumulator_new (void)
+{
+    return UCA_ACCUMULATOR (g_object_new (UCA_TYPE_ACCUMULATOR, NULL));
+}
+
+/**
+ * uca_accumulator_add:
+ * @accumulator: A #UcaAccumulator
+ * @data: Pixel data of the frame
+ * @info: Description of @data
+ * @error: Location for a #GError or %NULL
+ *
+ * Add a frame to the statistics. The first frame after creation or
+ * uca_accumulator_reset() determines the geometry that all following frames
+ * must have. This can be called from several threads at the same time.
+ *
+ * Returns: %TRUE on success, %FALSE with a #UCA_FILTER_ERROR_FORMAT error if
+ * the frame does not match the previous ones.
+ * Since: 2.4
+ */
+gboolean
+uca_accumulator_add (UcaAccumulator *accumulator, gconstpointer data, const UcaFrameInfo *info, GError **error)
+{
+    UcaAccumulatorPrivate *priv;
+
+    g_return_val_if_fail (UCA_IS_ACCUMULATOR (accumulator), FALSE);
+    g_return_val_if_fail (data != NULL && info != NULL, FALSE);
+
+    priv = accumulator->priv;
+
+    g_rw_lock_reader_lock (&priv->lock);
+
+    /* Set up the statistics for the first frame */
+    while (priv->blocks == NULL) {
+        g_rw_lock_reader_unlock (&priv->lock);
+        g_rw_lock_writer_lock (&priv->lock);
+
+        if (priv->blocks == NULL)
+            alloc_statistics (priv, info);
+
+        g_rw_lock_writer_unlock (&priv->lock);
+        g_rw_lock_reader_lock (&priv->lock);
+    }
+
+    if (info->width != priv->width || info->height != priv->height || info->format != priv->format) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                     "Frame of %ux%u does not match accumulated frames of %ux%u",
+                     info->width, info->height, priv->width, priv->height);
+        g_rw_lock_reader_unlock (&priv->lock);
+        return FALSE;
+    }
+
+    /*
+     * Threads adding different frames follow each other through the
+     * blocks and only wait if they catch up.
+     */
+    for (guint i = 0; i < priv->n_blocks; i++) {
+        g_mutex_lock (&priv->blocks[i].lock);
+        update_block (priv, i, data, info->stride);
+        g_mutex_unlock (&priv->blocks[i].lock);
+    }
+
+    g_rw_lock_reader_unlock (&priv->lock);
+    return TRUE;
+}
+
+/**
+ * uca_accumulator_acquire:
+ * @accumulator: A #UcaAccumulator
+ * @camera: A recording #UcaCamera
+ * @n_frames: Number of frames to add
+ * @error: Location for a #GError or %NULL
+ *
+ * Grab @n_frames frames from @camera with uca_camera_grab_frame() and add
+ * them with the geometry they were grabbed with. If @accumulator is also an
+ * active filter of @camera, the grabbed frames have already been added by the
+ * filter chain and are not counted twice.
+ *
+ * Returns: %TRUE on success.
+ * Since: 2.4
+ */
+gboolean
+uca_accumulator_acquire (UcaAccumulator *accumulator, UcaCamera *camera, guint n_frames, GError **error)
+{
+    UcaFrame *frame;
+    gboolean counted;
+    gboolean result = TRUE;
+
+    g_return_val_if_fail (UCA_IS_ACCUMULATOR (accumulator), FALSE);
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+
+    for (guint i = 0; i < n_frames && result; i++) {
+        /* Decided per frame, the chain is fixed anew when recording restarts */
+        counted = uca_camera_is_filter_active (camera, UCA_FILTER (accumulator));
+        frame = uca_camera_grab_frame (camera, error);
+
+        if (frame == NULL)
+            return FALSE;
+
+        if (!counted)
+            result = uca_accumulator_add (accumulator, uca_frame_get_data (frame), uca_frame_get_info (frame), error);
+
+        uca_frame_unref (frame);
+    }
+
+    return result;
+}
+
+/**
+ * uca_accumulator_reset:
+ * @accumulator: A #UcaAccumulator
+ *
+ * Forget all frames added so far.
+ *
+ * Since: 2.4
+ */
+void
+uca_accumulator_reset (UcaAccumulator *accumulator)
+{
+    g_return_if_fail (UCA_IS_ACCUMULATOR (accumulator));
+
+    g_rw_lock_writer_lock (&accumulator->priv->lock);
+    free_statistics (accumulator->priv);
+    g_rw_lock_writer_unlock (&accumulator->priv->lock);
+}
+
+/**
+ * uca_accumulator_get_count:
+ * @accumulator: A #UcaAccumulator
+ *
+ * Returns: Number of frames added since creation or the last reset.
+ * Since: 2.4
+ */
+guint64
+uca_accumulator_get_count (UcaAccumulator *accumulator)
+{
+    guint64 count = 0;
+
+    g_return_val_if_fail (UCA_IS_ACCUMULATOR (accumulator), 0);
+
+    /* Writers exclude adds in progress, so all blocks agree */
+    g_rw_lock_writer_lock (&accumulator->priv->lock);
+
+    if (accumulator->priv->blocks != NULL)
+        count = accumulator->priv->blocks[0].count;
+
+    g_rw_lock_writer_unlock (&accumulator->priv->lock);
+    return count;
+}
+
+static gfloat
+get_value (UcaAccumulatorPrivate *priv, UcaAccumulatorStatistic statistic, gsize i, guint64 count)
+{
+    switch (statistic) {
+        case UCA_ACCUMULATOR_MEAN:
+            return (gfloat) priv->mean[i];
+        case UCA_ACCUMULATOR_VARIANCE:
+            return count > 1 ? (gfloat) (priv->m2[i] / (count - 1)) : 0.0f;
+        case UCA_ACCUMULATOR_MIN:
+            return priv->min[i];
+        case UCA_ACCUMULATOR_MAX:
+            return priv->max[i];
+    }
+
+    return 0.0f;
+}
+
+/**
+ * uca_accumulator_get_statistic:
+ * @accumulator: A #UcaAccumulator
+ * @statistic: Which statistic to get
+ * @output: (allow-none) (array): Location for width times height values or
+ *  %NULL to only query the size
+ * @width: (out) (allow-none): Location for the width of the frames or %NULL
+ * @height: (out) (allow-none): Location for the height of the frames or %NULL
+ *
+ * Get a per-pixel statistic of the frames added so far as tightly packed
+ * rows.
+ *
+ * Returns: %FALSE if no frame has been added.
+ * Since: 2.4
+ */
+gboolean
+uca_accumulator_get_statistic (UcaAccumulator *accumulator, UcaAccumulatorStatistic statistic,
+                               gfloat *output, guint *width, guint *height)
+{
+    UcaAccumulatorPrivate *priv;
+    guint64 count;
+    gsize n_pixels;
+
+    g_return_val_if_fail (UCA_IS_ACCUMULATOR (accumulator), FALSE);
+
+    priv = accumulator->priv;
+
+    g_rw_lock_writer_lock (&priv->lock);
+
+    if (priv->blocks == NULL) {
+        g_rw_lock_writer_unlock (&priv->lock);
+        return FALSE;
+    }
+
+    if (width != NULL)
+        *width = priv->width;
+
+    if (height != NULL)
+        *height = priv->height;
+
+    count = priv->blocks[0].count;
+    n_pixels = (gsize) priv->width * priv->height;
+
+    for (gsize i = 0; output != NULL && i < n_pixels; i++)
+        output[i] = get_value (priv, statistic, i, count);
+
+    g_rw_lock_writer_unlock (&priv->lock);
+    return TRUE;
+}
+
+/**
+ * uca_accumulator_get_frame:
+ * @accumulator: A #UcaAccumulator
+ * @statistic: Which statistic to get
+ *
+ * Get a per-pixel statistic as a 16-bit frame. Values are rounded and
+ * clamped to the 16-bit range, the sequence number of the frame is the
+ * number of frames added.
+ *
+ * Returns: (transfer full): A new #UcaFrame or %NULL if no frame has been
+ * added.
+ * Since: 2.4
+ */
+UcaFrame *
+uca_accumulator_get_frame (UcaAccumulator *accumulator, UcaAccumulatorStatistic statistic)
+{
+    UcaAccumulatorPrivate *priv;
+    UcaFrameInfo info;
+    UcaFrame *frame;
+    guint16 *data;
+    guint64 count;
+    gsize n_pixels;
+
+    g_return_val_if_fail (UCA_IS_ACCUMULATOR (accumulator), NULL);
+
+    priv = accumulator->priv;
+
+    g_rw_lock_writer_lock (&priv->lock);
+
+    if (priv->blocks == NULL) {
+        g_rw_lock_writer_unlock (&priv->lock);
+        return NULL;
+    }
+
+    count = priv->blocks[0].count;
+    uca_frame_info_init (&info, priv->width, priv->height, 16);
+    info.sequence = count;
+    frame = uca_frame_new (&info);
+    data = uca_frame_get_data (frame);
+    n_pixels = (gsize) priv->width * priv->height;
+
+    for (gsize i = 0; i < n_pixels; i++) {
+        gfloat value = get_value (priv, statistic, i, count) + 0.5f;
+
+        data[i] = value > 0.0f ? (value < G_MAXUINT16 ? (guint16) value : G_MAXUINT16) : 0;
+    }
+
+    g_rw_lock_writer_unlock (&priv->lock);
+    return frame;
+}
+
+static gboolean
+uca_accumulator_process (UcaFilter *filter, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    return uca_accumulator_add (UCA_ACCUMULATOR (filter), data, info, error);
+}
+
+static void
+uca_accumulator_finalize (GObject *object)
+{
+    UcaAccumulatorPrivate *priv;
+
+    priv = UCA_ACCUMULATOR_GET_PRIVATE (object);
+    free_statistics (priv);
+    g_rw_lock_clear (&priv->lock);
+
+    G_OBJECT_CLASS (uca_accumulator_parent_class)->finalize (object);
+}
+
+static void
+uca_accumulator_interface_init (UcaFilterInterface *iface)
+{
+    iface->process = uca_accumulator_process;
+}
+
+static void
+uca_accumulator_class_init (UcaAccumulatorClass *klass)
+{
+    GObjectClass *oclass = G_OBJECT_CLASS (klass);
+
+    oclass->finalize = uca_accumulator_finalize;
+
+    g_type_class_add_private (klass, sizeof (UcaAccumulatorPrivate));
+
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init ();
+    have_avx2 = __builtin_cpu_supports ("avx2");
+#endif
+}
+
+static void
+uca_accumulator_init (UcaAccumulator *accumulator)
+{
+    UcaAccumulatorPrivate *priv;
+
+    accumulator->priv = priv = UCA_ACCUMULATOR_GET_PRIVATE (accumulator);
+    g_rw_lock_init (&priv->lock);
+    priv->n_blocks = 0;
+    priv->blocks = NULL;
+    priv->mean = NULL;
+    priv->m2 = NULL;
+    priv->min = NULL;
+    priv->max = NULL;
+    priv->width = 0;
+    priv->height = 0;
+}
@@ -0,0 +1,72 @@
+#ifndef UCA_ACCUMULATOR_H
+#define UCA_ACCUMULATOR_H
+
+#include <glib-object.h>
+#include "uca-camera.h"
+
+#define UCA_TYPE_ACCUMULATOR             (uca_accumulator_get_type())
+#define UCA_ACCUMULATOR(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_ACCUMULATOR, UcaAccumulator))
+#define UCA_IS_ACCUMULATOR(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_ACCUMULATOR))
+#define UCA_ACCUMULATOR_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_ACCUMULATOR, UcaAccumulatorClass))
+#define UCA_IS_ACCUMULATOR_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_ACCUMULATOR))
+#define UCA_ACCUMULATOR_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_ACCUMULATOR, UcaAccumulatorClass))
+
+G_BEGIN_DECLS
+
+/**
+ * UcaAccumulatorStatistic:
+ * @UCA_ACCUMULATOR_MEAN: Mean of each pixel
+ * @UCA_ACCUMULATOR_VARIANCE: Sample variance of each pixel
+ * @UCA_ACCUMULATOR_MIN: Smallest value of each pixel
+ * @UCA_ACCUMULATOR_MAX: Largest value of each pixel
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_ACCUMULATOR_MEAN,
+    UCA_ACCUMULATOR_VARIANCE,
+    UCA_ACCUMULATOR_MIN,
+    UCA_ACCUMULATOR_MAX,
+} UcaAccumulatorStatistic;
+
+typedef struct _UcaAccumulator           UcaAccumulator;
+typedef struct _UcaAccumulatorClass      UcaAccumulatorClass;
+typedef struct _UcaAccumulatorPrivate    UcaAccumulatorPrivate;
+
+struct _UcaAccumulator {
+    /*< private >*/
+    GObject parent;
+
+    UcaAccumulatorPrivate *priv;
+};
+
+struct _UcaAccumulatorClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UcaAccumulator *
+            uca_accumulator_new             (void);
+gboolean    uca_accumulator_add             (UcaAccumulator         *accumulator,
+                                             gconstpointer           data,
+                                             const UcaFrameInfo     *info,
+                                             GError                **error);
+gboolean    uca_accumulator_acquire         (UcaAccumulator         *accumulator,
+                                             UcaCamera              *camera,
+                                             guint                   n_frames,
+                                             GError                **error);
+void        uca_accumulator_reset           (UcaAccumulator         *accumulator);
+guint64     uca_accumulator_get_count       (UcaAccumulator         *accumulator);
+gboolean    uca_accumulator_get_statistic   (UcaAccumulator         *accumulator,
+                                             UcaAccumulatorStatistic statistic,
+                                             gfloat                 *output,
+                                             guint                  *width,
+                                             guint                  *height);
+UcaFrame *  uca_accumulator_get_frame       (UcaAccumulator         *accumulator,
+                                             UcaAccumulatorStatistic statistic);
+
+GType uca_accumulator_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,400 @@
+/* Copyright (C) 2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-binning-filter
+ * @Short_description: Software binning
+ * @Title: UcaBinningFilter
+ *
+ * A #UcaFilter that replaces each block of #UcaBinningFilter:horizontal times
+ * #UcaBinningFilter:vertical pixels by their rounded mean, for cameras whose
+ * hardware cannot bin. Frames shrink accordingly and pixels that do not fill
+ * a complete block at the right and bottom edges are dropped. The frame is
+ * binned in place.
+ *
+ * Summing the rows of a block, which touches every input pixel, uses AVX2 on
+ * x86 processors supporting it and NEON on ARM, with a scalar fallback.
+ */
+
+#include <string.h>
+#include "uca-binning-filter.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+#define UCA_BINNING_FILTER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_BINNING_FILTER, UcaBinningFilterPrivate))
+
+static void uca_binning_filter_interface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UcaBinningFilter, uca_binning_filter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_binning_filter_interface_init))
+
+enum {
+    PROP_0,
+    PROP_HORIZONTAL,
+    PROP_VERTICAL,
+    N_PROPERTIES
+};
+
+static GParamSpec *filter_properties[N_PROPERTIES] = { NULL, };
+
+#ifdef HAVE_AVX2_KERNELS
+static gboolean have_avx2 = FALSE;
+#endif
+
+struct _UcaBinningFilterPrivate {
+    guint horizontal;
+    guint vertical;
+};
+
+/**
+ * uca_binning_filter_new:
+ * @horizontal: Number of pixels binned horizontally
+ * @vertical: Number of pixels binned vertically
+ *
+ * Returns: (transfer full): A new #UcaBinningFilter.
+ * Since: 2.4
+ */
+UcaFilter *
+uca_binning_filter_new (guint horizontal, guint vertical)
+{
+    return UCA_FILTER (g_object_new (UCA_TYPE_BINNING_FILTER,
+                                     "horizontal", horizontal,
+                                     "vertical", vertical,
+                                     NULL));
+}
+
+/*
+ * Rows are first summed into 32-bit column sums, which are then reduced
+ * horizontally. The vector kernels add as many pixels of a row as fit into
+ * full vectors and return how many they did, the rest is left to the scalar
+ * loop.
+ */
+#ifdef HAVE_AVX2_KERNELS
+__attribute__ ((target ("avx2")))
+static guint
+add_row_8_avx2 (const guint8 *row, guint32 *sums, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) (row + i)));
+        __m256i s = _mm256_loadu_si256 ((const __m256i *) (sums + i));
+        _mm256_storeu_si256 ((__m256i *) (sums + i), _mm256_add_epi32 (s, x));
+    }
+
+    return i;
+}
+
+__attribute__ ((target ("avx2")))
+static guint
+add_row_16_avx2 (const guint16 *row, guint32 *sums, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *) (row + i)));
+        __m256i s = _mm256_loadu_si256 ((const __m256i *) (sums + i));
+        _mm256_storeu_si256 ((__m256i *) (sums + i), _mm256_add_epi32 (s, x));
+    }
+
+    return i;
+}
+#endif
+
+#ifdef HAVE_NEON_KERNELS
+static guint
+add_row_8_neon (const guint8 *row, guint32 *sums, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        uint16x8_t x = vmovl_u8 (vld1_u8 (row + i));
+        vst1q_u32 (sums + i, vaddw_u16 (vld1q_u32 (sums + i), vget_low_u16 (x)));
+        vst1q_u32 (sums + i + 4, vaddw_u16 (vld1q_u32 (sums + i + 4), vget_high_u16 (x)));
+    }
+
+    return i;
+}
+
+static guint
+add_row_16_neon (const guint16 *row, guint32 *sums, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        uint16x8_t x = vld1q_u16 (row + i);
+        vst1q_u32 (sums + i, vaddw_u16 (vld1q_u32 (sums + i), vget_low_u16 (x)));
+        vst1q_u32 (sums + i + 4, vaddw_u16 (vld1q_u32 (sums + i + 4), vget_high_u16 (x)));
+    }
+
+    return i;
+}
+#endif
+
+static void
+add_row_8 (const guint8 *row, guint32 *sums, guint n)
+{
+    guint i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = add_row_8_avx2 (row, sums, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = add_row_8_neon (row, sums, n);
+#endif
+
+    for (; i < n; i++)
+        sums[i] += row[i];
+}
+
+static void
+add_row_16 (const guint16 *row, guint32 *sums, guint n)
+{
+    guint i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = add_row_16_avx2 (row, sums, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = add_row_16_neon (row, sums, n);
+#endif
+
+    for (; i < n; i++)
+        sums[i] += row[i];
+}
+
+static void
+sum_rows_8 (const guint8 *src, gsize stride, guint n_rows, guint32 *sums, guint n)
+{
+    memset (sums, 0, n * sizeof (guint32));
+
+    for (guint r = 0; r < n_rows; r++)
+        add_row_8 (src + r * stride, sums, n);
+}
+
+static void
+sum_rows_16 (const guint16 *src, gsize stride, guint n_rows, guint32 *sums, guint n)
+{
+    memset (sums, 0, n * sizeof (guint32));
+
+    for (guint r = 0; r < n_rows; r++)
+        add_row_16 ((const guint16 *) (((const guint8 *) src) + r * stride), sums, n);
+}
+
+/* Common block widths have their own loops so that the stride is constant */
+static void
+sum_columns (guint32 *sums, guint n_columns, guint n)
+{
+    if (n_columns == 2) {
+        for (guint i = 0; i < n; i++)
+            sums[i] = sums[2 * i] + sums[2 * i + 1];
+    }
+    else if (n_columns == 4) {
+        for (guint i = 0; i < n; i++)
+            sums[i] = sums[4 * i] + sums[4 * i + 1] + sums[4 * i + 2] + sums[4 * i + 3];
+    }
+    else if (n_columns > 1) {
+        for (guint i = 0; i < n; i++) {
+            guint32 sum = 0;
+
+            for (guint c = 0; c < n_columns; c++)
+                sum += sums[n_columns * i + c];
+
+            sums[i] = sum;
+        }
+    }
+}
+
+#define STORE_MEANS(type)                                                   \
+    {                                                                       \
+        type *restrict out = (type *) dst;                                  \
+                                                                            \
+        if (shift >= 0) {                                                   \
+            for (guint i = 0; i < n; i++)                                   \
+                out[i] = (type) ((sums[i] + half) >> shift);                \
+        }                                                                   \
+        else {                                                              \
+            for (guint i = 0; i < n; i++)                                   \
+                out[i] = (type) ((sums[i] + half) / n_pixels);              \
+        }                                                                   \
+    }
+
+static void
+store_means (gpointer dst, UcaPixelFormat format, const guint32 *restrict sums, guint n_pixels, guint n)
+{
+    guint32 half = n_pixels / 2;
+    gint shift = -1;
+
+    /* Blocks of 2x2 and 4x4 pixels divide by shifting */
+    if ((n_pixels & (n_pixels - 1)) == 0)
+        shift = g_bit_nth_lsf (n_pixels, -1);
+
+    if (format == UCA_PIXEL_FORMAT_MONO8)
+        STORE_MEANS (guint8)
+    else
+        STORE_MEANS (guint16)
+}
+
+static gboolean
+uca_binning_filter_process (UcaFilter *filter, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    UcaBinningFilterPrivate *priv;
+    guint horizontal, vertical;
+    guint width, height;
+    gsize pixel_size;
+    guint32 *sums;
+
+    priv = UCA_BINNING_FILTER (filter)->priv;
+    horizontal = priv->horizontal;
+    vertical = priv->vertical;
+
+    if (horizontal == 1 && vertical == 1)
+        return TRUE;
+
+    width = info->width / horizontal;
+    height = info->height / vertical;
+    pixel_size = info->format == UCA_PIXEL_FORMAT_MONO8 ? 1 : 2;
+
+    if (width == 0 || height == 0) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                     "Frame of %ux%u is smaller than a %ux%u block",
+                     info->width, info->height, horizontal, vertical);
+        return FALSE;
+    }
+
+    sums = g_new (guint32, width * horizontal);
+
+    /*
+     * Output row y is written before input rows beyond y * vertical are read
+     * but never overlaps them, so binning works in place.
+     */
+    for (guint y = 0; y < height; y++) {
+        const guint8 *src = ((const guint8 *) data) + (gsize) y * vertical * info->stride;
+        guint8 *dst = ((guint8 *) data) + (gsize) y * width * pixel_size;
+
+        if (info->format == UCA_PIXEL_FORMAT_MONO8)
+            sum_rows_8 (src, info->stride, vertical, sums, width * horizontal);
+        else
+            sum_rows_16 ((const guint16 *) src, info->stride, vertical, sums, width * horizontal);
+
+        sum_columns (sums, horizontal, width);
+        store_means (dst, info->format, sums, horizontal * vertical, width);
+    }
+
+    g_free (sums);
+
+    info->width = width;
+    info->height = height;
+    info->stride = width * pixel_size;
+
+    return TRUE;
+}
+
+static void
+uca_binning_filter_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+    UcaBinningFilterPrivate *priv = UCA_BINNING_FILTER_GET_PRIVATE (object);
+
+    switch (property_id) {
+        case PROP_HORIZONTAL:
+            priv->horizontal = g_value_get_uint (value);
+            break;
+        case PROP_VERTICAL:
+            priv->vertical = g_value_get_uint (value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            return;
+    }
+}
+
+static void
+uca_binning_filter_get_property (GObject *object, guint property_id, GValue *value, GParamSpec *pspec)
+{
+    UcaBinningFilterPrivate *priv = UCA_BINNING_FILTER_GET_PRIVATE (object);
+
+    switch (property_id) {
+        case PROP_HORIZONTAL:
+            g_value_set_uint (value, priv->horizontal);
+            break;
+        case PROP_VERTICAL:
+            g_value_set_uint (value, priv->vertical);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            return;
+    }
+}
+
+static void
+uca_binning_filter_interface_init (UcaFilterInterface *iface)
+{
+    iface->process = uca_binning_filter_process;
+}
+
+static void
+uca_binning_filter_class_init (UcaBinningFilterClass *klass)
+{
+    GObjectClass *oclass = G_OBJECT_CLASS (klass);
+
+    oclass->set_property = uca_binning_filter_set_property;
+    oclass->get_property = uca_binning_filter_get_property;
+
+    /* 64 * 64 * G_MAXUINT16 still fits the 32-bit sums */
+    filter_properties[PROP_HORIZONTAL] =
+        g_param_spec_uint ("horizontal",
+            "Number of pixels binned horizontally",
+            "Number of pixels binned horizontally",
+            1, 64, 2,
+            G_PARAM_READWRITE);
+
+    filter_properties[PROP_VERTICAL] =
+        g_param_spec_uint ("vertical",
+            "Number of pixels binned vertically",
+            "Number of pixels binned vertically",
+            1, 64, 2,
+            G_PARAM_READWRITE);
+
+    for (guint id = PROP_0 + 1; id < N_PROPERTIES; id++)
+        g_object_class_install_property (oclass, id, filter_properties[id]);
+
+    g_type_class_add_private (klass, sizeof (UcaBinningFilterPrivate));
+
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init ();
+    have_avx2 = __builtin_cpu_supports ("avx2");
+#endif
+}
+
+static void
+uca_binning_filter_init (UcaBinningFilter *filter)
+{
+    filter->priv = UCA_BINNING_FILTER_GET_PRIVATE (filter);
+    filter->priv->horizontal = 2;
+    filter->priv->vertical = 2;
+}
@@ -0,0 +1,39 @@
+#ifndef UCA_BINNING_FILTER_H
+#define UCA_BINNING_FILTER_H
+
+#include <glib-object.h>
+#include "uca-filter.h"
+
+#define UCA_TYPE_BINNING_FILTER             (uca_binning_filter_get_type())
+#define UCA_BINNING_FILTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_BINNING_FILTER, UcaBinningFilter))
+#define UCA_IS_BINNING_FILTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_BINNING_FILTER))
+#define UCA_BINNING_FILTER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_BINNING_FILTER, UcaBinningFilterClass))
+#define UCA_IS_BINNING_FILTER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_BINNING_FILTER))
+#define UCA_BINNING_FILTER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_BINNING_FILTER, UcaBinningFilterClass))
+
+G_BEGIN_DECLS
+
+typedef struct _UcaBinningFilter           UcaBinningFilter;
+typedef struct _UcaBinningFilterClass      UcaBinningFilterClass;
+typedef struct _UcaBinningFilterPrivate    UcaBinningFilterPrivate;
+
+struct _UcaBinningFilter {
+    /*< private >*/
+    GObject parent;
+
+    UcaBinningFilterPrivate *priv;
+};
+
+struct _UcaBinningFilterClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UcaFilter * uca_binning_filter_new (guint horizontal,
+                                   guint vertical);
+
+GType uca_binning_filter_get_type (void);
+
+G_END_DECLS
+
+#endif
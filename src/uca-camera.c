@@ -23,6 +23,11 @@
  * UcaCamera is the base camera from which a real hardware camera derives from.
  */
 
+/* Needed for sched_setaffinity() and syscall() with -std=c99 */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
 #include "config.h"
 
 #ifdef WITH_PYTHON_MULTITHREADING
@@ -32,6 +37,15 @@
 #include <glib.h>
 #include <string.h>
 #include <stdlib.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include "compat.h"
 #include "uca-camera.h"
 #include "uca-ring-buffer.h"
@@ -134,11 +148,40 @@ const gchar *uca_camera_props[N_BASE_PROPERTIES] = {
     "is-readout",
     "buffered",
     "num-buffers",
+    "buffer-alloc-flags",
+    "buffer-alignment",
+    "buffer-numa-node",
+    "buffer-policy",
+    "buffer-overruns",
+    "buffer-max-fill",
+    "delivery-threads",
+    "delivery-ordered",
+    "delivery-queue-length",
+    "delivery-drops",
+    "filter-threads",
+    "event-gating",
+    "event-pre-frames",
+    "event-post-frames",
+    "grab-mode",
+    "grab-skipped",
+    "thread-cpus",
+    "thread-priority",
+    "thread-numa-node",
 };
 
+/*
+ * Time in microseconds a buffered grab sleeps before checking if the read
+ * thread is still alive.
+ */
+#define BUFFERED_GRAB_POLL_TIMEOUT  (G_USEC_PER_SEC / 10)
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
 static GParamSpec *camera_properties[N_BASE_PROPERTIES] = { NULL, };
-static GMutex access_lock;
 static gboolean str_to_boolean (const gchar *s);
+static gboolean borrow_frame (UcaCamera *camera, gpointer *frame, GCancellable *cancellable, GError **error);
 
 #define DEFINE_CAST(suffix, trans_func)                 \
 static void                                             \
@@ -161,15 +204,195 @@ DEFINE_CAST (enum,      atoi)
 DEFINE_CAST (boolean,   str_to_boolean)
 
 
+typedef struct {
+    GParamSpec *pspec;
+    GValue value;
+} QueuedProperty;
+
+typedef struct {
+    guint64 sequence;
+    gpointer data;
+} DeliveryItem;
+
+/*
+ * A frame passing through the filter chain. Unless it is held back for event
+ * gating, data and metadata point into a staged ring buffer block, so the
+ * chain runs in place. Otherwise they point to the item's own storage.
+ */
+typedef struct {
+    guint64 sequence;
+    gpointer data;
+    UcaFrameInfo info;
+    UcaRingBufferMetadata *metadata;
+    gpointer storage;
+    UcaRingBufferMetadata storage_metadata;
+} FilterItem;
+
+/*
+ * Threads that handle queued items in the order they were pushed. Unlike the
+ * workers of a GThreadPool, they end when they are freed, so that placement
+ * from uca_camera_setup_thread() never reaches threads GLib hands to others.
+ */
+typedef struct {
+    UcaCamera *camera;
+    GFunc func;
+    gboolean placed;
+    GAsyncQueue *queue;
+    GThread **threads;
+    guint n_threads;
+} Workers;
+
 struct _UcaCameraPrivate {
+    /*
+     * access_lock serializes calls into the plugin, the others serialize the
+     * public entry points. All of them are per camera so that independent
+     * cameras do not wait for each other.
+     */
+    GMutex access_lock;
+    GMutex recording_lock;
+    GMutex readout_lock;
+    GMutex trigger_lock;
+    GMutex grab_lock;
+    GMutex property_lock;
+
+    /*
+     * Thread that set properties with uca_camera_set_properties() and has not
+     * committed them yet. Other threads set properties as usual meanwhile.
+     */
+    GThread *batch_thread;
+
+    /*
+     * Property changes made during recording, applied between two frames.
+     * n_queued lets the acquisition path check for them without locking.
+     */
+    GMutex queue_lock;
+    GArray *queued;
+    volatile gint n_queued;
+
+    /* Thread in uca_camera_apply_queued_properties(), which bypasses the queue */
+    GThread *applying_thread;
+
     gboolean cancelling_recording;
+    GCancellable *cancellable;
     gboolean is_recording;
     gboolean is_readout;
     gboolean transfer_async;
     gboolean buffered;
     guint num_buffers;
+    UcaRingBufferAllocFlags buffer_alloc_flags;
+    guint buffer_alignment;
+    gint buffer_numa_node;
+    UcaRingBufferPolicy buffer_policy;
+
+    /*
+     * Frame metadata that does not change between frames and the frame
+     * geometry, both kept up to date from notify so that the hot path does
+     * not query properties
+     */
+    GMutex metadata_lock;
+    UcaRingBufferMetadata metadata_template;
+    UcaCameraGeometry geometry;
+    gboolean geometry_valid;
+    guint geometry_serial;
+    UcaRingBufferMetadata last_metadata;
+    guint64 n_grabbed;
+
+    /*
+     * Geometry of the frames of the current recording or readout and the
+     * size they were allocated for, which queued updates must not exceed
+     */
+    UcaFrameInfo frame_info;
+    gsize max_frame_size;
     GThread *read_thread;
+    volatile gint read_thread_finished;
+    volatile gint freeze_requested;
+    guint n_post_frames;
+    gboolean frozen;
+
+    /*
+     * TRUE while uca_camera_freeze() waits for the read thread without
+     * holding recording_lock, freeze_cond is signalled when it is done
+     */
+    gboolean freezing;
+    GCond freeze_cond;
     UcaRingBuffer *ring_buffer;
+
+    /*
+     * Ring buffers replaced while frames were still borrowed from them, kept
+     * until the last one is released. buffer_lock protects both pointers
+     * against releases from other threads.
+     */
+    GMutex buffer_lock;
+    GSList *retired_buffers;
+
+    /*
+     * Placement of the threads that acquire and deliver frames, applied by
+     * uca_camera_setup_thread(). thread_lock protects them because plugin
+     * threads may read them while the properties are set.
+     */
+    GMutex thread_lock;
+    gchar *thread_cpus;
+    guint thread_priority;
+    gint thread_numa_node;
+
+    /*
+     * Grabs started with uca_camera_grab_async() run one at a time on a
+     * worker of this camera rather than in the shared GTask pool, where a
+     * blocked grab would hold a thread other GIO users need
+     */
+    GThreadPool *grab_pool;
+
+    /* Unread frames that grabbing the latest frame has skipped */
+    UcaCameraGrabMode grab_mode;
+    gsize grab_skipped;
+
+    /* Readable while frames can be borrowed, -1 until requested */
+    volatile gint frame_fd;
+
+    /*
+     * Asynchronously transferred frames are copied into one of
+     * delivery_queue_length items and handed to a pool of delivery_threads
+     * that call grab_func. delivery_lock protects the counters.
+     */
+    guint delivery_threads;
+    gboolean delivery_ordered;
+    guint delivery_queue_length;
+    Workers *delivery_workers;
+    GAsyncQueue *delivery_free;
+    DeliveryItem *delivery_borrowed;
+    GMutex delivery_lock;
+    GCond delivery_cond;
+    guint64 delivery_next_sequence;
+    guint64 delivery_next_start;
+    guint64 delivery_drops;
+
+    /*
+     * Filters added by the user and the chain applied during the current
+     * recording, which is fixed at start so that frames need no locking. With
+     * buffering, frames are grabbed into staged ring buffer blocks, filtered
+     * in place by a pool of filter_threads and committed in order. Only event
+     * gating grabs into separate items, because it must hold frames back.
+     */
+    GMutex filter_lock;
+    GPtrArray *filters;
+    GPtrArray *active_filters;
+    guint filter_threads;
+    Workers *filter_workers;
+    GAsyncQueue *filter_free;
+    GCond filter_cond;
+    guint64 filter_next_publish;
+    GError *filter_error;
+
+    /*
+     * With event_gating, only frames that filters marked as triggered and
+     * the event_pre_frames before and event_post_frames after them are
+     * published. The publishing worker holds recent items back as history.
+     */
+    gboolean event_gating;
+    guint event_pre_frames;
+    guint event_post_frames;
+    GQueue *event_history;
+    guint event_post_remaining;
     UcaCameraTriggerSource trigger_source;
     UcaCameraTriggerType trigger_type;
 };
@@ -198,11 +421,19 @@ uca_camera_set_property (GObject *object, guint property_id, const GValue *value
 {
     UcaCameraPrivate *priv = UCA_CAMERA_GET_PRIVATE(object);
 
-    if (priv->is_recording) {
+    /* Only the trigger and frame rate can be changed between two frames */
+    if (priv->is_recording &&
+        property_id != PROP_FRAMES_PER_SECOND &&
+        property_id != PROP_TRIGGER_SOURCE &&
+        property_id != PROP_TRIGGER_TYPE &&
+        property_id != PROP_GRAB_MODE) {
         g_warning("You cannot change properties during data acquisition");
         return;
     }
 
+    if (uca_camera_queue_property (UCA_CAMERA (object), pspec, value))
+        return;
+
     switch (property_id) {
         case PROP_TRANSFER_ASYNCHRONOUSLY:
             priv->transfer_async = g_value_get_boolean(value);
@@ -232,6 +463,82 @@ uca_camera_set_property (GObject *object, guint property_id, const GValue *value
             priv->num_buffers = g_value_get_uint (value);
             break;
 
+        case PROP_BUFFER_ALLOC_FLAGS:
+            priv->buffer_alloc_flags = g_value_get_flags (value);
+            break;
+
+        case PROP_BUFFER_ALIGNMENT:
+            if (!uca_ring_buffer_alignment_is_valid (g_value_get_uint (value))) {
+                g_warning ("Alignment of %u bytes is not a power of two of at least the page size",
+                           g_value_get_uint (value));
+                return;
+            }
+
+            priv->buffer_alignment = g_value_get_uint (value);
+            break;
+
+        case PROP_BUFFER_NUMA_NODE:
+            priv->buffer_numa_node = g_value_get_int (value);
+            break;
+
+        case PROP_BUFFER_POLICY:
+            priv->buffer_policy = g_value_get_enum (value);
+
+            if (priv->ring_buffer != NULL)
+                g_object_set (priv->ring_buffer, "policy", priv->buffer_policy, NULL);
+            break;
+
+        case PROP_DELIVERY_THREADS:
+            priv->delivery_threads = g_value_get_uint (value);
+            break;
+
+        case PROP_DELIVERY_ORDERED:
+            priv->delivery_ordered = g_value_get_boolean (value);
+            break;
+
+        case PROP_DELIVERY_QUEUE_LENGTH:
+            priv->delivery_queue_length = g_value_get_uint (value);
+            break;
+
+        case PROP_FILTER_THREADS:
+            priv->filter_threads = g_value_get_uint (value);
+            break;
+
+        case PROP_EVENT_GATING:
+            priv->event_gating = g_value_get_boolean (value);
+            break;
+
+        case PROP_EVENT_PRE_FRAMES:
+            priv->event_pre_frames = g_value_get_uint (value);
+            break;
+
+        case PROP_EVENT_POST_FRAMES:
+            priv->event_post_frames = g_value_get_uint (value);
+            break;
+
+        case PROP_GRAB_MODE:
+            priv->grab_mode = g_value_get_enum (value);
+            break;
+
+        case PROP_THREAD_CPUS:
+            g_mutex_lock (&priv->thread_lock);
+            g_free (priv->thread_cpus);
+            priv->thread_cpus = g_value_dup_string (value);
+            g_mutex_unlock (&priv->thread_lock);
+            break;
+
+        case PROP_THREAD_PRIORITY:
+            g_mutex_lock (&priv->thread_lock);
+            priv->thread_priority = g_value_get_uint (value);
+            g_mutex_unlock (&priv->thread_lock);
+            break;
+
+        case PROP_THREAD_NUMA_NODE:
+            g_mutex_lock (&priv->thread_lock);
+            priv->thread_numa_node = g_value_get_int (value);
+            g_mutex_unlock (&priv->thread_lock);
+            break;
+
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
     }
@@ -314,11 +621,179 @@ uca_camera_get_property(GObject *object, guint property_id, GValue *value, GPara
             g_value_set_uint (value, priv->num_buffers);
             break;
 
+        case PROP_BUFFER_ALLOC_FLAGS:
+            g_value_set_flags (value, priv->buffer_alloc_flags);
+            break;
+
+        case PROP_BUFFER_ALIGNMENT:
+            g_value_set_uint (value, priv->buffer_alignment);
+            break;
+
+        case PROP_BUFFER_NUMA_NODE:
+            g_value_set_int (value, priv->buffer_numa_node);
+            break;
+
+        case PROP_BUFFER_POLICY:
+            g_value_set_enum (value, priv->buffer_policy);
+            break;
+
+        case PROP_BUFFER_OVERRUNS:
+            g_value_set_uint64 (value, priv->ring_buffer != NULL ? uca_ring_buffer_get_overruns (priv->ring_buffer) : 0);
+            break;
+
+        case PROP_BUFFER_MAX_FILL:
+            g_value_set_uint (value, priv->ring_buffer != NULL ? uca_ring_buffer_get_max_fill (priv->ring_buffer) : 0);
+            break;
+
+        case PROP_DELIVERY_THREADS:
+            g_value_set_uint (value, priv->delivery_threads);
+            break;
+
+        case PROP_DELIVERY_ORDERED:
+            g_value_set_boolean (value, priv->delivery_ordered);
+            break;
+
+        case PROP_DELIVERY_QUEUE_LENGTH:
+            g_value_set_uint (value, priv->delivery_queue_length);
+            break;
+
+        case PROP_DELIVERY_DROPS:
+            g_mutex_lock (&priv->delivery_lock);
+            g_value_set_uint64 (value, priv->delivery_drops);
+            g_mutex_unlock (&priv->delivery_lock);
+            break;
+
+        case PROP_FILTER_THREADS:
+            g_value_set_uint (value, priv->filter_threads);
+            break;
+
+        case PROP_EVENT_GATING:
+            g_value_set_boolean (value, priv->event_gating);
+            break;
+
+        case PROP_EVENT_PRE_FRAMES:
+            g_value_set_uint (value, priv->event_pre_frames);
+            break;
+
+        case PROP_EVENT_POST_FRAMES:
+            g_value_set_uint (value, priv->event_post_frames);
+            break;
+
+        case PROP_GRAB_MODE:
+            g_value_set_enum (value, priv->grab_mode);
+            break;
+
+        case PROP_GRAB_SKIPPED:
+            g_value_set_uint64 (value, (guint64) g_atomic_pointer_get (&priv->grab_skipped));
+            break;
+
+        case PROP_THREAD_CPUS:
+            g_mutex_lock (&priv->thread_lock);
+            g_value_set_string (value, priv->thread_cpus);
+            g_mutex_unlock (&priv->thread_lock);
+            break;
+
+        case PROP_THREAD_PRIORITY:
+            g_value_set_uint (value, priv->thread_priority);
+            break;
+
+        case PROP_THREAD_NUMA_NODE:
+            g_value_set_int (value, priv->thread_numa_node);
+            break;
+
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
     }
 }
 
+static void
+update_metadata_template (UcaCamera *camera)
+{
+    UcaCameraPrivate *priv;
+    guint roi_x, roi_y, roi_width, roi_height;
+    gdouble exposure_time;
+
+    priv = camera->priv;
+
+    g_object_get (camera,
+                  "roi-x0", &roi_x,
+                  "roi-y0", &roi_y,
+                  "roi-width", &roi_width,
+                  "roi-height", &roi_height,
+                  "exposure-time", &exposure_time,
+                  NULL);
+
+    g_mutex_lock (&priv->metadata_lock);
+    priv->metadata_template.roi_x = roi_x;
+    priv->metadata_template.roi_y = roi_y;
+    priv->metadata_template.roi_width = roi_width;
+    priv->metadata_template.roi_height = roi_height;
+    priv->metadata_template.exposure_time = exposure_time;
+    g_mutex_unlock (&priv->metadata_lock);
+}
+
+/*
+ * Fill in the metadata of a frame that has just been acquired and whose
+ * acquisition started at start_time. The sequence number is left to the
+ * caller.
+ */
+static void
+fill_metadata (UcaCamera *camera, UcaRingBufferMetadata *metadata, gint64 start_time)
+{
+    gint64 timestamp;
+
+    timestamp = g_get_monotonic_time ();
+
+    g_mutex_lock (&camera->priv->metadata_lock);
+    *metadata = camera->priv->metadata_template;
+    metadata->bitdepth = camera->priv->frame_info.bitdepth;
+    metadata->size = uca_frame_info_get_size (&camera->priv->frame_info);
+    g_mutex_unlock (&camera->priv->metadata_lock);
+
+    metadata->timestamp = timestamp;
+    metadata->start_timestamp = start_time;
+}
+
+static void
+invalidate_geometry (UcaCamera *camera)
+{
+    g_mutex_lock (&camera->priv->metadata_lock);
+    camera->priv->geometry_valid = FALSE;
+    camera->priv->geometry_serial++;
+    g_mutex_unlock (&camera->priv->metadata_lock);
+}
+
+static void
+uca_camera_notify (GObject *object, GParamSpec *pspec)
+{
+    /* Keep the metadata template in sync, so we do not query it per frame */
+    if (!g_strcmp0 (pspec->name, uca_camera_props[PROP_EXPOSURE_TIME]) ||
+        !g_strcmp0 (pspec->name, uca_camera_props[PROP_ROI_X]) ||
+        !g_strcmp0 (pspec->name, uca_camera_props[PROP_ROI_Y]) ||
+        !g_strcmp0 (pspec->name, uca_camera_props[PROP_ROI_WIDTH]) ||
+        !g_strcmp0 (pspec->name, uca_camera_props[PROP_ROI_HEIGHT]))
+        update_metadata_template (UCA_CAMERA (object));
+
+    if (!g_strcmp0 (pspec->name, uca_camera_props[PROP_ROI_WIDTH]) ||
+        !g_strcmp0 (pspec->name, uca_camera_props[PROP_ROI_HEIGHT]) ||
+        !g_strcmp0 (pspec->name, uca_camera_props[PROP_SENSOR_BITDEPTH]) ||
+        !g_strcmp0 (pspec->name, uca_camera_props[PROP_SENSOR_HORIZONTAL_BINNING]) ||
+        !g_strcmp0 (pspec->name, uca_camera_props[PROP_SENSOR_VERTICAL_BINNING]))
+        invalidate_geometry (UCA_CAMERA (object));
+
+    if (G_OBJECT_CLASS (uca_camera_parent_class)->notify != NULL)
+        G_OBJECT_CLASS (uca_camera_parent_class)->notify (object, pspec);
+}
+
+static void
+free_queued (GArray *queued)
+{
+    for (guint i = 0; i < queued->len; i++)
+        g_value_unset (&g_array_index (queued, QueuedProperty, i).value);
+
+    g_array_free (queued, TRUE);
+}
+
 static void
 uca_camera_dispose (GObject *object)
 {
@@ -331,12 +806,27 @@ uca_camera_dispose (GObject *object)
         priv->ring_buffer = NULL;
     }
 
+    g_slist_free_full (priv->retired_buffers, g_object_unref);
+    priv->retired_buffers = NULL;
+
+    /* Pending grabs hold a reference, so the pool is idle by now */
+    if (priv->grab_pool != NULL) {
+        g_thread_pool_free (priv->grab_pool, TRUE, FALSE);
+        priv->grab_pool = NULL;
+    }
+
+    if (priv->filters != NULL) {
+        g_ptr_array_unref (priv->filters);
+        priv->filters = NULL;
+    }
+
     G_OBJECT_CLASS (uca_camera_parent_class)->dispose (object);
 }
 
 static void
 uca_camera_finalize (GObject *object)
 {
+    UcaCameraPrivate *priv;
     GParamSpec **props;
     guint n_props;
 
@@ -349,6 +839,33 @@ uca_camera_finalize (GObject *object)
 
     g_free (props);
 
+    priv = UCA_CAMERA_GET_PRIVATE (object);
+
+#ifdef __linux__
+    if (priv->frame_fd >= 0)
+        close (priv->frame_fd);
+#endif
+
+    free_queued (priv->queued);
+    g_free (priv->thread_cpus);
+    g_object_unref (priv->cancellable);
+    g_mutex_clear (&priv->metadata_lock);
+    g_mutex_clear (&priv->access_lock);
+    g_mutex_clear (&priv->recording_lock);
+    g_mutex_clear (&priv->readout_lock);
+    g_mutex_clear (&priv->trigger_lock);
+    g_mutex_clear (&priv->grab_lock);
+    g_mutex_clear (&priv->property_lock);
+    g_mutex_clear (&priv->queue_lock);
+    g_mutex_clear (&priv->delivery_lock);
+    g_cond_clear (&priv->delivery_cond);
+    g_mutex_clear (&priv->filter_lock);
+    g_mutex_clear (&priv->buffer_lock);
+    g_mutex_clear (&priv->thread_lock);
+    g_cond_clear (&priv->freeze_cond);
+    g_cond_clear (&priv->filter_cond);
+    g_queue_free (priv->event_history);
+
     G_OBJECT_CLASS (uca_camera_parent_class)->finalize (object);
 }
 
@@ -360,12 +877,15 @@ uca_camera_class_init (UcaCameraClass *klass)
     gobject_class->get_property = uca_camera_get_property;
     gobject_class->dispose = uca_camera_dispose;
     gobject_class->finalize = uca_camera_finalize;
+    gobject_class->notify = uca_camera_notify;
 
     klass->start_recording = NULL;
     klass->stop_recording = NULL;
     klass->grab = NULL;
     klass->readout = NULL;
+    klass->grab_many = NULL;
     klass->write = NULL;
+    klass->commit = NULL;
 
     camera_properties[PROP_NAME] =
         g_param_spec_string("name",
@@ -549,9 +1069,150 @@ uca_camera_class_init (UcaCameraClass *klass)
             0, G_MAXUINT, 4,
             G_PARAM_READWRITE);
 
+    camera_properties[PROP_BUFFER_ALLOC_FLAGS] =
+        g_param_spec_flags(uca_camera_props[PROP_BUFFER_ALLOC_FLAGS],
+            "Allocation policy of the ring buffer",
+            "Allocation policy of the ring buffer",
+            UCA_TYPE_RING_BUFFER_ALLOC_FLAGS, UCA_RING_BUFFER_ALLOC_DEFAULT,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_ALIGNMENT] =
+        g_param_spec_uint(uca_camera_props[PROP_BUFFER_ALIGNMENT],
+            "Alignment of the ring buffer memory in bytes",
+            "Alignment of the ring buffer memory in bytes, a power of two of at least the page size or 0 to align to pages",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_NUMA_NODE] =
+        g_param_spec_int(uca_camera_props[PROP_BUFFER_NUMA_NODE],
+            "NUMA node of the ring buffer memory",
+            "NUMA node of the ring buffer memory, -1 for no binding",
+            -1, G_MAXINT, -1,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_POLICY] =
+        g_param_spec_enum(uca_camera_props[PROP_BUFFER_POLICY],
+            "Policy if the ring buffer is full",
+            "Policy if the ring buffer is full",
+            UCA_TYPE_RING_BUFFER_POLICY, UCA_RING_BUFFER_POLICY_OVERWRITE_OLDEST,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_OVERRUNS] =
+        g_param_spec_uint64(uca_camera_props[PROP_BUFFER_OVERRUNS],
+            "Number of frames lost in the ring buffer",
+            "Number of frames lost in the ring buffer since recording started",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READABLE);
+
+    camera_properties[PROP_BUFFER_MAX_FILL] =
+        g_param_spec_uint(uca_camera_props[PROP_BUFFER_MAX_FILL],
+            "Highest number of unread frames in the ring buffer",
+            "Highest number of unread frames in the ring buffer since recording started",
+            0, G_MAXUINT, 0,
+            G_PARAM_READABLE);
+
+    camera_properties[PROP_DELIVERY_THREADS] =
+        g_param_spec_uint(uca_camera_props[PROP_DELIVERY_THREADS],
+            "Number of threads calling the grab callback",
+            "Number of threads calling the grab callback, 0 to call it from the acquisition thread",
+            0, 256, 1,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_DELIVERY_ORDERED] =
+        g_param_spec_boolean(uca_camera_props[PROP_DELIVERY_ORDERED],
+            "TRUE if the grab callback is called in frame order",
+            "TRUE if the grab callback is called in frame order",
+            TRUE, G_PARAM_READWRITE);
+
+    camera_properties[PROP_DELIVERY_QUEUE_LENGTH] =
+        g_param_spec_uint(uca_camera_props[PROP_DELIVERY_QUEUE_LENGTH],
+            "Number of frames waiting for or in the grab callback",
+            "Number of frames waiting for or in the grab callback before new frames are dropped",
+            1, G_MAXUINT, 8,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_DELIVERY_DROPS] =
+        g_param_spec_uint64(uca_camera_props[PROP_DELIVERY_DROPS],
+            "Number of frames not passed to the grab callback",
+            "Number of frames not passed to the grab callback because the delivery queue was full",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READABLE);
+
+    camera_properties[PROP_FILTER_THREADS] =
+        g_param_spec_uint(uca_camera_props[PROP_FILTER_THREADS],
+            "Number of threads running the filter chain",
+            "Number of threads running the filter chain on buffered frames, 0 for one per processor",
+            0, 256, 0,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_EVENT_GATING] =
+        g_param_spec_boolean(uca_camera_props[PROP_EVENT_GATING],
+            "Publish only frames around events",
+            "Publish only buffered frames around frames that a filter marked as triggered",
+            FALSE,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_EVENT_PRE_FRAMES] =
+        g_param_spec_uint(uca_camera_props[PROP_EVENT_PRE_FRAMES],
+            "Number of frames published before an event",
+            "Number of frames published before a triggered frame with event gating",
+            0, 1024, 0,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_EVENT_POST_FRAMES] =
+        g_param_spec_uint(uca_camera_props[PROP_EVENT_POST_FRAMES],
+            "Number of frames published after an event",
+            "Number of frames published after a triggered frame with event gating",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_GRAB_MODE] =
+        g_param_spec_enum(uca_camera_props[PROP_GRAB_MODE],
+            "Which buffered frame is grabbed next",
+            "Whether to grab buffered frames in order or only the newest one",
+            UCA_TYPE_CAMERA_GRAB_MODE, UCA_CAMERA_GRAB_MODE_FIFO,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_GRAB_SKIPPED] =
+        g_param_spec_uint64(uca_camera_props[PROP_GRAB_SKIPPED],
+            "Number of buffered frames skipped",
+            "Number of buffered frames skipped to grab the latest frame",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READABLE);
+
+    camera_properties[PROP_THREAD_CPUS] =
+        g_param_spec_string(uca_camera_props[PROP_THREAD_CPUS],
+            "CPUs the acquisition threads run on",
+            "CPUs the acquisition threads run on as a list such as \"2,4-5\", NULL for any",
+            NULL,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_THREAD_PRIORITY] =
+        g_param_spec_uint(uca_camera_props[PROP_THREAD_PRIORITY],
+            "Real-time priority of the acquisition threads",
+            "SCHED_FIFO priority of the acquisition threads, 0 for normal scheduling",
+            0, 99, 0,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_THREAD_NUMA_NODE] =
+        g_param_spec_int(uca_camera_props[PROP_THREAD_NUMA_NODE],
+            "NUMA node of the acquisition threads",
+            "NUMA node whose CPUs and memory the acquisition threads use, -1 for any",
+            -1, G_MAXINT, -1,
+            G_PARAM_READWRITE);
+
     for (guint id = PROP_0 + 1; id < N_BASE_PROPERTIES; id++)
         g_object_class_install_property(gobject_class, id, camera_properties[id]);
 
+    /*
+     * Trigger and frame rate have always been changed right away during
+     * acquisition and the consumer may switch to the latest frame
+     */
+    uca_camera_pspec_set_writable (camera_properties[PROP_TRIGGER_SOURCE], TRUE);
+    uca_camera_pspec_set_writable (camera_properties[PROP_TRIGGER_TYPE], TRUE);
+    uca_camera_pspec_set_writable (camera_properties[PROP_FRAMES_PER_SECOND], TRUE);
+    uca_camera_pspec_set_writable (camera_properties[PROP_GRAB_MODE], TRUE);
+
     g_type_class_add_private(klass, sizeof(UcaCameraPrivate));
 }
 
@@ -564,6 +1225,7 @@ uca_camera_init (UcaCamera *camera)
 
     camera->priv = UCA_CAMERA_GET_PRIVATE(camera);
     camera->priv->cancelling_recording = FALSE;
+    camera->priv->cancellable = g_cancellable_new ();
     camera->priv->is_recording = FALSE;
     camera->priv->is_readout = FALSE;
     camera->priv->transfer_async = FALSE;
@@ -571,7 +1233,67 @@ uca_camera_init (UcaCamera *camera)
     camera->priv->trigger_type = UCA_CAMERA_TRIGGER_TYPE_EDGE;
     camera->priv->buffered = FALSE;
     camera->priv->num_buffers = 4;
+    camera->priv->buffer_alloc_flags = UCA_RING_BUFFER_ALLOC_DEFAULT;
+    camera->priv->buffer_alignment = 0;
+    camera->priv->buffer_numa_node = -1;
+    camera->priv->buffer_policy = UCA_RING_BUFFER_POLICY_OVERWRITE_OLDEST;
+    camera->priv->n_grabbed = 0;
+    camera->priv->freeze_requested = FALSE;
+    camera->priv->freezing = FALSE;
+    g_cond_init (&camera->priv->freeze_cond);
+    camera->priv->n_post_frames = 0;
+    camera->priv->frozen = FALSE;
+    memset (&camera->priv->metadata_template, 0, sizeof (UcaRingBufferMetadata));
+    memset (&camera->priv->last_metadata, 0, sizeof (UcaRingBufferMetadata));
+    memset (&camera->priv->frame_info, 0, sizeof (UcaFrameInfo));
+    camera->priv->geometry_valid = FALSE;
+    camera->priv->geometry_serial = 0;
+    g_mutex_init (&camera->priv->metadata_lock);
+    g_mutex_init (&camera->priv->access_lock);
+    g_mutex_init (&camera->priv->recording_lock);
+    g_mutex_init (&camera->priv->readout_lock);
+    g_mutex_init (&camera->priv->trigger_lock);
+    g_mutex_init (&camera->priv->grab_lock);
+    g_mutex_init (&camera->priv->property_lock);
+    camera->priv->batch_thread = NULL;
+    g_mutex_init (&camera->priv->queue_lock);
+    camera->priv->queued = g_array_new (FALSE, TRUE, sizeof (QueuedProperty));
+    camera->priv->n_queued = 0;
+    camera->priv->applying_thread = NULL;
+    camera->priv->max_frame_size = 0;
     camera->priv->ring_buffer = NULL;
+    camera->priv->retired_buffers = NULL;
+    g_mutex_init (&camera->priv->buffer_lock);
+    g_mutex_init (&camera->priv->thread_lock);
+    camera->priv->thread_cpus = NULL;
+    camera->priv->thread_priority = 0;
+    camera->priv->thread_numa_node = -1;
+    camera->priv->grab_mode = UCA_CAMERA_GRAB_MODE_FIFO;
+    camera->priv->grab_skipped = 0;
+    camera->priv->frame_fd = -1;
+    camera->priv->delivery_threads = 1;
+    camera->priv->delivery_ordered = TRUE;
+    camera->priv->delivery_queue_length = 8;
+    camera->priv->delivery_workers = NULL;
+    camera->priv->grab_pool = NULL;
+    camera->priv->delivery_free = NULL;
+    camera->priv->delivery_borrowed = NULL;
+    camera->priv->delivery_drops = 0;
+    g_mutex_init (&camera->priv->delivery_lock);
+    g_cond_init (&camera->priv->delivery_cond);
+    camera->priv->filters = g_ptr_array_new_with_free_func (g_object_unref);
+    camera->priv->active_filters = NULL;
+    camera->priv->filter_threads = 0;
+    camera->priv->filter_workers = NULL;
+    camera->priv->filter_free = NULL;
+    camera->priv->filter_error = NULL;
+    camera->priv->event_gating = FALSE;
+    camera->priv->event_pre_frames = 0;
+    camera->priv->event_post_frames = 0;
+    camera->priv->event_history = g_queue_new ();
+    camera->priv->event_post_remaining = 0;
+    g_mutex_init (&camera->priv->filter_lock);
+    g_cond_init (&camera->priv->filter_cond);
 
     g_value_init (&val, G_TYPE_UINT);
     g_value_set_uint (&val, 1);
@@ -600,64 +1322,486 @@ uca_camera_init (UcaCamera *camera)
 #endif
 }
 
-static gpointer
-buffer_thread (UcaCamera *camera)
+static void
+signal_frame_fd (UcaCameraPrivate *priv)
 {
-    UcaCameraClass *klass;
-    GError *error = NULL;
+#ifdef __linux__
+    gint fd;
+    guint64 value = 1;
 
-    klass = UCA_CAMERA_GET_CLASS (camera);
+    fd = g_atomic_int_get (&priv->frame_fd);
 
-    while (!camera->priv->cancelling_recording) {
-        gpointer buffer;
+    if (fd >= 0 && write (fd, &value, sizeof (value)) < 0 && errno != EAGAIN)
+        g_warning ("Could not signal frame fd: %s", g_strerror (errno));
+#endif
+}
 
-        buffer = uca_ring_buffer_get_write_pointer (camera->priv->ring_buffer);
+static void
+clear_frame_fd (UcaCameraPrivate *priv)
+{
+#ifdef __linux__
+    gint fd;
+    guint64 value;
 
-        if (!(*klass->grab) (camera, buffer, &error))
-            break;
+    fd = g_atomic_int_get (&priv->frame_fd);
 
-        uca_ring_buffer_write_advance (camera->priv->ring_buffer);
-    }
+    if (fd < 0)
+        return;
 
-    return error;
+    /*
+     * Clear first and re-arm if frames are left, so that a frame written in
+     * between is never missed.
+     */
+    if (read (fd, &value, sizeof (value)) < 0 && errno != EAGAIN)
+        g_warning ("Could not clear frame fd: %s", g_strerror (errno));
+
+    if (priv->ring_buffer != NULL && uca_ring_buffer_available (priv->ring_buffer))
+        signal_frame_fd (priv);
+#endif
 }
 
-static GEnumValue *
-find_enum_value (GParamSpecEnum *pspec, const gchar *name)
+/*
+ * Placement failures of threads started by libuca only warn, because frames
+ * can still be acquired, just with more jitter.
+ */
+static void
+setup_own_thread (UcaCamera *camera)
 {
-    GEnumValue *result;
-    GEnumClass *enum_class;
+    GError *error = NULL;
 
-    result = NULL;
-    enum_class = pspec->enum_class;
+    if (!uca_camera_setup_thread (camera, &error)) {
+        g_warning ("Could not set up acquisition thread: %s", error->message);
+        g_error_free (error);
+    }
+}
 
-    for (guint i = 0; i < enum_class->n_values; i++)
-        if (!g_strcmp0 (enum_class->values[i].value_name, name))
-            result = &enum_class->values[i];
+/* Pushed once per worker thread to end it after the items before */
+static gint workers_stop;
 
-    return result;
+static gpointer
+workers_thread (Workers *workers)
+{
+    gpointer item;
+
+    if (workers->placed)
+        setup_own_thread (workers->camera);
+
+    while ((item = g_async_queue_pop (workers->queue)) != &workers_stop)
+        workers->func (item, workers->camera);
+
+    return NULL;
 }
 
-static gboolean
-is_a_number (const gchar *s)
+/* Let the threads handle what has been pushed so far, then join them */
+static void
+workers_free (Workers *workers)
 {
-    g_return_val_if_fail (s != NULL, FALSE);
+    for (guint i = 0; i < workers->n_threads; i++)
+        g_async_queue_push (workers->queue, &workers_stop);
 
-    for (; *s != '\0'; s++) {
-        if (!g_ascii_isdigit (*s))
-            return FALSE;
-    }
+    for (guint i = 0; i < workers->n_threads; i++)
+        g_thread_join (workers->threads[i]);
 
-    return TRUE;
+    g_async_queue_unref (workers->queue);
+    g_free (workers->threads);
+    g_free (workers);
 }
 
-/**
- * uca_camera_parse_arg_props:
- * @camera: A #UcaCamera object
- * @argv: Array of property assignment strings in the form of `prop=value`
- * @argc: Length of @argv
- * @error: Location to store a #UcaCameraError error or %NULL
- *
+/*
+ * Start n_threads threads calling func for each pushed item. New threads
+ * inherit the placement of the calling thread, with placed they are set up
+ * with uca_camera_setup_thread() instead.
+ */
+static Workers *
+workers_new (UcaCamera *camera, const gchar *name, GFunc func, guint n_threads, gboolean placed, GError **error)
+{
+    Workers *workers;
+
+    workers = g_new0 (Workers, 1);
+    workers->camera = camera;
+    workers->func = func;
+    workers->placed = placed;
+    workers->queue = g_async_queue_new ();
+    workers->threads = g_new0 (GThread *, n_threads);
+
+    for (; workers->n_threads < n_threads; workers->n_threads++) {
+        GThread *thread;
+
+        thread = g_thread_try_new (name, (GThreadFunc) workers_thread, workers, error);
+
+        if (thread == NULL) {
+            workers_free (workers);
+            return NULL;
+        }
+
+        workers->threads[workers->n_threads] = thread;
+    }
+
+    return workers;
+}
+
+static void
+workers_push (Workers *workers, gpointer item)
+{
+    g_async_queue_push (workers->queue, item);
+}
+
+/*
+ * Run the filter chain of the current recording on a frame. The chain does not
+ * change while recording, so this needs no locking.
+ */
+static gboolean
+run_filters (UcaCamera *camera, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    GPtrArray *filters;
+
+    filters = camera->priv->active_filters;
+
+    if (filters == NULL)
+        return TRUE;
+
+    for (guint i = 0; i < filters->len; i++) {
+        if (!uca_filter_process (g_ptr_array_index (filters, i), data, info, error))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Copy a frame that was held back for event gating into the ring buffer */
+static void
+publish_filtered (UcaCamera *camera, FilterItem *item)
+{
+    UcaCameraPrivate *priv;
+    UcaRingBuffer *buffer;
+
+    priv = camera->priv;
+    buffer = priv->ring_buffer;
+
+    /* Frames still in flight when recording stops are dropped */
+    while (!uca_ring_buffer_wait_writable (buffer, BUFFERED_GRAB_POLL_TIMEOUT)) {
+        if (priv->cancelling_recording)
+            return;
+    }
+
+    memcpy (uca_ring_buffer_get_write_pointer (buffer), item->data, uca_frame_info_get_size (&item->info));
+    *uca_ring_buffer_get_write_metadata (buffer) = *item->metadata;
+    uca_ring_buffer_write_advance (buffer);
+    signal_frame_fd (priv);
+}
+
+/*
+ * Publish only the frames around triggered ones. Returns the item that can be
+ * reused, which is an older one or %NULL if @item is kept as history.
+ */
+static FilterItem *
+publish_gated (UcaCamera *camera, FilterItem *item)
+{
+    UcaCameraPrivate *priv;
+    FilterItem *held;
+
+    priv = camera->priv;
+
+    if (item->info.flags & UCA_FRAME_FLAG_TRIGGERED) {
+        while ((held = g_queue_pop_head (priv->event_history)) != NULL) {
+            publish_filtered (camera, held);
+            g_async_queue_push (priv->filter_free, held);
+        }
+
+        publish_filtered (camera, item);
+        priv->event_post_remaining = priv->event_post_frames;
+        return item;
+    }
+
+    if (priv->event_post_remaining > 0) {
+        publish_filtered (camera, item);
+        priv->event_post_remaining--;
+        return item;
+    }
+
+    if (priv->event_pre_frames == 0)
+        return item;
+
+    g_queue_push_tail (priv->event_history, item);
+
+    if (g_queue_get_length (priv->event_history) > priv->event_pre_frames)
+        return g_queue_pop_head (priv->event_history);
+
+    return NULL;
+}
+
+static void
+filter_func (FilterItem *item, UcaCamera *camera)
+{
+    UcaCameraPrivate *priv;
+    FilterItem *done;
+    GError *error = NULL;
+    gboolean result;
+
+    priv = camera->priv;
+    done = item;
+    result = run_filters (camera, item->data, &item->info, &error);
+
+    /* Filters may have shrunk or marked the frame */
+    item->metadata->roi_width = item->info.width;
+    item->metadata->roi_height = item->info.height;
+    item->metadata->flags = item->info.flags;
+    item->metadata->bitdepth = item->info.bitdepth;
+    item->metadata->size = uca_frame_info_get_size (&item->info);
+
+    /* Frames are filtered in parallel but published in the order they came */
+    g_mutex_lock (&priv->filter_lock);
+
+    while (item->sequence != priv->filter_next_publish)
+        g_cond_wait (&priv->filter_cond, &priv->filter_lock);
+
+    /*
+     * Staged blocks can only be committed in order, so nothing after a frame
+     * that failed is published
+     */
+    result = result && priv->filter_error == NULL;
+    g_mutex_unlock (&priv->filter_lock);
+
+    /* Publishing in order, so the event history needs no locking */
+    if (result && priv->event_gating)
+        done = publish_gated (camera, item);
+    else if (result) {
+        uca_ring_buffer_commit (priv->ring_buffer);
+        signal_frame_fd (priv);
+    }
+
+    g_mutex_lock (&priv->filter_lock);
+
+    if (error != NULL && priv->filter_error == NULL)
+        priv->filter_error = error;
+    else if (error != NULL)
+        g_error_free (error);
+
+    priv->filter_next_publish++;
+    g_cond_broadcast (&priv->filter_cond);
+    g_mutex_unlock (&priv->filter_lock);
+
+    if (done != NULL)
+        g_async_queue_push (priv->filter_free, done);
+}
+
+/*
+ * Read thread used when filters are set. Frames are grabbed into ring buffer
+ * blocks, staged and handed to the filter workers, which process them in place
+ * and commit them. With event gating, frames are grabbed into items of their
+ * own instead and only those that are published are copied.
+ */
+static gpointer
+filtered_buffer_thread (UcaCamera *camera)
+{
+    UcaCameraClass *klass;
+    UcaCameraPrivate *priv;
+    FilterItem *item;
+    GError *error = NULL;
+    guint64 sequence = 0;
+    guint n_threads;
+    guint n_items;
+    gboolean in_place;
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+    priv = camera->priv;
+    n_threads = priv->filter_threads > 0 ? priv->filter_threads : (guint) g_get_num_processors ();
+
+    priv->filter_next_publish = 0;
+    priv->event_post_remaining = 0;
+
+    /* Started before placing this thread, so that they do not share its cores */
+    priv->filter_workers = workers_new (camera, "filter", (GFunc) filter_func, n_threads, FALSE, &error);
+
+    if (priv->filter_workers == NULL)
+        goto finish;
+
+    setup_own_thread (camera);
+
+    /*
+     * Two items per worker so that grabbing never waits for a busy pool, plus
+     * those held back before an event
+     */
+    priv->filter_free = g_async_queue_new ();
+    in_place = !priv->event_gating;
+    n_items = 2 * n_threads + (priv->event_gating ? priv->event_pre_frames : 0);
+
+    for (guint i = 0; i < n_items; i++) {
+        item = g_new0 (FilterItem, 1);
+        item->storage = in_place ? NULL : g_malloc (priv->max_frame_size);
+        item->data = item->storage;
+        item->metadata = &item->storage_metadata;
+        g_async_queue_push (priv->filter_free, item);
+    }
+
+    while (!priv->cancelling_recording) {
+        gint64 start_time;
+
+        if (g_atomic_int_get (&priv->freeze_requested) && priv->n_post_frames == 0)
+            break;
+
+        g_mutex_lock (&priv->filter_lock);
+        error = priv->filter_error;
+        priv->filter_error = NULL;
+        g_mutex_unlock (&priv->filter_lock);
+
+        if (error != NULL)
+            break;
+
+        /* Staged blocks are only reused once the consumer has read them */
+        if (in_place && !uca_ring_buffer_wait_writable (priv->ring_buffer, BUFFERED_GRAB_POLL_TIMEOUT))
+            continue;
+
+        /* All items are in flight if the filters or the consumer fall behind */
+        item = g_async_queue_timeout_pop (priv->filter_free, BUFFERED_GRAB_POLL_TIMEOUT);
+
+        if (item == NULL)
+            continue;
+
+        if (in_place) {
+            item->data = uca_ring_buffer_get_write_pointer (priv->ring_buffer);
+            item->metadata = uca_ring_buffer_get_write_metadata (priv->ring_buffer);
+        }
+
+        uca_camera_apply_queued_properties (camera);
+        start_time = g_get_monotonic_time ();
+
+        if (!(*klass->grab) (camera, item->data, &error)) {
+            g_async_queue_push (priv->filter_free, item);
+            break;
+        }
+
+        fill_metadata (camera, item->metadata, start_time);
+
+        g_mutex_lock (&priv->metadata_lock);
+        item->info = priv->frame_info;
+        g_mutex_unlock (&priv->metadata_lock);
+
+        item->info.start_time = item->metadata->start_timestamp;
+        item->info.end_time = item->metadata->timestamp;
+        item->info.settings_serial = item->metadata->settings_serial;
+
+        /* Dropped because the consumer is behind, nothing to filter */
+        if (in_place && !uca_ring_buffer_write_stage (priv->ring_buffer))
+            g_async_queue_push (priv->filter_free, item);
+        else {
+            /* Filters running in parallel use the sequence to restore the order */
+            item->sequence = sequence++;
+            item->info.sequence = item->sequence;
+            workers_push (priv->filter_workers, item);
+        }
+
+        if (g_atomic_int_get (&priv->freeze_requested))
+            priv->n_post_frames--;
+    }
+
+    /* Let the workers publish the frames that are still in flight */
+    workers_free (priv->filter_workers);
+    priv->filter_workers = NULL;
+
+    /* Frames before an event that did not come are dropped */
+    while ((item = g_queue_pop_head (priv->event_history)) != NULL)
+        g_async_queue_push (priv->filter_free, item);
+
+    while ((item = g_async_queue_try_pop (priv->filter_free)) != NULL) {
+        g_free (item->storage);
+        g_free (item);
+    }
+
+    g_async_queue_unref (priv->filter_free);
+    priv->filter_free = NULL;
+
+    if (error == NULL)
+        error = priv->filter_error;
+    else if (priv->filter_error != NULL)
+        g_error_free (priv->filter_error);
+
+    priv->filter_error = NULL;
+
+finish:
+    g_atomic_int_set (&priv->read_thread_finished, TRUE);
+    signal_frame_fd (priv);
+    return error;
+}
+
+static gpointer
+buffer_thread (UcaCamera *camera)
+{
+    UcaCameraClass *klass;
+    GError *error = NULL;
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+    setup_own_thread (camera);
+
+    while (!camera->priv->cancelling_recording) {
+        gpointer buffer;
+        gint64 start_time;
+
+        if (g_atomic_int_get (&camera->priv->freeze_requested) && camera->priv->n_post_frames == 0)
+            break;
+
+        /* Wait for the consumer if it still borrows the block we are up to */
+        if (!uca_ring_buffer_wait_writable (camera->priv->ring_buffer, BUFFERED_GRAB_POLL_TIMEOUT))
+            continue;
+
+        uca_camera_apply_queued_properties (camera);
+        buffer = uca_ring_buffer_get_write_pointer (camera->priv->ring_buffer);
+        start_time = g_get_monotonic_time ();
+
+        if (!(*klass->grab) (camera, buffer, &error))
+            break;
+
+        fill_metadata (camera, uca_ring_buffer_get_write_metadata (camera->priv->ring_buffer), start_time);
+        uca_ring_buffer_write_advance (camera->priv->ring_buffer);
+        signal_frame_fd (camera->priv);
+
+        if (g_atomic_int_get (&camera->priv->freeze_requested))
+            camera->priv->n_post_frames--;
+    }
+
+    g_atomic_int_set (&camera->priv->read_thread_finished, TRUE);
+
+    /* Wake up pollers so that they see the end of the stream */
+    signal_frame_fd (camera->priv);
+    return error;
+}
+
+static GEnumValue *
+find_enum_value (GParamSpecEnum *pspec, const gchar *name)
+{
+    GEnumValue *result;
+    GEnumClass *enum_class;
+
+    result = NULL;
+    enum_class = pspec->enum_class;
+
+    for (guint i = 0; i < enum_class->n_values; i++)
+        if (!g_strcmp0 (enum_class->values[i].value_name, name))
+            result = &enum_class->values[i];
+
+    return result;
+}
+
+static gboolean
+is_a_number (const gchar *s)
+{
+    g_return_val_if_fail (s != NULL, FALSE);
+
+    for (; *s != '\0'; s++) {
+        if (!g_ascii_isdigit (*s))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * uca_camera_parse_arg_props:
+ * @camera: A #UcaCamera object
+ * @argv: Array of property assignment strings in the form of `prop=value`
+ * @argc: Length of @argv
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
  * Parses the assignment array @argv and sets the property to the given value.
  * If an error occures, @error is set and %FALSE is returned.
  *
@@ -755,423 +1899,2377 @@ uca_camera_parse_arg_props (UcaCamera *camera, gchar **argv, guint argc, GError
     return TRUE;
 }
 
-/**
- * uca_camera_start_recording:
- * @camera: A #UcaCamera object
- * @error: Location to store a #UcaCameraError error or %NULL
- *
- * Initiate recording of frames. If UcaCamera:grab-asynchronous is %TRUE and a
- * #UcaCameraGrabFunc callback is set, frames are automatically transfered to
- * the client program, otherwise you must use uca_camera_grab().
- */
-void
-uca_camera_start_recording (UcaCamera *camera, GError **error)
+static gboolean
+is_applying_queued (UcaCameraPrivate *priv)
+{
+    return g_atomic_pointer_get (&priv->applying_thread) == g_thread_self ();
+}
+
+static gboolean
+commit_properties (UcaCamera *camera, GError **error)
 {
     UcaCameraClass *klass;
     UcaCameraPrivate *priv;
-    static GMutex mutex;
-    GError *tmp_error = NULL;
-
-    g_return_if_fail (UCA_IS_CAMERA (camera));
+    gboolean result;
 
     klass = UCA_CAMERA_GET_CLASS (camera);
+    priv = camera->priv;
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->start_recording != NULL);
+    g_atomic_pointer_set (&priv->batch_thread, NULL);
 
-    priv = camera->priv;
+    if (klass->commit == NULL)
+        return TRUE;
 
-    g_mutex_lock (&mutex);
+    /*
+     * Queued updates are applied from the acquisition path, which like
+     * buffer_thread calls into the plugin without access_lock. Taking it there
+     * would deadlock with stop_recording joining a plugin thread.
+     */
+    if (is_applying_queued (priv))
+        return klass->commit (camera, error);
 
-    if (priv->is_recording) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
-                     "Camera is already recording");
-        goto start_recording_unlock;
-    }
+    g_mutex_lock (&priv->access_lock);
+    result = klass->commit (camera, error);
+    g_mutex_unlock (&priv->access_lock);
 
-    if (priv->transfer_async && (camera->grab_func == NULL)) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NO_GRAB_FUNC,
-                     "No grab callback function set");
-        goto start_recording_unlock;
+    return result;
+}
+
+/*
+ * Properties handled by UcaCamera itself. They configure how a recording is
+ * set up, so unless they are marked writable they cannot be queued and
+ * applied between two frames.
+ */
+static gboolean
+is_internal_property (GParamSpec *pspec)
+{
+    for (guint id = PROP_TRANSFER_ASYNCHRONOUSLY; id < N_BASE_PROPERTIES; id++) {
+        if (camera_properties[id] == pspec)
+            return TRUE;
     }
 
-    g_mutex_lock (&access_lock);
-    (*klass->start_recording)(camera, &tmp_error);
-    g_mutex_unlock (&access_lock);
+    return FALSE;
+}
 
-    if (tmp_error == NULL) {
-        priv->is_readout = FALSE;
-        priv->is_recording = TRUE;
-        priv->cancelling_recording = FALSE;
-        g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_RECORDING]);
+/*
+ * Check that each changed property no longer has its old value. A plugin may
+ * round a value, but if it silently ignored it, for example a base class
+ * property that is fixed during acquisition, the set must not succeed.
+ */
+static gboolean
+check_applied (UcaCamera *camera, guint n, GParamSpec **pspecs,
+               const GValue *values, const GValue *old_values, GError **error)
+{
+    for (guint i = 0; i < n; i++) {
+        GValue current = {0};
+        gboolean unchanged;
+
+        if (!(pspecs[i]->flags & G_PARAM_READABLE) ||
+            g_param_values_cmp (pspecs[i], &values[i], &old_values[i]) == 0)
+            continue;
+
+        g_value_init (&current, pspecs[i]->value_type);
+        g_object_get_property (G_OBJECT (camera), pspecs[i]->name, &current);
+        unchanged = g_param_values_cmp (pspecs[i], &current, &old_values[i]) == 0;
+        g_value_unset (&current);
+
+        if (unchanged) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY,
+                         "Property `%s' did not take the new value", pspecs[i]->name);
+            return FALSE;
+        }
     }
-    else
-        g_propagate_error (error, tmp_error);
 
-    if (priv->buffered) {
-        guint width, height, bitdepth;
-        guint pixel_size;
+    return TRUE;
+}
 
-        g_object_get (camera,
-                      "roi-width", &width,
-                      "roi-height", &height,
-                      "sensor-bitdepth", &bitdepth,
-                      NULL);
+/*
+ * Set and commit already validated values. The result is rejected if a value
+ * did not take effect and, during a recording, if frames would no longer fit
+ * into the buffers allocated for it. On failure the previous values are
+ * restored.
+ */
+static gboolean
+apply_properties (UcaCamera *camera, guint n, GParamSpec **pspecs, const GValue *values, GError **error)
+{
+    UcaCameraPrivate *priv;
+    GValue *old_values;
+    GError *commit_error = NULL;
+    gboolean result;
 
-        pixel_size = bitdepth <= 8 ? 1 : 2;
-        priv->ring_buffer = uca_ring_buffer_new (width * height * pixel_size,
-                                                         priv->num_buffers);
+    priv = camera->priv;
+    old_values = g_new0 (GValue, n);
 
-        /* Let's read out the frames from another thread */
-        priv->read_thread = g_thread_new ("read-thread", (GThreadFunc) buffer_thread, camera);
-    }
+    g_mutex_lock (&priv->property_lock);
+    g_object_freeze_notify (G_OBJECT (camera));
+
+    for (guint i = 0; i < n; i++) {
+        g_value_init (&old_values[i], pspecs[i]->value_type);
+
+        if (pspecs[i]->flags & G_PARAM_READABLE)
+            g_object_get_property (G_OBJECT (camera), pspecs[i]->name, &old_values[i]);
+    }
+
+    g_atomic_pointer_set (&priv->batch_thread, g_thread_self ());
+
+    for (guint i = 0; i < n; i++)
+        g_object_set_property (G_OBJECT (camera), pspecs[i]->name, &values[i]);
+
+    result = commit_properties (camera, error) &&
+             check_applied (camera, n, pspecs, values, old_values, error);
+
+    if (result && priv->is_recording) {
+        UcaCameraGeometry geometry;
+
+        /* Notifications are frozen, so the cached geometry is still old */
+        invalidate_geometry (camera);
+        uca_camera_get_geometry (camera, &geometry);
+
+        if (geometry.frame_size > priv->max_frame_size) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY,
+                         "Frames of %" G_GSIZE_FORMAT " bytes do not fit into the %"
+                         G_GSIZE_FORMAT " bytes allocated for this recording",
+                         geometry.frame_size, priv->max_frame_size);
+            result = FALSE;
+        }
+        else {
+            g_mutex_lock (&priv->metadata_lock);
+            uca_frame_info_init (&priv->frame_info, geometry.width, geometry.height, geometry.bitdepth);
+            g_mutex_unlock (&priv->metadata_lock);
+        }
+    }
+
+    if (!result) {
+        g_atomic_pointer_set (&priv->batch_thread, g_thread_self ());
+
+        for (guint i = 0; i < n; i++) {
+            if (pspecs[i]->flags & G_PARAM_READABLE)
+                g_object_set_property (G_OBJECT (camera), pspecs[i]->name, &old_values[i]);
+        }
+
+        if (!commit_properties (camera, &commit_error)) {
+            g_warning ("Could not restore properties: %s", commit_error->message);
+            g_error_free (commit_error);
+        }
+    }
+
+    g_mutex_unlock (&priv->property_lock);
+    g_object_thaw_notify (G_OBJECT (camera));
+
+    for (guint i = 0; i < n; i++)
+        g_value_unset (&old_values[i]);
+
+    g_free (old_values);
+    return result;
+}
+
+/* Must be called with queue_lock held */
+static void
+queue_value (UcaCameraPrivate *priv, GParamSpec *pspec, const GValue *value)
+{
+    QueuedProperty *queued = NULL;
+
+    /* A newer value replaces one that has not been applied yet */
+    for (guint i = 0; i < priv->queued->len; i++) {
+        if (g_array_index (priv->queued, QueuedProperty, i).pspec == pspec) {
+            queued = &g_array_index (priv->queued, QueuedProperty, i);
+            g_value_unset (&queued->value);
+            break;
+        }
+    }
+
+    if (queued == NULL) {
+        g_array_set_size (priv->queued, priv->queued->len + 1);
+        queued = &g_array_index (priv->queued, QueuedProperty, priv->queued->len - 1);
+        queued->pspec = pspec;
+    }
+
+    g_value_init (&queued->value, pspec->value_type);
+    g_value_copy (value, &queued->value);
+    g_atomic_int_set (&priv->n_queued, priv->queued->len);
+}
+
+/**
+ * uca_camera_set_properties:
+ * @camera: A #UcaCamera object
+ * @n: Number of properties
+ * @names: (array length=n): Names of the properties to set
+ * @values: (array length=n): Values of the properties to set
+ * @error: Location for a #GError or %NULL
+ *
+ * Set @n properties at once and apply them to the device in a single step.
+ * All names and values are checked before anything is set, so that nothing is
+ * changed if one of them is wrong. The values are then set as with
+ * g_object_set_property() while uca_camera_is_batch_pending() returns %TRUE,
+ * which lets the plugin only record them. Afterwards the #UcaCameraClass.commit
+ * function of the plugin validates and applies the whole set in one go. If
+ * that fails, the previous values are restored and committed again.
+ *
+ * Property change notifications are emitted once per property after the set
+ * has been committed.
+ *
+ * If @camera is recording and one of the properties cannot be written during
+ * acquisition, the whole set is queued and applied together between two
+ * frames, see uca_camera_queue_property(). Properties that configure the
+ * recording itself, such as #UcaCamera:num-buffers or #UcaCamera:buffered,
+ * cannot be changed during acquisition and fail with
+ * #UCA_CAMERA_ERROR_INVALID_PROPERTY. A set also fails if a property keeps
+ * its previous value, for example because the camera ignored the change.
+ *
+ * Returns: %TRUE if all properties have been set and committed or queued.
+ * Since: 2.4
+ */
+gboolean
+uca_camera_set_properties (UcaCamera *camera,
+                           guint n,
+                           const gchar **names,
+                           const GValue *values,
+                           GError **error)
+{
+    UcaCameraPrivate *priv;
+    GObjectClass *oclass;
+    GParamSpec **pspecs;
+    GValue *new_values;
+    gboolean queue = FALSE;
+    gboolean result = FALSE;
+    guint n_checked = 0;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (n == 0 || (names != NULL && values != NULL), FALSE);
+
+    priv = camera->priv;
+    oclass = G_OBJECT_GET_CLASS (camera);
+    pspecs = g_new0 (GParamSpec *, n);
+    new_values = g_new0 (GValue, n);
+
+    for (; n_checked < n; n_checked++) {
+        GParamSpec *pspec;
+        GValue *value;
+        guint i = n_checked;
+
+        pspec = g_object_class_find_property (oclass, names[i]);
+
+        if (pspec == NULL || !(pspec->flags & G_PARAM_WRITABLE) ||
+            (pspec->flags & G_PARAM_CONSTRUCT_ONLY)) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY,
+                         "No writable property `%s' found", names[i]);
+            goto cleanup;
+        }
+
+        pspecs[i] = pspec;
+        value = &new_values[i];
+        g_value_init (value, pspec->value_type);
+
+        if (!g_value_transform (&values[i], value) ||
+            g_param_value_validate (pspec, value)) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY,
+                         "Invalid value of type `%s' for property `%s'",
+                         G_VALUE_TYPE_NAME (&values[i]), names[i]);
+            n_checked++;
+            goto cleanup;
+        }
+
+        if (priv->is_recording && !is_applying_queued (priv) &&
+            !g_param_spec_get_qdata (pspec, UCA_WRITABLE_QUARK)) {
+            if (is_internal_property (pspec)) {
+                g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY,
+                             "Property `%s' cannot be changed during acquisition", names[i]);
+                n_checked++;
+                goto cleanup;
+            }
+
+            queue = TRUE;
+        }
+    }
+
+    if (queue) {
+        g_mutex_lock (&priv->queue_lock);
+
+        for (guint i = 0; i < n; i++)
+            queue_value (priv, pspecs[i], &new_values[i]);
+
+        g_mutex_unlock (&priv->queue_lock);
+        result = TRUE;
+    }
+    else
+        result = apply_properties (camera, n, pspecs, new_values, error);
+
+cleanup:
+    for (guint i = 0; i < n_checked; i++) {
+        if (G_IS_VALUE (&new_values[i]))
+            g_value_unset (&new_values[i]);
+    }
+
+    g_free (new_values);
+    g_free (pspecs);
+    return result;
+}
+
+/**
+ * uca_camera_queue_property: (skip)
+ * @camera: A #UcaCamera object
+ * @pspec: The #GParamSpec of the property being set
+ * @value: The new value
+ *
+ * Queue a property change that cannot be written during acquisition, so that
+ * it is applied between two frames instead. Plugins call this at the start of
+ * their set_property function and return if it returns %TRUE. Queued changes
+ * are applied before the next frame is grabbed, or when the recording stops.
+ * Frames acquired after a change was applied carry an incremented
+ * #UcaRingBufferMetadata.settings_serial.
+ *
+ * Returns: %TRUE if the change was queued, %FALSE if it should be applied
+ *  right away because @camera is not recording, the calling thread is
+ *  applying queued changes or the property is writable during acquisition.
+ * Since: 2.4
+ */
+gboolean
+uca_camera_queue_property (UcaCamera *camera, GParamSpec *pspec, const GValue *value)
+{
+    UcaCameraPrivate *priv;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (pspec != NULL && value != NULL, FALSE);
+
+    priv = camera->priv;
+
+    if (!priv->is_recording || is_applying_queued (priv) ||
+        g_param_spec_get_qdata (pspec, UCA_WRITABLE_QUARK))
+        return FALSE;
+
+    g_mutex_lock (&priv->queue_lock);
+    queue_value (priv, pspec, value);
+    g_mutex_unlock (&priv->queue_lock);
+    return TRUE;
+}
+
+/**
+ * uca_camera_apply_queued_properties:
+ * @camera: A #UcaCamera object
+ *
+ * Apply property changes queued during recording in a single batch, see
+ * uca_camera_set_properties(). This is done by libuca before grabbing a frame.
+ * Plugins that deliver frames from their own thread in asynchronous mode
+ * should call it between two frames. If the changes cannot be applied, for
+ * example because the frames would grow beyond the size they were allocated
+ * for, they are dropped with a warning.
+ *
+ * Since: 2.4
+ */
+void
+uca_camera_apply_queued_properties (UcaCamera *camera)
+{
+    UcaCameraPrivate *priv;
+    GArray *queued;
+    GParamSpec **pspecs;
+    GValue *values;
+    GError *error = NULL;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    priv = camera->priv;
+
+    if (g_atomic_int_get (&priv->n_queued) == 0)
+        return;
+
+    g_mutex_lock (&priv->queue_lock);
+    queued = priv->queued;
+    priv->queued = g_array_new (FALSE, TRUE, sizeof (QueuedProperty));
+    g_atomic_int_set (&priv->n_queued, 0);
+    g_mutex_unlock (&priv->queue_lock);
+
+    pspecs = g_new0 (GParamSpec *, queued->len);
+    values = g_new0 (GValue, queued->len);
+
+    for (guint i = 0; i < queued->len; i++) {
+        pspecs[i] = g_array_index (queued, QueuedProperty, i).pspec;
+        values[i] = g_array_index (queued, QueuedProperty, i).value;
+    }
+
+    g_atomic_pointer_set (&priv->applying_thread, g_thread_self ());
+
+    if (apply_properties (camera, queued->len, pspecs, values, &error)) {
+        g_mutex_lock (&priv->metadata_lock);
+        priv->metadata_template.settings_serial++;
+        g_mutex_unlock (&priv->metadata_lock);
+    }
+    else {
+        g_warning ("Could not apply queued properties: %s", error->message);
+        g_error_free (error);
+    }
+
+    g_atomic_pointer_set (&priv->applying_thread, NULL);
+
+    g_free (values);
+    g_free (pspecs);
+    free_queued (queued);
+}
+
+/**
+ * uca_camera_is_batch_pending:
+ * @camera: A #UcaCamera object
+ *
+ * Check if the calling thread is setting properties with
+ * uca_camera_set_properties(). Plugins that implement #UcaCameraClass.commit
+ * use this in their set_property function to only record new values and leave
+ * applying them to the device to their commit function. Properties set from
+ * other threads meanwhile are applied right away.
+ *
+ * Returns: %TRUE if the properties being set will be committed afterwards.
+ * Since: 2.4
+ */
+gboolean
+uca_camera_is_batch_pending (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    return g_atomic_pointer_get (&camera->priv->batch_thread) == g_thread_self ();
+}
+
+/*
+ * Give up the ring buffer, but keep it alive while frames are borrowed from
+ * it. Must be called with buffer_lock held.
+ */
+static void
+retire_ring_buffer (UcaCameraPrivate *priv)
+{
+    if (uca_ring_buffer_get_num_borrowed (priv->ring_buffer) > 0)
+        priv->retired_buffers = g_slist_prepend (priv->retired_buffers, priv->ring_buffer);
+    else
+        g_object_unref (priv->ring_buffer);
+
+    priv->ring_buffer = NULL;
+}
+
+/*
+ * Make sure the ring buffer matches the current frame geometry and allocation
+ * policy. The buffer is kept across recordings and only reallocated if
+ * something changed, so that frequent start/stop cycles do not pay for
+ * allocating and faulting in large buffers each time. If frames of the
+ * previous recording are still borrowed, a new buffer is used instead.
+ */
+static void
+prepare_ring_buffer (UcaCamera *camera)
+{
+    UcaCameraPrivate *priv;
+    gsize block_size;
+
+    priv = camera->priv;
+    block_size = uca_frame_info_get_size (&priv->frame_info);
+
+    g_mutex_lock (&priv->buffer_lock);
+
+    if (priv->ring_buffer != NULL) {
+        guint alloc_flags;
+        guint alignment;
+        gint numa_node;
+
+        g_object_get (priv->ring_buffer,
+                      "alloc-flags", &alloc_flags,
+                      "alignment", &alignment,
+                      "numa-node", &numa_node,
+                      NULL);
+
+        if (alloc_flags != priv->buffer_alloc_flags ||
+            alignment != priv->buffer_alignment ||
+            numa_node != priv->buffer_numa_node)
+            retire_ring_buffer (priv);
+    }
+
+    if (priv->ring_buffer != NULL &&
+        !uca_ring_buffer_resize (priv->ring_buffer, block_size, priv->num_buffers))
+        retire_ring_buffer (priv);
+
+    if (priv->ring_buffer == NULL) {
+        priv->ring_buffer = g_object_new (UCA_TYPE_RING_BUFFER,
+                                          "block-size", (guint64) block_size,
+                                          "num-blocks", priv->num_buffers,
+                                          "alloc-flags", priv->buffer_alloc_flags,
+                                          "alignment", priv->buffer_alignment,
+                                          "numa-node", priv->buffer_numa_node,
+                                          "policy", priv->buffer_policy,
+                                          NULL);
+    }
+
+    g_mutex_unlock (&priv->buffer_lock);
+}
+
+static void
+call_grab_func (UcaCamera *camera, gpointer data, guint64 sequence)
+{
+    UcaCameraPrivate *priv;
+
+    priv = camera->priv;
+
+    if (priv->active_filters != NULL) {
+        UcaFrameInfo info;
+        GError *error = NULL;
+
+        g_mutex_lock (&priv->metadata_lock);
+        info = priv->frame_info;
+        g_mutex_unlock (&priv->metadata_lock);
+
+        info.sequence = sequence;
+
+        if (!run_filters (camera, data, &info, &error)) {
+            g_warning ("Could not filter frame: %s", error->message);
+            g_error_free (error);
+            return;
+        }
+    }
+
+    camera->grab_func (data, camera->user_data);
+}
+
+static void
+delivery_func (DeliveryItem *item, UcaCamera *camera)
+{
+    UcaCameraPrivate *priv;
+
+    priv = camera->priv;
+
+    /* Items are popped in order, so waiting for the previous one is short */
+    if (priv->delivery_ordered) {
+        g_mutex_lock (&priv->delivery_lock);
+
+        while (item->sequence != priv->delivery_next_start)
+            g_cond_wait (&priv->delivery_cond, &priv->delivery_lock);
+
+        priv->delivery_next_start++;
+        g_cond_broadcast (&priv->delivery_cond);
+        g_mutex_unlock (&priv->delivery_lock);
+    }
+
+    call_grab_func (camera, item->data, item->sequence);
+    g_async_queue_push (priv->delivery_free, item);
+}
+
+static gboolean
+start_delivery (UcaCamera *camera, GError **error)
+{
+    UcaCameraPrivate *priv;
+
+    priv = camera->priv;
+    priv->delivery_next_sequence = 0;
+    priv->delivery_next_start = 0;
+    priv->delivery_drops = 0;
+
+    if (priv->delivery_threads == 0)
+        return TRUE;
+
+    priv->delivery_workers = workers_new (camera, "delivery", (GFunc) delivery_func,
+                                          priv->delivery_threads, TRUE, error);
+
+    if (priv->delivery_workers == NULL)
+        return FALSE;
+
+    priv->delivery_free = g_async_queue_new ();
+
+    for (guint i = 0; i < priv->delivery_queue_length; i++) {
+        DeliveryItem *item;
+
+        item = g_new0 (DeliveryItem, 1);
+        item->data = g_malloc (priv->max_frame_size);
+        g_async_queue_push (priv->delivery_free, item);
+    }
+
+    return TRUE;
+}
+
+static void
+clear_active_filters (UcaCamera *camera)
+{
+    /* Unbuffered grabs run the chain after releasing the plugin */
+    g_mutex_lock (&camera->priv->grab_lock);
+    g_mutex_lock (&camera->priv->filter_lock);
+
+    if (camera->priv->active_filters != NULL) {
+        g_ptr_array_unref (camera->priv->active_filters);
+        camera->priv->active_filters = NULL;
+    }
+
+    g_mutex_unlock (&camera->priv->filter_lock);
+    g_mutex_unlock (&camera->priv->grab_lock);
+}
+
+static void
+stop_delivery (UcaCamera *camera)
+{
+    UcaCameraPrivate *priv;
+    DeliveryItem *item;
+
+    priv = camera->priv;
+
+    if (priv->delivery_workers == NULL)
+        return;
+
+    /* Let the workers pass on what is still queued */
+    workers_free (priv->delivery_workers);
+    priv->delivery_workers = NULL;
+
+    /* The plugin may have stopped before delivering a buffer it got */
+    if (priv->delivery_borrowed != NULL) {
+        g_async_queue_push (priv->delivery_free, priv->delivery_borrowed);
+        priv->delivery_borrowed = NULL;
+    }
+
+    while ((item = g_async_queue_try_pop (priv->delivery_free)) != NULL) {
+        g_free (item->data);
+        g_free (item);
+    }
+
+    g_async_queue_unref (priv->delivery_free);
+    priv->delivery_free = NULL;
+}
+
+/**
+ * uca_camera_start_recording:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Initiate recording of frames. If UcaCamera:grab-asynchronous is %TRUE and a
+ * #UcaCameraGrabFunc callback is set, frames are automatically transfered to
+ * the client program, otherwise you must use uca_camera_grab().
+ */
+void
+uca_camera_start_recording (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+    UcaCameraPrivate *priv;
+    GError *tmp_error = NULL;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->start_recording != NULL);
+
+    priv = camera->priv;
+
+    g_mutex_lock (&camera->priv->recording_lock);
+
+    if (priv->is_recording) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
+                     "Camera is already recording");
+        goto start_recording_unlock;
+    }
+
+    if (priv->transfer_async && (camera->grab_func == NULL)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NO_GRAB_FUNC,
+                     "No grab callback function set");
+        goto start_recording_unlock;
+    }
+
+    g_cancellable_reset (priv->cancellable);
+    uca_camera_get_frame_info (camera, &priv->frame_info);
+    priv->max_frame_size = uca_frame_info_get_size (&priv->frame_info);
+
+    /* Fix the filter chain for this recording */
+    g_mutex_lock (&priv->filter_lock);
+
+    if (priv->filters->len > 0) {
+        priv->active_filters = g_ptr_array_new_with_free_func (g_object_unref);
+
+        for (guint i = 0; i < priv->filters->len; i++)
+            g_ptr_array_add (priv->active_filters, g_object_ref (g_ptr_array_index (priv->filters, i)));
+    }
+
+    g_mutex_unlock (&priv->filter_lock);
+
+    /* Frames are numbered from zero again, filters must not compare across */
+    for (guint i = 0; priv->active_filters != NULL && i < priv->active_filters->len; i++)
+        uca_filter_reset (g_ptr_array_index (priv->active_filters, i));
+
+    /* The plugin may deliver frames as soon as it has started */
+    if (priv->transfer_async && !start_delivery (camera, error)) {
+        clear_active_filters (camera);
+        goto start_recording_unlock;
+    }
+
+    g_mutex_lock (&camera->priv->access_lock);
+    (*klass->start_recording)(camera, &tmp_error);
+    g_mutex_unlock (&camera->priv->access_lock);
+
+    if (tmp_error != NULL) {
+        stop_delivery (camera);
+        clear_active_filters (camera);
+    }
+
+    if (tmp_error == NULL) {
+        update_metadata_template (camera);
+        priv->n_grabbed = 0;
+        priv->grab_skipped = 0;
+        priv->frozen = FALSE;
+        priv->is_readout = FALSE;
+        priv->is_recording = TRUE;
+        priv->cancelling_recording = FALSE;
+        g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_RECORDING]);
+    }
+    else
+        g_propagate_error (error, tmp_error);
+
+    if (tmp_error == NULL && priv->buffered) {
+        prepare_ring_buffer (camera);
+        clear_frame_fd (priv);
+
+        /* Let's read out the frames from another thread */
+        g_atomic_int_set (&priv->read_thread_finished, FALSE);
+        g_atomic_int_set (&priv->freeze_requested, FALSE);
+        priv->read_thread = g_thread_new ("read-thread",
+                                          priv->active_filters != NULL ?
+                                          (GThreadFunc) filtered_buffer_thread :
+                                          (GThreadFunc) buffer_thread,
+                                          camera);
+    }
+    else if (!priv->buffered && priv->ring_buffer != NULL) {
+        /* Give the memory back if buffering was turned off */
+        g_mutex_lock (&priv->buffer_lock);
+        retire_ring_buffer (priv);
+        g_mutex_unlock (&priv->buffer_lock);
+    }
+
+start_recording_unlock:
+    g_mutex_unlock (&camera->priv->recording_lock);
+}
+
+/**
+ * uca_camera_stop_recording:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Stop recording. Grabs that wait for a frame are cancelled first, so that
+ * this returns quickly with plugins that watch uca_camera_get_cancellable().
+ * If the read thread of a buffered camera stopped because of an error, that
+ * error is reported here after the camera has been stopped.
+ */
+void
+uca_camera_stop_recording (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+    UcaCameraPrivate *priv;
+    GError *tmp_error = NULL;
+    GError *thread_error = NULL;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->stop_recording != NULL);
+
+    priv = camera->priv;
+
+    g_mutex_lock (&camera->priv->recording_lock);
+
+    if (!priv->is_recording) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                     "Camera is not recording");
+        goto error_stop_recording;
+    }
+
+    /* Wake up grabs that wait for a frame before we wait for them */
+    priv->cancelling_recording = TRUE;
+    g_cancellable_cancel (priv->cancellable);
+
+    /* The read thread is already gone if the recording was frozen */
+    if (priv->read_thread != NULL) {
+        thread_error = g_thread_join (priv->read_thread);
+        priv->read_thread = NULL;
+    }
+
+    /* Or uca_camera_freeze() is about to join it */
+    while (priv->freezing)
+        g_cond_wait (&priv->freeze_cond, &priv->recording_lock);
+
+    g_mutex_lock (&camera->priv->access_lock);
+
+    (*klass->stop_recording)(camera, &tmp_error);
+    priv->cancelling_recording = FALSE;
+
+    g_mutex_unlock (&camera->priv->access_lock);
+
+    if (tmp_error == NULL) {
+        stop_delivery (camera);
+        clear_active_filters (camera);
+    }
+
+    if (tmp_error == NULL) {
+        priv->is_recording = FALSE;
+        priv->is_readout = FALSE;
+        g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_RECORDING]);
+
+        /* Changes that did not make it before the last frame */
+        uca_camera_apply_queued_properties (camera);
+    }
+    else
+        g_propagate_error (error, tmp_error);
+
+    /* Report why the read thread stopped unless we stopped it ourselves */
+    if (thread_error != NULL) {
+        if (tmp_error == NULL && !g_error_matches (thread_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_propagate_error (error, thread_error);
+        else
+            g_error_free (thread_error);
+    }
+
+error_stop_recording:
+    g_mutex_unlock (&camera->priv->recording_lock);
+}
+
+/**
+ * uca_camera_get_cancellable:
+ * @camera: A #UcaCamera object
+ *
+ * Get the #GCancellable that is cancelled when recording or readout is
+ * stopped and reset when it is started again. Plugins should watch it in
+ * their grab and readout methods whenever they may block, for example while
+ * waiting for a trigger, and then fail with %G_IO_ERROR_CANCELLED.
+ *
+ * Returns: (transfer none): The #GCancellable of @camera
+ * Since: 2.4
+ */
+GCancellable *
+uca_camera_get_cancellable (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), NULL);
+    return camera->priv->cancellable;
+}
+
+/**
+ * uca_camera_is_recording:
+ * @camera: A #UcaCamera object
+ *
+ * Convenience function to ask the current recording status
+ *
+ * Return value: %TRUE if recording is ongoing
+ * Since: 1.5
+ */
+gboolean
+uca_camera_is_recording (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    return camera->priv->is_recording;
+}
+
+/**
+ * uca_camera_start_readout:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Initiate readout mode for cameras that support
+ * #UcaCamera:has-camram-recording after calling
+ * uca_camera_stop_recording(). Frames have to be picked up with
+ * ufo_camera_grab().
+ */
+void
+uca_camera_start_readout (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+
+    g_return_if_fail (UCA_IS_CAMERA(camera));
+
+    klass = UCA_CAMERA_GET_CLASS(camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->start_readout != NULL);
+
+    g_mutex_lock (&camera->priv->readout_lock);
+
+    if (camera->priv->is_recording) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
+                     "Camera is still recording");
+    }
+    else {
+        GError *tmp_error = NULL;
+
+        g_cancellable_reset (camera->priv->cancellable);
+        uca_camera_get_frame_info (camera, &camera->priv->frame_info);
+        camera->priv->max_frame_size = uca_frame_info_get_size (&camera->priv->frame_info);
+
+        g_mutex_lock (&camera->priv->access_lock);
+        (*klass->start_readout) (camera, &tmp_error);
+        g_mutex_unlock (&camera->priv->access_lock);
+
+        if (tmp_error == NULL) {
+            camera->priv->is_readout = TRUE;
+            g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_READOUT]);
+        }
+        else
+            g_propagate_error (error, tmp_error);
+    }
+
+    g_mutex_unlock (&camera->priv->readout_lock);
+}
+
+/**
+ * uca_camera_stop_readout:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Stop reading out frames.
+ *
+ * Since: 1.1
+ */
+void
+uca_camera_stop_readout (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+
+    g_return_if_fail (UCA_IS_CAMERA(camera));
+
+    klass = UCA_CAMERA_GET_CLASS(camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->stop_readout != NULL);
+
+    g_mutex_lock (&camera->priv->readout_lock);
+
+    if (camera->priv->is_recording) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
+                     "Camera is still recording");
+    }
+    else {
+        GError *tmp_error = NULL;
+
+        g_cancellable_cancel (camera->priv->cancellable);
+
+        g_mutex_lock (&camera->priv->access_lock);
+        (*klass->stop_readout) (camera, &tmp_error);
+        g_mutex_unlock (&camera->priv->access_lock);
+
+        if (tmp_error == NULL) {
+            camera->priv->is_readout = FALSE;
+            g_object_notify (G_OBJECT (camera), "is-readout");
+        }
+        else
+            g_propagate_error (error, tmp_error);
+    }
+
+    g_mutex_unlock (&camera->priv->readout_lock);
+}
+
+/**
+ * uca_camera_set_grab_func:
+ * @camera: A #UcaCamera object
+ * @func: (scope call): A #UcaCameraGrabFunc callback function
+ * @user_data: (closure): Data that is passed on to #func
+ *
+ * Set the grab function that is called whenever a frame is readily transfered.
+ * Unless #UcaCamera:delivery-threads is 0, it is called from a worker thread,
+ * see uca_camera_deliver_frame().
+ */
+void
+uca_camera_set_grab_func(UcaCamera *camera, UcaCameraGrabFunc func, gpointer user_data)
+{
+    camera->grab_func = func;
+    camera->user_data = user_data;
+}
+
+/**
+ * uca_camera_get_delivery_buffer:
+ * @camera: A #UcaCamera object
+ *
+ * Get a buffer of the delivery queue that a plugin can write its next frame
+ * into before passing it to uca_camera_deliver_frame(), which then queues it
+ * without copying. Calling this again before the buffer was delivered returns
+ * the same buffer. It holds a frame of the size set when recording started
+ * and belongs to the camera; if the plugin stops without delivering it, it is
+ * reclaimed by uca_camera_stop_recording().
+ *
+ * This must be called from the thread that calls uca_camera_deliver_frame().
+ *
+ * Returns: (transfer none): A buffer for the next frame, or %NULL if frames
+ * are not delivered by worker threads or all buffers are in use. In that case
+ * the plugin delivers from its own memory as before.
+ * Since: 2.4
+ */
+gpointer
+uca_camera_get_delivery_buffer (UcaCamera *camera)
+{
+    UcaCameraPrivate *priv;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), NULL);
+
+    priv = camera->priv;
+
+    if (priv->delivery_workers == NULL || camera->grab_func == NULL)
+        return NULL;
+
+    if (priv->delivery_borrowed == NULL)
+        priv->delivery_borrowed = g_async_queue_try_pop (priv->delivery_free);
+
+    return priv->delivery_borrowed != NULL ? priv->delivery_borrowed->data : NULL;
+}
+
+/**
+ * uca_camera_deliver_frame:
+ * @camera: A #UcaCamera object
+ * @data: The frame that was just acquired
+ *
+ * Pass a frame to the #UcaCameraGrabFunc set with uca_camera_set_grab_func().
+ * Plugins call this from their acquisition thread when transferring
+ * asynchronously, instead of calling the grab function themselves.
+ *
+ * Unless #UcaCamera:delivery-threads is 0, @data is copied and the callback is
+ * invoked from one of #UcaCamera:delivery-threads worker threads, so that a
+ * slow callback does not hold up acquisition and CPU-heavy callbacks can run
+ * in parallel. If #UcaCamera:delivery-ordered is %TRUE, callbacks are started
+ * in frame order. If #UcaCamera:delivery-queue-length frames are waiting or
+ * being processed, the frame is dropped and #UcaCamera:delivery-drops is
+ * incremented. @data can be reused as soon as this returns.
+ *
+ * Copying costs one pass over the frame in memory bandwidth on the
+ * acquisition thread, which matters at high frame rates. Plugins that can
+ * write a frame to any memory avoid it by passing the buffer returned by
+ * uca_camera_get_delivery_buffer() as @data, which is handed to the workers
+ * as it is.
+ *
+ * Filters added with uca_camera_add_filter() are run before the callback, in
+ * place on @data if #UcaCamera:delivery-threads is 0.
+ *
+ * This must be called from one thread at a time.
+ *
+ * Since: 2.4
+ */
+void
+uca_camera_deliver_frame (UcaCamera *camera, gpointer data)
+{
+    UcaCameraPrivate *priv;
+    DeliveryItem *item;
+    gsize size;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (data != NULL);
+
+    priv = camera->priv;
+
+    if (camera->grab_func == NULL)
+        return;
+
+    if (priv->delivery_workers == NULL) {
+        call_grab_func (camera, data, priv->delivery_next_sequence++);
+        return;
+    }
+
+    if (priv->delivery_borrowed != NULL && priv->delivery_borrowed->data == data) {
+        item = priv->delivery_borrowed;
+        priv->delivery_borrowed = NULL;
+    }
+    else {
+        item = g_async_queue_try_pop (priv->delivery_free);
+
+        if (item == NULL) {
+            g_mutex_lock (&priv->delivery_lock);
+            priv->delivery_drops++;
+            g_mutex_unlock (&priv->delivery_lock);
+            return;
+        }
+
+        size = MIN (uca_camera_get_frame_size (camera), priv->max_frame_size);
+        memcpy (item->data, data, size);
+    }
+
+    item->sequence = priv->delivery_next_sequence++;
+    workers_push (priv->delivery_workers, item);
+}
+
+#ifdef __linux__
+static gboolean
+parse_cpu_list (const gchar *list, cpu_set_t *set)
+{
+    gchar **ranges;
+    gboolean result = TRUE;
+
+    CPU_ZERO (set);
+    ranges = g_strsplit (list, ",", -1);
+
+    for (guint i = 0; result && ranges[i] != NULL; i++) {
+        gchar *range = g_strstrip (ranges[i]);
+        gchar *end;
+        guint64 first, last;
+
+        first = last = g_ascii_strtoull (range, &end, 10);
+        result = end != range;
+
+        if (result && *end == '-') {
+            range = end + 1;
+            last = g_ascii_strtoull (range, &end, 10);
+            result = end != range;
+        }
+
+        result = result && *end == '\0' && first <= last && last < CPU_SETSIZE;
+
+        for (guint64 cpu = first; result && cpu <= last; cpu++)
+            CPU_SET (cpu, set);
+    }
+
+    g_strfreev (ranges);
+    return result;
+}
+
+static gboolean
+set_affinity (const gchar *list, GError **error)
+{
+    cpu_set_t set;
+
+    if (!parse_cpu_list (list, &set)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY,
+                     "`%s' is not a valid list of CPUs", list);
+        return FALSE;
+    }
+
+    /* On Linux, pid 0 is the calling thread rather than the whole process */
+    if (sched_setaffinity (0, sizeof (cpu_set_t), &set) != 0) {
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                     "Could not run thread on CPUs %s: %s", list, g_strerror (errno));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+set_numa_node (gint node, gboolean with_cpus, GError **error)
+{
+    if (with_cpus) {
+        gchar *path;
+        gchar *list;
+        gboolean result;
+
+        path = g_strdup_printf ("/sys/devices/system/node/node%i/cpulist", node);
+        result = g_file_get_contents (path, &list, NULL, error);
+        g_free (path);
+
+        if (!result)
+            return FALSE;
+
+        result = set_affinity (g_strstrip (list), error);
+        g_free (list);
+
+        if (!result)
+            return FALSE;
+    }
+
+#ifdef SYS_set_mempolicy
+    {
+        unsigned long mask[4] = { 0, };
+        const gsize bits_per_long = sizeof (unsigned long) * 8;
+        const gsize max_node = G_N_ELEMENTS (mask) * bits_per_long;
+
+        if ((gsize) node >= max_node) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY,
+                         "NUMA node %i out of range", node);
+            return FALSE;
+        }
+
+        mask[node / bits_per_long] = 1UL << (node % bits_per_long);
+
+        /* Memory the thread touches first, like staging frames, stays local */
+        if (syscall (SYS_set_mempolicy, MPOL_PREFERRED, mask, max_node + 1) != 0) {
+            g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                         "Could not prefer memory of NUMA node %i: %s", node, g_strerror (errno));
+            return FALSE;
+        }
+    }
+#endif
+
+    return TRUE;
+}
+#endif
+
+/**
+ * uca_camera_setup_thread:
+ * @camera: A #UcaCamera object
+ * @error: Location to store an error or %NULL
+ *
+ * Move the calling thread to the CPUs of #UcaCamera:thread-cpus, give it the
+ * SCHED_FIFO priority #UcaCamera:thread-priority and let it run on and
+ * allocate from #UcaCamera:thread-numa-node. Unset properties leave the
+ * thread alone. If #UcaCamera:thread-cpus is set, it takes precedence over
+ * the CPUs of the NUMA node.
+ *
+ * libuca calls this in the thread that reads frames into the ring buffer
+ * and in the threads that call the #UcaCameraGrabFunc. Plugins should call
+ * it at the start of their own acquisition threads, so that the hot loop of
+ * each camera can be isolated on its own cores. Filter threads are left
+ * alone, so that they cannot starve acquisition.
+ *
+ * Real-time priorities usually require CAP_SYS_NICE or an RLIMIT_RTPRIO
+ * limit.
+ *
+ * Returns: %TRUE on success, %FALSE with a #UCA_CAMERA_ERROR_INVALID_PROPERTY
+ * or #GIOErrorEnum error otherwise.
+ * Since: 2.4
+ */
+gboolean
+uca_camera_setup_thread (UcaCamera *camera, GError **error)
+{
+    UcaCameraPrivate *priv;
+    gchar *cpus;
+    guint priority;
+    gint numa_node;
+    gboolean has_cpus;
+    gboolean success = FALSE;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+
+    priv = camera->priv;
+
+    /* Work on a copy, the properties may change while we apply them */
+    g_mutex_lock (&priv->thread_lock);
+    cpus = g_strdup (priv->thread_cpus);
+    priority = priv->thread_priority;
+    numa_node = priv->thread_numa_node;
+    g_mutex_unlock (&priv->thread_lock);
+
+    has_cpus = cpus != NULL && cpus[0] != '\0';
+
+    if (!has_cpus && priority == 0 && numa_node < 0) {
+        g_free (cpus);
+        return TRUE;
+    }
+
+#ifdef __linux__
+    if (numa_node >= 0 && !set_numa_node (numa_node, !has_cpus, error))
+        goto setup_thread_free;
+
+    if (has_cpus && !set_affinity (cpus, error))
+        goto setup_thread_free;
+
+    if (priority > 0) {
+        struct sched_param param = { .sched_priority = (int) priority };
+
+        if (sched_setscheduler (0, SCHED_FIFO, &param) != 0) {
+            g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                         "Could not set real-time priority %u: %s",
+                         priority, g_strerror (errno));
+            goto setup_thread_free;
+        }
+    }
+
+    success = TRUE;
+#else
+    g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
+                 "Thread placement is only supported on Linux");
+    goto setup_thread_free;
+#endif
+
+setup_thread_free:
+    g_free (cpus);
+    return success;
+}
+
+/**
+ * uca_camera_add_filter:
+ * @camera: A #UcaCamera object
+ * @filter: A #UcaFilter
+ *
+ * Append @filter to the chain that processes each frame of a recording before
+ * it is handed out. With #UcaCamera:buffered frames are filtered by
+ * #UcaCamera:filter-threads threads in parallel and written to the ring
+ * buffer in order, otherwise the chain runs in uca_camera_grab() or before
+ * the #UcaCameraGrabFunc is called. Changes take effect when the next
+ * recording starts.
+ *
+ * Filters such as #UcaContentTrigger can mark frames with #UcaFrameFlags,
+ * which appear in the #UcaRingBufferMetadata and #UcaFrameInfo of the frame.
+ * With #UcaCamera:event-gating, a buffered camera only publishes frames
+ * marked #UCA_FRAME_FLAG_TRIGGERED, the #UcaCamera:event-pre-frames before
+ * and the #UcaCamera:event-post-frames after them.
+ *
+ * Since: 2.4
+ */
+void
+uca_camera_add_filter (UcaCamera *camera, UcaFilter *filter)
+{
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (UCA_IS_FILTER (filter));
+
+    g_mutex_lock (&camera->priv->filter_lock);
+    g_ptr_array_add (camera->priv->filters, g_object_ref (filter));
+    g_mutex_unlock (&camera->priv->filter_lock);
+}
+
+/**
+ * uca_camera_remove_filter:
+ * @camera: A #UcaCamera object
+ * @filter: A #UcaFilter added with uca_camera_add_filter()
+ *
+ * Remove @filter from the chain. Changes take effect when the next recording
+ * starts.
+ *
+ * Since: 2.4
+ */
+void
+uca_camera_remove_filter (UcaCamera *camera, UcaFilter *filter)
+{
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (UCA_IS_FILTER (filter));
+
+    g_mutex_lock (&camera->priv->filter_lock);
+    g_ptr_array_remove (camera->priv->filters, filter);
+    g_mutex_unlock (&camera->priv->filter_lock);
+}
+
+/**
+ * uca_camera_is_filter_active:
+ * @camera: A #UcaCamera object
+ * @filter: A #UcaFilter
+ *
+ * Check if frames of the current recording pass through @filter. Filters use
+ * this to tell if frames they grab from @camera have already been processed
+ * by themselves.
+ *
+ * Returns: %TRUE if @camera is recording and @filter is part of the chain
+ *  fixed when the recording started.
+ * Since: 2.4
+ */
+gboolean
+uca_camera_is_filter_active (UcaCamera *camera, UcaFilter *filter)
+{
+    gboolean active = FALSE;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (UCA_IS_FILTER (filter), FALSE);
+
+    g_mutex_lock (&camera->priv->filter_lock);
+
+    if (camera->priv->active_filters != NULL) {
+        for (guint i = 0; i < camera->priv->active_filters->len && !active; i++)
+            active = g_ptr_array_index (camera->priv->active_filters, i) == (gpointer) filter;
+    }
+
+    g_mutex_unlock (&camera->priv->filter_lock);
+    return active;
+}
+
+/**
+ * uca_camera_trigger:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Trigger from software if supported by camera.
+ *
+ * You must have called uca_camera_start_recording() before, otherwise you will
+ * get a #UCA_CAMERA_ERROR_NOT_RECORDING error.
+ */
+void
+uca_camera_trigger (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->trigger != NULL);
+
+    g_mutex_lock (&camera->priv->trigger_lock);
+
+    if (!camera->priv->is_recording)
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING, "Camera is not recording");
+    else {
+        (*klass->trigger) (camera, error);
+    }
+
+    g_mutex_unlock (&camera->priv->trigger_lock);
+}
+
+/**
+ * uca_camera_write:
+ * @camera: A #UcaCamera object
+ * @name: String that identifies the written data.
+ * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
+ *  %NULL.
+ * @size: Size of the data buffer in bytes.
+ * @error: Location to store a #UcaCameraError or %NULL.
+ *
+ * Writes camera-specific @data containing @size bytes and identified by @name.
+ */
+void
+uca_camera_write (UcaCamera *camera, const gchar *name, gpointer data, gsize size, GError **error)
+{
+    UcaCameraClass *klass;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_if_fail (klass != NULL);
+
+    if (klass->write == NULL) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
+                     "`%s' does not provide a `write' method",
+                     G_OBJECT_TYPE_NAME (G_OBJECT (camera)));
+    }
+    else {
+        (*klass->write) (camera, name, data, size, error);
+    }
+}
+
+static gboolean
+call_grab (UcaCamera *camera, gpointer *buffers, guint n, guint *n_done, GError **error)
+{
+    UcaCameraClass *klass;
+    gboolean result = TRUE;
+    guint done = 0;
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_mutex_lock (&camera->priv->access_lock);
+
+    if (n > 1 && klass->grab_many != NULL) {
+        result = (*klass->grab_many) (camera, buffers, n, &done, error);
+    }
+    else {
+        while (done < n && result) {
+            result = (*klass->grab) (camera, buffers[done], error);
+
+            if (result)
+                done++;
+        }
+    }
+
+    g_mutex_unlock (&camera->priv->access_lock);
+
+    *n_done = done;
+    return result;
+}
+
+/*
+ * Run the filter chain on frames grabbed without buffering. Only the frames
+ * before the first failure count as grabbed.
+ */
+static gboolean
+filter_grabbed (UcaCamera *camera, gpointer *buffers, guint *n_done, GError **error)
+{
+    UcaCameraPrivate *priv;
+    UcaFrameInfo info;
+
+    priv = camera->priv;
+
+    for (guint i = 0; i < *n_done; i++) {
+        g_mutex_lock (&priv->metadata_lock);
+        info = priv->frame_info;
+        g_mutex_unlock (&priv->metadata_lock);
+
+        info.sequence = priv->n_grabbed + i;
+
+        if (!run_filters (camera, buffers[i], &info, error)) {
+            *n_done = i;
+            return FALSE;
+        }
+
+        priv->last_metadata.roi_width = info.width;
+        priv->last_metadata.roi_height = info.height;
+        priv->last_metadata.flags = info.flags;
+        priv->last_metadata.bitdepth = info.bitdepth;
+        priv->last_metadata.size = uca_frame_info_get_size (&info);
+    }
+
+    return TRUE;
+}
+
+/*
+ * Grab without the ring buffer. If metadata is not NULL, it receives the
+ * metadata of the last frame grabbed by this call.
+ */
+static gboolean
+grab_unbuffered (UcaCamera *camera, gpointer *buffers, guint n, guint *n_done,
+                 UcaRingBufferMetadata *metadata, GError **error)
+{
+    UcaCameraPrivate *priv;
+    gboolean result = FALSE;
+    gint64 start_time;
+
+    priv = camera->priv;
+    *n_done = 0;
+
+    g_mutex_lock (&priv->grab_lock);
+
+    if (priv->is_recording)
+        uca_camera_apply_queued_properties (camera);
+
+    start_time = g_get_monotonic_time ();
+
+    if (!priv->is_recording && !priv->is_readout) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                     "Camera is neither recording nor in readout mode");
+    }
+    else {
+#ifdef WITH_PYTHON_MULTITHREADING
+        if (Py_IsInitialized ()) {
+            PyGILState_STATE state = PyGILState_Ensure ();
+            Py_BEGIN_ALLOW_THREADS
+
+            result = call_grab (camera, buffers, n, n_done, error);
+
+            Py_END_ALLOW_THREADS
+            PyGILState_Release (state);
+        }
+        else {
+            result = call_grab (camera, buffers, n, n_done, error);
+        }
+#else
+        result = call_grab (camera, buffers, n, n_done, error);
+#endif
+
+        if (*n_done > 0) {
+            fill_metadata (camera, &priv->last_metadata, start_time);
+
+            if (priv->is_recording && priv->active_filters != NULL)
+                result = filter_grabbed (camera, buffers, n_done, result ? error : NULL) && result;
+        }
+
+        if (*n_done > 0) {
+            priv->n_grabbed += *n_done;
+            priv->last_metadata.sequence = priv->n_grabbed - 1;
+
+            if (metadata != NULL)
+                *metadata = priv->last_metadata;
+        }
+    }
+
+    g_mutex_unlock (&priv->grab_lock);
+    return result;
+}
+
+/*
+ * Number of bytes a frame stored in a ring buffer block holds. Queued updates
+ * and filters may have shrunk it below the block size.
+ */
+static gsize
+stored_frame_size (const UcaRingBufferMetadata *metadata, gsize block_size)
+{
+    return metadata->size == 0 || metadata->size > block_size ? block_size : (gsize) metadata->size;
+}
+
+/*
+ * Grab from the ring buffer. If metadata is not NULL, it receives the metadata
+ * of the last frame grabbed by this call.
+ */
+static gboolean
+grab_buffered (UcaCamera *camera, gpointer *buffers, guint n, guint *n_done,
+               UcaRingBufferMetadata *metadata, GCancellable *cancellable, GError **error)
+{
+    UcaCameraPrivate *priv;
+    const UcaRingBufferMetadata *frame_metadata;
+    gsize block_size = 0;
+
+    priv = camera->priv;
+
+    for (*n_done = 0; *n_done < n; (*n_done)++) {
+        gpointer frame;
+
+        if (!borrow_frame (camera, &frame, cancellable, error))
+            return FALSE;
+
+        if (block_size == 0)
+            block_size = uca_ring_buffer_get_block_size (priv->ring_buffer);
+
+        /* Copy only what the frame holds, queued updates may have shrunk it */
+        frame_metadata = uca_ring_buffer_get_pointer_metadata (priv->ring_buffer, frame);
+        memcpy (buffers[*n_done], frame, stored_frame_size (frame_metadata, block_size));
+
+        if (metadata != NULL)
+            *metadata = *frame_metadata;
+
+        uca_camera_grab_release (camera, frame);
+    }
+
+    return TRUE;
+}
+
+/**
+ * uca_camera_grab:
+ * @camera: A #UcaCamera object
+ * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
+ *  %NULL.
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Grab a frame a single frame and store the result in @data.
+ *
+ * You must have called uca_camera_start_recording() before, otherwise you will
+ * get a #UCA_CAMERA_ERROR_NOT_RECORDING error.
+ */
+gboolean
+uca_camera_grab (UcaCamera *camera, gpointer data, GError **error)
+{
+    UcaCameraClass *klass;
+    guint n_done;
+
+    g_return_val_if_fail (UCA_IS_CAMERA(camera), FALSE);
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_val_if_fail (klass != NULL, FALSE);
+    g_return_val_if_fail (klass->grab != NULL, FALSE);
+    g_return_val_if_fail (data != NULL, FALSE);
+
+    if (!camera->priv->buffered)
+        return grab_unbuffered (camera, &data, 1, &n_done, NULL, error);
+
+    return grab_buffered (camera, &data, 1, &n_done, NULL, NULL, error);
+}
+
+/**
+ * uca_camera_get_frame_info:
+ * @camera: A #UcaCamera object
+ * @info: (out caller-allocates): Location to store the frame description
+ *
+ * Describe the frames @camera delivers with its current region of interest
+ * and bit depth. The sequence number and timestamps are zero.
+ *
+ * Since: 2.4
+ */
+void
+uca_camera_get_frame_info (UcaCamera *camera, UcaFrameInfo *info)
+{
+    UcaCameraGeometry geometry;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (info != NULL);
+
+    uca_camera_get_geometry (camera, &geometry);
+    uca_frame_info_init (info, geometry.width, geometry.height, geometry.bitdepth);
+}
+
+/**
+ * uca_camera_get_geometry:
+ * @camera: A #UcaCamera object
+ * @geometry: (out caller-allocates): Location to store the geometry
+ *
+ * Get the size of the frames @camera currently delivers. The result is cached
+ * and only queried again from the properties after the region of interest,
+ * binning or bit depth changed, so this is cheap enough to call per frame.
+ *
+ * Since: 2.4
+ */
+void
+uca_camera_get_geometry (UcaCamera *camera, UcaCameraGeometry *geometry)
+{
+    UcaCameraPrivate *priv;
+    guint width, height, bitdepth;
+    guint serial;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (geometry != NULL);
+
+    priv = camera->priv;
+
+    g_mutex_lock (&priv->metadata_lock);
+
+    if (priv->geometry_valid) {
+        *geometry = priv->geometry;
+        g_mutex_unlock (&priv->metadata_lock);
+        return;
+    }
+
+    serial = priv->geometry_serial;
+    g_mutex_unlock (&priv->metadata_lock);
+
+    /* Query without holding the lock, notify takes it as well */
+    g_object_get (camera,
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    geometry->width = width;
+    geometry->height = height;
+    geometry->bitdepth = bitdepth;
+    geometry->pixel_size = bitdepth <= 8 ? 1 : 2;
+    geometry->frame_size = (gsize) width * height * geometry->pixel_size;
+
+    g_mutex_lock (&priv->metadata_lock);
+
+    /* Only cache it if nothing changed in the meantime */
+    if (serial == priv->geometry_serial) {
+        priv->geometry = *geometry;
+        priv->geometry_valid = TRUE;
+    }
+
+    g_mutex_unlock (&priv->metadata_lock);
+}
+
+/**
+ * uca_camera_get_frame_size:
+ * @camera: A #UcaCamera object
+ *
+ * Returns: Number of bytes of a frame with the current geometry, see
+ *  uca_camera_get_geometry().
+ * Since: 2.4
+ */
+gsize
+uca_camera_get_frame_size (UcaCamera *camera)
+{
+    UcaCameraGeometry geometry;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), 0);
+
+    uca_camera_get_geometry (camera, &geometry);
+    return geometry.frame_size;
+}
+
+/**
+ * uca_camera_get_trigger_source:
+ * @camera: A #UcaCamera object
+ *
+ * Read #UcaCamera:trigger-source without going through the property system.
+ * This returns the value stored by the base class and is meant for plugins
+ * that do not override the property, in their hot paths.
+ *
+ * Returns: The current trigger source
+ * Since: 2.4
+ */
+UcaCameraTriggerSource
+uca_camera_get_trigger_source (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), UCA_CAMERA_TRIGGER_SOURCE_AUTO);
+    return camera->priv->trigger_source;
+}
+
+/**
+ * uca_camera_get_trigger_type:
+ * @camera: A #UcaCamera object
+ *
+ * Read #UcaCamera:trigger-type without going through the property system,
+ * see uca_camera_get_trigger_source().
+ *
+ * Returns: The current trigger type
+ * Since: 2.4
+ */
+UcaCameraTriggerType
+uca_camera_get_trigger_type (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), UCA_CAMERA_TRIGGER_TYPE_EDGE);
+    return camera->priv->trigger_type;
+}
+
+/**
+ * uca_camera_get_transfer_asynchronously:
+ * @camera: A #UcaCamera object
+ *
+ * Read #UcaCamera:transfer-asynchronously without going through the property
+ * system.
+ *
+ * Returns: %TRUE if frames are delivered to the grab callback
+ * Since: 2.4
+ */
+gboolean
+uca_camera_get_transfer_asynchronously (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    return camera->priv->transfer_async;
+}
+
+/**
+ * uca_camera_grab_frame:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Grab a frame like uca_camera_grab() into a newly allocated #UcaFrame. Its
+ * #UcaFrameInfo carries the geometry of the current recording, the sequence
+ * number of the frame and the host time when grabbing started and ended, so
+ * that lost or reordered frames can be detected.
+ *
+ * Returns: (transfer full): A new #UcaFrame or %NULL on error.
+ * Since: 2.4
+ */
+UcaFrame *
+uca_camera_grab_frame (UcaCamera *camera, GError **error)
+{
+    UcaCameraPrivate *priv;
+    UcaFrame *frame;
+    UcaFrameInfo *info;
+    UcaRingBufferMetadata metadata;
+    gpointer data;
+    guint n_done;
+    gboolean result;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), NULL);
+    g_return_val_if_fail (UCA_CAMERA_GET_CLASS (camera)->grab != NULL, NULL);
+
+    priv = camera->priv;
+
+    if (!priv->is_recording && !priv->is_readout) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                     "Camera is neither recording nor in readout mode");
+        return NULL;
+    }
+
+    /* Queued updates may change the geometry up to this size before the grab */
+    frame = uca_frame_new_sized (priv->max_frame_size);
+    data = uca_frame_get_data (frame);
+
+    /* Describe the frame with its own metadata, not with the camera's latest */
+    if (priv->buffered)
+        result = grab_buffered (camera, &data, 1, &n_done, &metadata, NULL, error);
+    else
+        result = grab_unbuffered (camera, &data, 1, &n_done, &metadata, error);
+
+    if (!result) {
+        uca_frame_unref (frame);
+        return NULL;
+    }
+
+    info = uca_frame_get_info (frame);
+    uca_frame_info_init (info, metadata.roi_width, metadata.roi_height, metadata.bitdepth);
+    info->sequence = metadata.sequence;
+    info->start_time = metadata.start_timestamp;
+    info->end_time = metadata.timestamp;
+    info->settings_serial = metadata.settings_serial;
+    info->flags = metadata.flags;
+
+    return frame;
+}
+
+/**
+ * uca_camera_grab_many:
+ * @camera: A #UcaCamera object
+ * @buffers: (array length=n): Array of @n pointers to suitably sized data
+ *  buffers
+ * @n: Number of frames to grab
+ * @n_done: (out) (allow-none): Location to store the number of frames that
+ *  were grabbed or %NULL
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Grab @n consecutive frames and store them in @buffers. Locking and other
+ * per-call overhead is paid once for the whole batch and plugins that
+ * implement the grab_many virtual method can transfer all frames at once,
+ * otherwise the plugin's grab method is called for each frame.
+ *
+ * If an error occurs, @n_done holds the number of frames that were grabbed
+ * successfully before it.
+ *
+ * Returns: %TRUE if all @n frames were grabbed.
+ * Since: 2.4
+ */
+gboolean
+uca_camera_grab_many (UcaCamera *camera, gpointer *buffers, guint n, guint *n_done, GError **error)
+{
+    UcaCameraClass *klass;
+    guint done;
+
+    g_return_val_if_fail (UCA_IS_CAMERA(camera), FALSE);
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_val_if_fail (klass != NULL, FALSE);
+    g_return_val_if_fail (klass->grab != NULL, FALSE);
+    g_return_val_if_fail (buffers != NULL || n == 0, FALSE);
+
+    if (n_done == NULL)
+        n_done = &done;
+
+    if (!camera->priv->buffered)
+        return grab_unbuffered (camera, buffers, n, n_done, NULL, error);
+
+    return grab_buffered (camera, buffers, n, n_done, NULL, NULL, error);
+}
+
+static void
+grab_task_func (GTask *task, UcaCamera *camera)
+{
+    GError *error = NULL;
+    gpointer data;
+    guint n_done;
+    gboolean result;
+
+    if (g_task_return_error_if_cancelled (task)) {
+        g_object_unref (task);
+        return;
+    }
+
+    data = g_task_get_task_data (task);
+
+    if (camera->priv->buffered)
+        result = grab_buffered (camera, &data, 1, &n_done, NULL, g_task_get_cancellable (task), &error);
+    else
+        result = grab_unbuffered (camera, &data, 1, &n_done, NULL, &error);
+
+    if (result)
+        g_task_return_boolean (task, TRUE);
+    else
+        g_task_return_error (task, error);
+
+    g_object_unref (task);
+}
+
+/**
+ * uca_camera_grab_async:
+ * @camera: A #UcaCamera object
+ * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
+ *  %NULL.
+ * @cancellable: (allow-none): A #GCancellable or %NULL
+ * @callback: (scope async): Function called when the frame has been grabbed
+ * @user_data: (closure): Data passed to @callback
+ *
+ * Grab a single frame into @data like uca_camera_grab() without blocking the
+ * caller. The frame is grabbed on a worker thread and @callback is invoked in
+ * the thread-default main context of the calling thread, where it should call
+ * uca_camera_grab_finish() to obtain the result. @data must stay valid until
+ * then.
+ *
+ * Grabs of one camera run one after the other on a worker thread that
+ * belongs to @camera, so that waiting for frames does not occupy threads that
+ * GIO shares with other users.
+ *
+ * Cancelling @cancellable makes the grab fail with %G_IO_ERROR_CANCELLED. In
+ * buffered mode this also interrupts a grab that already waits for a frame.
+ * Unbuffered grabs that already wait in the plugin cannot be interrupted
+ * until the plugin returns or recording is stopped.
+ *
+ * Since: 2.4
+ */
+void
+uca_camera_grab_async (UcaCamera *camera, gpointer data, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+    UcaCameraPrivate *priv;
+    GTask *task;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (data != NULL);
+
+    priv = camera->priv;
+
+    if (g_once_init_enter (&priv->grab_pool)) {
+        GThreadPool *pool;
+
+        pool = g_thread_pool_new ((GFunc) grab_task_func, camera, 1, FALSE, NULL);
+        g_once_init_leave (&priv->grab_pool, pool);
+    }
+
+    task = g_task_new (camera, cancellable, callback, user_data);
+    g_task_set_task_data (task, data, NULL);
+    g_thread_pool_push (priv->grab_pool, task, NULL);
+}
+
+/**
+ * uca_camera_grab_finish:
+ * @camera: A #UcaCamera object
+ * @result: The #GAsyncResult passed to the callback of
+ *  uca_camera_grab_async()
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Finish a grab started with uca_camera_grab_async().
+ *
+ * Returns: %TRUE if the frame was grabbed.
+ * Since: 2.4
+ */
+gboolean
+uca_camera_grab_finish (UcaCamera *camera, GAsyncResult *result, GError **error)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (g_task_is_valid (result, camera), FALSE);
 
-start_recording_unlock:
-    g_mutex_unlock (&mutex);
+    return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 /**
- * uca_camera_stop_recording:
+ * uca_camera_grab_borrow:
  * @camera: A #UcaCamera object
+ * @frame: (out) (transfer none): Location to store a pointer to the frame
  * @error: Location to store a #UcaCameraError error or %NULL
  *
- * Stop recording.
+ * Grab the next frame in buffered mode without copying it. @frame points
+ * directly into the internal ring buffer and is not overwritten until it is
+ * given back with uca_camera_grab_release(). Frames that are still borrowed
+ * when recording stops stay valid, but their blocks are not reused by the next
+ * recording until they are released.
+ *
+ * If #UcaCamera:grab-mode is #UCA_CAMERA_GRAB_MODE_LATEST, the most recently
+ * acquired frame is grabbed instead of the oldest one, so that latency stays
+ * at one frame period however slow the consumer is. Older frames are skipped
+ * and counted in #UcaCamera:grab-skipped. This also applies to
+ * uca_camera_grab() and uca_camera_grab_frame() in buffered mode.
+ *
+ * Returns: %TRUE on success.
+ * Since: 2.4
  */
-void
-uca_camera_stop_recording (UcaCamera *camera, GError **error)
+gboolean
+uca_camera_grab_borrow (UcaCamera *camera, gpointer *frame, GError **error)
 {
-    UcaCameraClass *klass;
-    UcaCameraPrivate *priv;
-    static GMutex mutex;
-    GError *tmp_error = NULL;
-
-    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (frame != NULL, FALSE);
 
-    klass = UCA_CAMERA_GET_CLASS (camera);
+    return borrow_frame (camera, frame, NULL, error);
+}
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->stop_recording != NULL);
+static gboolean
+borrow_frame (UcaCamera *camera, gpointer *frame, GCancellable *cancellable, GError **error)
+{
+    UcaCameraPrivate *priv;
+    UcaRingBuffer *buffer;
+    gboolean success = FALSE;
 
     priv = camera->priv;
+    *frame = NULL;
+
+    if (!priv->buffered) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
+                     "Frames can only be borrowed in buffered mode");
+        return FALSE;
+    }
 
-    g_mutex_lock (&mutex);
+    /*
+     * The buffer may be retired or replaced by a concurrent start or stop, so
+     * hold our own reference while we wait on it.
+     */
+    g_mutex_lock (&priv->buffer_lock);
+    buffer = priv->ring_buffer != NULL ? g_object_ref (priv->ring_buffer) : NULL;
+    g_mutex_unlock (&priv->buffer_lock);
 
-    if (!priv->is_recording) {
+    if (!priv->is_recording || buffer == NULL) {
         g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
                      "Camera is not recording");
-        goto error_stop_recording;
+        goto borrow_frame_unref;
     }
 
-    priv->cancelling_recording = TRUE;
+    /*
+     * Sleep until the read thread published a frame. Wake up from time to
+     * time to make sure we do not wait for a thread that has given up.
+     */
+    while (!uca_ring_buffer_wait_readable (buffer, BUFFERED_GRAB_POLL_TIMEOUT)) {
+        if (g_cancellable_set_error_if_cancelled (cancellable, error))
+            goto borrow_frame_unref;
 
-    if (priv->buffered) {
-        g_thread_join (priv->read_thread);
-        priv->read_thread = NULL;
+        if (g_atomic_int_get (&priv->read_thread_finished) &&
+            !uca_ring_buffer_available (buffer))
+            break;
     }
 
-    g_mutex_lock (&access_lock);
-
-    (*klass->stop_recording)(camera, &tmp_error);
-    priv->cancelling_recording = FALSE;
-
-    g_mutex_unlock (&access_lock);
+    if (priv->grab_mode == UCA_CAMERA_GRAB_MODE_LATEST) {
+        guint64 n_skipped;
 
-    if (tmp_error == NULL) {
-        priv->is_recording = FALSE;
-        priv->is_readout = FALSE;
-        g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_RECORDING]);
+        *frame = uca_ring_buffer_borrow_newest_pointer (buffer, &n_skipped);
+        g_atomic_pointer_add (&priv->grab_skipped, (gssize) n_skipped);
     }
     else
-        g_propagate_error (error, tmp_error);
+        *frame = uca_ring_buffer_borrow_read_pointer (buffer);
 
-    if (camera->priv->ring_buffer != NULL) {
-        g_object_unref (camera->priv->ring_buffer);
-        camera->priv->ring_buffer = NULL;
+    if (*frame == NULL) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM,
+                     "Ring buffer is empty");
+        goto borrow_frame_unref;
     }
 
-error_stop_recording:
-    g_mutex_unlock (&mutex);
-}
+    priv->last_metadata = *uca_ring_buffer_get_pointer_metadata (buffer, *frame);
+    clear_frame_fd (priv);
 
-/**
- * uca_camera_is_recording:
- * @camera: A #UcaCamera object
- *
- * Convenience function to ask the current recording status
- *
- * Return value: %TRUE if recording is ongoing
- * Since: 1.5
- */
-gboolean
-uca_camera_is_recording (UcaCamera *camera)
-{
-    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
-    return camera->priv->is_recording;
+    /*
+     * If the buffer was given up while we waited, it may have been unreffed
+     * because nothing was borrowed at that time. Hand our reference over to
+     * the retired list so the frame stays valid until it is released.
+     */
+    g_mutex_lock (&priv->buffer_lock);
+
+    if (buffer != priv->ring_buffer && g_slist_find (priv->retired_buffers, buffer) == NULL) {
+        priv->retired_buffers = g_slist_prepend (priv->retired_buffers, buffer);
+        buffer = NULL;
+    }
+
+    g_mutex_unlock (&priv->buffer_lock);
+    success = TRUE;
+
+borrow_frame_unref:
+    if (buffer != NULL)
+        g_object_unref (buffer);
+
+    return success;
 }
 
 /**
- * uca_camera_start_readout:
+ * uca_camera_grab_release:
  * @camera: A #UcaCamera object
- * @error: Location to store a #UcaCameraError error or %NULL
+ * @frame: Frame returned by uca_camera_grab_borrow()
  *
- * Initiate readout mode for cameras that support
- * #UcaCamera:has-camram-recording after calling
- * uca_camera_stop_recording(). Frames have to be picked up with
- * ufo_camera_grab().
+ * Give a borrowed frame back to the ring buffer so that it can be reused for
+ * new frames. Frames stay valid until they are released, even if a new
+ * recording has started in the meantime.
+ *
+ * Since: 2.4
  */
 void
-uca_camera_start_readout (UcaCamera *camera, GError **error)
+uca_camera_grab_release (UcaCamera *camera, gpointer frame)
 {
-    UcaCameraClass *klass;
-    static GMutex mutex;
+    UcaCameraPrivate *priv;
+    UcaRingBuffer *buffer;
 
-    g_return_if_fail (UCA_IS_CAMERA(camera));
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    priv = camera->priv;
 
-    klass = UCA_CAMERA_GET_CLASS(camera);
+    g_mutex_lock (&priv->buffer_lock);
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->start_readout != NULL);
+    if (priv->ring_buffer != NULL && uca_ring_buffer_contains (priv->ring_buffer, frame)) {
+        uca_ring_buffer_release_read_pointer (priv->ring_buffer, frame);
+        g_mutex_unlock (&priv->buffer_lock);
+        return;
+    }
 
-    g_mutex_lock (&mutex);
+    /* Borrowed during an earlier recording from a buffer replaced since */
+    for (GSList *it = priv->retired_buffers; it != NULL; it = g_slist_next (it)) {
+        buffer = UCA_RING_BUFFER (it->data);
 
-    if (camera->priv->is_recording) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
-                     "Camera is still recording");
-    }
-    else {
-        GError *tmp_error = NULL;
+        if (!uca_ring_buffer_contains (buffer, frame))
+            continue;
 
-        g_mutex_lock (&access_lock);
-        (*klass->start_readout) (camera, &tmp_error);
-        g_mutex_unlock (&access_lock);
+        uca_ring_buffer_release_read_pointer (buffer, frame);
 
-        if (tmp_error == NULL) {
-            camera->priv->is_readout = TRUE;
-            g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_READOUT]);
+        if (uca_ring_buffer_get_num_borrowed (buffer) == 0) {
+            priv->retired_buffers = g_slist_delete_link (priv->retired_buffers, it);
+            g_object_unref (buffer);
         }
-        else
-            g_propagate_error (error, tmp_error);
+
+        g_mutex_unlock (&priv->buffer_lock);
+        return;
     }
 
-    g_mutex_unlock (&mutex);
+    g_mutex_unlock (&priv->buffer_lock);
+    g_warning ("Frame %p was not borrowed from this camera", frame);
 }
 
 /**
- * uca_camera_stop_readout:
+ * uca_camera_get_frame_fd:
  * @camera: A #UcaCamera object
- * @error: Location to store a #UcaCameraError error or %NULL
  *
- * Stop reading out frames.
+ * Get a file descriptor that polls readable while a frame can be borrowed
+ * without blocking in buffered mode, and when the read thread has stopped.
+ * It can be used with poll(), epoll or a main loop to wait for frames of many
+ * cameras from a single thread. The descriptor is owned by @camera and must
+ * not be read, written or closed by the caller.
  *
- * Since: 1.1
+ * Returns: A file descriptor or -1 if it is not supported on this platform.
+ * Since: 2.4
  */
-void
-uca_camera_stop_readout (UcaCamera *camera, GError **error)
+gint
+uca_camera_get_frame_fd (UcaCamera *camera)
 {
-    UcaCameraClass *klass;
-    static GMutex mutex;
+    UcaCameraPrivate *priv;
 
-    g_return_if_fail (UCA_IS_CAMERA(camera));
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), -1);
+    priv = camera->priv;
 
-    klass = UCA_CAMERA_GET_CLASS(camera);
+#ifdef __linux__
+    g_mutex_lock (&priv->recording_lock);
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->stop_readout != NULL);
+    if (priv->frame_fd < 0) {
+        gint fd;
 
-    g_mutex_lock (&mutex);
+        fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
 
-    if (camera->priv->is_recording) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
-                     "Camera is still recording");
-    }
-    else {
-        GError *tmp_error = NULL;
+        if (fd < 0)
+            g_warning ("Could not create frame fd: %s", g_strerror (errno));
 
-        g_mutex_lock (&access_lock);
-        (*klass->stop_readout) (camera, &tmp_error);
-        g_mutex_unlock (&access_lock);
+        g_atomic_int_set (&priv->frame_fd, fd);
 
-        if (tmp_error == NULL) {
-            camera->priv->is_readout = FALSE;
-            g_object_notify (G_OBJECT (camera), "is-readout");
-        }
-        else
-            g_propagate_error (error, tmp_error);
+        if (priv->ring_buffer != NULL && uca_ring_buffer_available (priv->ring_buffer))
+            signal_frame_fd (priv);
     }
 
-    g_mutex_unlock (&mutex);
+    g_mutex_unlock (&priv->recording_lock);
+    return priv->frame_fd;
+#else
+    return -1;
+#endif
 }
 
-/**
- * uca_camera_set_grab_func:
- * @camera: A #UcaCamera object
- * @func: (scope call): A #UcaCameraGrabFunc callback function
- * @user_data: (closure): Data that is passed on to #func
- *
- * Set the grab function that is called whenever a frame is readily transfered.
- */
-void
-uca_camera_set_grab_func(UcaCamera *camera, UcaCameraGrabFunc func, gpointer user_data)
+typedef struct {
+    GSource source;
+    UcaCamera *camera;
+} UcaFrameSource;
+
+static gboolean
+frame_source_dispatch (GSource *source, GSourceFunc callback, gpointer user_data)
 {
-    camera->grab_func = func;
-    camera->user_data = user_data;
+    UcaFrameSource *frame_source = (UcaFrameSource *) source;
+
+    if (callback == NULL)
+        return TRUE;
+
+    return ((UcaCameraFrameSourceFunc) callback) (frame_source->camera, user_data);
+}
+
+static void
+frame_source_finalize (GSource *source)
+{
+    g_object_unref (((UcaFrameSource *) source)->camera);
 }
 
+static GSourceFuncs frame_source_funcs = {
+    NULL,
+    NULL,
+    frame_source_dispatch,
+    frame_source_finalize,
+};
+
 /**
- * uca_camera_trigger:
+ * uca_camera_frame_source_new:
  * @camera: A #UcaCamera object
- * @error: Location to store a #UcaCameraError error or %NULL
  *
- * Trigger from software if supported by camera.
+ * Create a #GSource that is dispatched while a frame can be borrowed from
+ * @camera in buffered mode, see uca_camera_get_frame_fd(). Set a
+ * #UcaCameraFrameSourceFunc with g_source_set_callback(), which should
+ * borrow or grab the frame, and attach the source to a #GMainContext.
  *
- * You must have called uca_camera_start_recording() before, otherwise you will
- * get a #UCA_CAMERA_ERROR_NOT_RECORDING error.
+ * Returns: (transfer full): A new #GSource or %NULL if frame notification is
+ *  not supported on this platform.
+ * Since: 2.4
  */
-void
-uca_camera_trigger (UcaCamera *camera, GError **error)
+GSource *
+uca_camera_frame_source_new (UcaCamera *camera)
 {
-    UcaCameraClass *klass;
-    static GMutex mutex;
-
-    g_return_if_fail (UCA_IS_CAMERA (camera));
+    GSource *source;
+    gint fd;
 
-    klass = UCA_CAMERA_GET_CLASS (camera);
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), NULL);
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->trigger != NULL);
+    fd = uca_camera_get_frame_fd (camera);
 
-    g_mutex_lock (&mutex);
+    if (fd < 0)
+        return NULL;
 
-    if (!camera->priv->is_recording)
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING, "Camera is not recording");
-    else {
-        (*klass->trigger) (camera, error);
-    }
+    source = g_source_new (&frame_source_funcs, sizeof (UcaFrameSource));
+    g_source_set_name (source, "UcaFrameSource");
+    g_source_add_unix_fd (source, fd, G_IO_IN);
+    ((UcaFrameSource *) source)->camera = g_object_ref (camera);
 
-    g_mutex_unlock (&mutex);
+    return source;
 }
 
 /**
- * uca_camera_write:
+ * uca_camera_get_last_metadata:
  * @camera: A #UcaCamera object
- * @name: String that identifies the written data.
- * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
- *  %NULL.
- * @size: Size of the data buffer in bytes.
- * @error: Location to store a #UcaCameraError or %NULL.
+ * @metadata: (out caller-allocates): Location to store the metadata
  *
- * Writes camera-specific @data containing @size bytes and identified by @name.
+ * Get the metadata of the frame most recently returned by uca_camera_grab() or
+ * uca_camera_grab_borrow(). Sequence numbers start at zero with each recording
+ * and, in buffered mode, include frames that were lost in the ring buffer.
+ *
+ * Since: 2.4
  */
 void
-uca_camera_write (UcaCamera *camera, const gchar *name, gpointer data, gsize size, GError **error)
+uca_camera_get_last_metadata (UcaCamera *camera, UcaRingBufferMetadata *metadata)
 {
-    UcaCameraClass *klass;
-
     g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (metadata != NULL);
 
-    klass = UCA_CAMERA_GET_CLASS (camera);
-
-    g_return_if_fail (klass != NULL);
-
-    if (klass->write == NULL) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
-                     "`%s' does not provide a `write' method",
-                     G_OBJECT_TYPE_NAME (G_OBJECT (camera)));
-    }
-    else {
-        (*klass->write) (camera, name, data, size, error);
-    }
+    *metadata = camera->priv->last_metadata;
 }
 
 /**
- * uca_camera_grab:
+ * uca_camera_freeze:
  * @camera: A #UcaCamera object
- * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
- *  %NULL.
+ * @n_post_frames: Number of frames to record after the event
  * @error: Location to store a #UcaCameraError error or %NULL
  *
- * Grab a frame a single frame and store the result in @data.
+ * Software equivalent of camRAM recording for buffered cameras. While
+ * recording, the ring buffer continuously holds the last
+ * #UcaCamera:num-buffers frames. This function records @n_post_frames more
+ * frames and then stops filling the buffer, so that it contains
+ * #UcaCamera:num-buffers - @n_post_frames frames preceding the call and
+ * @n_post_frames following it. The frames can then be read with
+ * uca_camera_readout() where index 0 is the oldest frame, with or without
+ * stopping the recording first.
  *
- * You must have called uca_camera_start_recording() before, otherwise you will
- * get a #UCA_CAMERA_ERROR_NOT_RECORDING error.
+ * The ring buffer only holds the frames preceding the call with the
+ * #UCA_RING_BUFFER_POLICY_OVERWRITE_OLDEST #UcaCamera:buffer-policy. With the
+ * other policies, it holds the oldest frames that were not grabbed yet.
+ *
+ * This blocks until the post-event frames have been recorded or the
+ * recording is stopped with uca_camera_stop_recording() from another thread,
+ * which fails with #UCA_CAMERA_ERROR_NOT_RECORDING.
+ *
+ * Returns: %TRUE on success.
+ * Since: 2.4
  */
 gboolean
-uca_camera_grab (UcaCamera *camera, gpointer data, GError **error)
+uca_camera_freeze (UcaCamera *camera, guint n_post_frames, GError **error)
 {
-    UcaCameraClass *klass;
-    gboolean result = FALSE;
+    UcaCameraPrivate *priv;
+    GThread *read_thread;
+    GError *thread_error;
 
-    /* FIXME: this prevents accessing two independent cameras simultanously. */
-    static GMutex mutex;
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    priv = camera->priv;
 
-    g_return_val_if_fail (UCA_IS_CAMERA(camera), FALSE);
+    if (!priv->buffered) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
+                     "Freezing is only possible in buffered mode");
+        return FALSE;
+    }
 
-    klass = UCA_CAMERA_GET_CLASS (camera);
+    g_mutex_lock (&priv->recording_lock);
 
-    g_return_val_if_fail (klass != NULL, FALSE);
-    g_return_val_if_fail (klass->grab != NULL, FALSE);
-    g_return_val_if_fail (data != NULL, FALSE);
+    if (!priv->is_recording || priv->read_thread == NULL) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                     "Camera is not recording");
+        g_mutex_unlock (&priv->recording_lock);
+        return FALSE;
+    }
 
-    if (!camera->priv->buffered) {
-        g_mutex_lock (&mutex);
+    priv->n_post_frames = n_post_frames;
+    g_atomic_int_set (&priv->freeze_requested, TRUE);
 
-        if (!camera->priv->is_recording && !camera->priv->is_readout) {
-            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
-                         "Camera is neither recording nor in readout mode");
-        }
-        else {
-#ifdef WITH_PYTHON_MULTITHREADING
-            if (Py_IsInitialized ()) {
-                PyGILState_STATE state = PyGILState_Ensure ();
-                Py_BEGIN_ALLOW_THREADS
+    /*
+     * The post-event frames may never come, so wait without the lock to let
+     * uca_camera_stop_recording() cancel the read thread
+     */
+    read_thread = priv->read_thread;
+    priv->read_thread = NULL;
+    priv->freezing = TRUE;
+    g_mutex_unlock (&priv->recording_lock);
 
-                g_mutex_lock (&access_lock);
-                result = (*klass->grab) (camera, data, error);
-                g_mutex_unlock (&access_lock);
+    thread_error = g_thread_join (read_thread);
 
-                Py_END_ALLOW_THREADS
-                PyGILState_Release (state);
-            }
-            else {
-                g_mutex_lock (&access_lock);
-                result = (*klass->grab) (camera, data, error);
-                g_mutex_unlock (&access_lock);
-            }
-#else
-            g_mutex_lock (&access_lock);
-            result = (*klass->grab) (camera, data, error);
-            g_mutex_unlock (&access_lock);
-#endif
-        }
+    g_mutex_lock (&priv->recording_lock);
+    priv->freezing = FALSE;
+    g_cond_broadcast (&priv->freeze_cond);
 
-        g_mutex_unlock (&mutex);
+    if (thread_error != NULL) {
+        g_propagate_error (error, thread_error);
+        g_mutex_unlock (&priv->recording_lock);
+        return FALSE;
     }
-    else {
-        gpointer buffer;
 
-        if (camera->priv->ring_buffer == NULL)
-            return FALSE;
+    if (priv->cancelling_recording) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                     "Recording stopped before the post-event frames were recorded");
+        g_mutex_unlock (&priv->recording_lock);
+        return FALSE;
+    }
 
-        /*
-         * Spin-lock until we can read something. This shouldn't happen to
-         * often, as buffering is usually used in those cases when the camera is
-         * faster than the software.
-         */
-        while (!uca_ring_buffer_available (camera->priv->ring_buffer))
-            ;
+    priv->frozen = TRUE;
+    g_mutex_unlock (&priv->recording_lock);
+    return TRUE;
+}
+
+static gboolean
+readout_frozen (UcaCamera *camera, gpointer data, guint index, GError **error)
+{
+    UcaRingBuffer *ring;
+    const UcaRingBufferMetadata *metadata;
+    guint n_frames;
+    gpointer frame;
 
-        buffer = uca_ring_buffer_get_read_pointer (camera->priv->ring_buffer);
+    ring = camera->priv->ring_buffer;
+    n_frames = uca_ring_buffer_get_num_blocks (ring);
 
-        if (buffer == NULL) {
-            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM,
-                         "Ring buffer is empty");
-        }
-        else {
-            memcpy (data, buffer, uca_ring_buffer_get_block_size (camera->priv->ring_buffer));
-            result = TRUE;
-        }
+    if (index >= n_frames) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM,
+                     "Frame %u not available, only %u frames were frozen", index, n_frames);
+        return FALSE;
     }
-    return result;
+
+    frame = uca_ring_buffer_get_stored_pointer (ring, index);
+    metadata = uca_ring_buffer_get_pointer_metadata (ring, frame);
+
+    /* The caller sized data for the current frames, which may be smaller */
+    memcpy (data, frame, stored_frame_size (metadata, uca_ring_buffer_get_block_size (ring)));
+    camera->priv->last_metadata = *metadata;
+
+    return TRUE;
 }
 
 /**
@@ -1185,7 +4283,8 @@ uca_camera_grab (UcaCamera *camera, gpointer data, GError **error)
  * Grab a frame a single frame and store the result in @data.
  *
  * You must have called uca_camera_start_recording() before, otherwise you will
- * get a #UCA_CAMERA_ERROR_NOT_RECORDING error.
+ * get a #UCA_CAMERA_ERROR_NOT_RECORDING error. In buffered mode, frames can
+ * only be read after uca_camera_freeze().
  *
  * Since: 2.1
  */
@@ -1195,31 +4294,32 @@ uca_camera_readout (UcaCamera *camera, gpointer data, guint index, GError **erro
     UcaCameraClass *klass;
     gboolean result = FALSE;
 
-    /* FIXME: this prevents accessing two independent cameras simultanously. */
-    static GMutex mutex;
 
     g_return_val_if_fail (UCA_IS_CAMERA(camera), FALSE);
 
     klass = UCA_CAMERA_GET_CLASS (camera);
 
     g_return_val_if_fail (klass != NULL, FALSE);
-    g_return_val_if_fail (klass->readout != NULL, FALSE);
-    g_return_val_if_fail (data != NULL, FALSE);
 
     if (camera->priv->buffered) {
+        if (camera->priv->frozen)
+            return readout_frozen (camera, data, index, error);
+
         g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
                      "Cannot grab specific frame in buffered mode");
         return FALSE;
     }
 
-    g_mutex_lock (&mutex);
+    g_return_val_if_fail (klass->readout != NULL, FALSE);
+
+    g_mutex_lock (&camera->priv->grab_lock);
 
     if (!camera->priv->is_recording && !camera->priv->is_readout) {
         g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
                      "Camera is not in readout or record mode");
     }
     else {
-        g_mutex_lock (&access_lock);
+        g_mutex_lock (&camera->priv->access_lock);
 
 #ifdef WITH_PYTHON_MULTITHREADING
         if (Py_IsInitialized ()) {
@@ -1238,10 +4338,10 @@ uca_camera_readout (UcaCamera *camera, gpointer data, guint index, GError **erro
         result = (*klass->readout) (camera, data, index, error);
 #endif
 
-        g_mutex_unlock (&access_lock);
+        g_mutex_unlock (&camera->priv->access_lock);
     }
 
-    g_mutex_unlock (&mutex);
+    g_mutex_unlock (&camera->priv->grab_lock);
 
     return result;
 }
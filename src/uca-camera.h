@@ -19,6 +19,10 @@
 #define __UCA_CAMERA_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
+#include "uca-ring-buffer.h"
+#include "uca-frame.h"
+#include "uca-filter.h"
 
 G_BEGIN_DECLS
 
@@ -47,6 +51,7 @@ typedef enum {
     UCA_CAMERA_ERROR_END_OF_STREAM,
     UCA_CAMERA_ERROR_TIMEOUT,
     UCA_CAMERA_ERROR_DEVICE,
+    UCA_CAMERA_ERROR_INVALID_PROPERTY,
 } UcaCameraError;
 
 typedef enum {
@@ -60,6 +65,20 @@ typedef enum {
     UCA_CAMERA_TRIGGER_TYPE_LEVEL
 } UcaCameraTriggerType;
 
+/**
+ * UcaCameraGrabMode:
+ * @UCA_CAMERA_GRAB_MODE_FIFO: Grab buffered frames in the order they were
+ *  acquired
+ * @UCA_CAMERA_GRAB_MODE_LATEST: Grab the newest buffered frame and skip older
+ *  ones
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_CAMERA_GRAB_MODE_FIFO,
+    UCA_CAMERA_GRAB_MODE_LATEST
+} UcaCameraGrabMode;
+
 typedef enum {
     UCA_UNIT_NA = 0,
     UCA_UNIT_METER,
@@ -104,11 +123,51 @@ enum {
 
     PROP_BUFFERED,
     PROP_NUM_BUFFERS,
+    PROP_BUFFER_ALLOC_FLAGS,
+    PROP_BUFFER_ALIGNMENT,
+    PROP_BUFFER_NUMA_NODE,
+    PROP_BUFFER_POLICY,
+    PROP_BUFFER_OVERRUNS,
+    PROP_BUFFER_MAX_FILL,
+
+    PROP_DELIVERY_THREADS,
+    PROP_DELIVERY_ORDERED,
+    PROP_DELIVERY_QUEUE_LENGTH,
+    PROP_DELIVERY_DROPS,
+    PROP_FILTER_THREADS,
+    PROP_EVENT_GATING,
+    PROP_EVENT_PRE_FRAMES,
+    PROP_EVENT_POST_FRAMES,
+    PROP_GRAB_MODE,
+    PROP_GRAB_SKIPPED,
+    PROP_THREAD_CPUS,
+    PROP_THREAD_PRIORITY,
+    PROP_THREAD_NUMA_NODE,
     N_BASE_PROPERTIES
 };
 
 extern const gchar *uca_camera_props[N_BASE_PROPERTIES];
 
+/**
+ * UcaCameraGeometry:
+ * @width: Width of a frame in pixels
+ * @height: Height of a frame in pixels
+ * @bitdepth: Number of significant bits per pixel
+ * @pixel_size: Number of bytes per pixel
+ * @frame_size: Number of bytes per frame
+ *
+ * Size of the frames delivered by a camera, see uca_camera_get_geometry().
+ *
+ * Since: 2.4
+ */
+typedef struct {
+    guint   width;
+    guint   height;
+    guint   bitdepth;
+    guint   pixel_size;
+    gsize   frame_size;
+} UcaCameraGeometry;
+
 /**
  * UcaCameraGrabFunc:
  * @data: a pointer to the raw data
@@ -118,6 +177,18 @@ extern const gchar *uca_camera_props[N_BASE_PROPERTIES];
  */
 typedef void (*UcaCameraGrabFunc) (gpointer data, gpointer user_data);
 
+/**
+ * UcaCameraFrameSourceFunc:
+ * @camera: The #UcaCamera with a frame ready
+ * @user_data: user data passed to g_source_set_callback()
+ *
+ * Callback for the #GSource returned by uca_camera_frame_source_new().
+ *
+ * Returns: %FALSE to remove the source.
+ * Since: 2.4
+ */
+typedef gboolean (*UcaCameraFrameSourceFunc) (UcaCamera *camera, gpointer user_data);
+
 struct _UcaCamera {
     /*< private >*/
     GObject parent;
@@ -145,6 +216,8 @@ struct _UcaCameraClass {
     void (*write)           (UcaCamera *camera, const gchar *name, gpointer data, gsize size, GError **error);
     gboolean (*grab)        (UcaCamera *camera, gpointer data, GError **error);
     gboolean (*readout)     (UcaCamera *camera, gpointer data, guint index, GError **error);
+    gboolean (*grab_many)   (UcaCamera *camera, gpointer *buffers, guint n, guint *n_done, GError **error);
+    gboolean (*commit)      (UcaCamera *camera, GError **error);
 };
 
 UcaCamera * uca_camera_new              (const gchar        *type,
@@ -153,11 +226,24 @@ gboolean    uca_camera_parse_arg_props  (UcaCamera          *camera,
                                          gchar             **argv,
                                          guint               argc,
                                          GError            **error);
+gboolean    uca_camera_set_properties   (UcaCamera          *camera,
+                                         guint               n,
+                                         const gchar       **names,
+                                         const GValue       *values,
+                                         GError            **error);
+gboolean    uca_camera_is_batch_pending (UcaCamera          *camera);
+gboolean    uca_camera_queue_property   (UcaCamera          *camera,
+                                         GParamSpec         *pspec,
+                                         const GValue       *value);
+void        uca_camera_apply_queued_properties
+                                        (UcaCamera          *camera);
 void        uca_camera_start_recording  (UcaCamera          *camera,
                                          GError            **error);
 void        uca_camera_stop_recording   (UcaCamera          *camera,
                                          GError            **error);
 gboolean    uca_camera_is_recording     (UcaCamera          *camera);
+GCancellable *
+            uca_camera_get_cancellable  (UcaCamera          *camera);
 void        uca_camera_start_readout    (UcaCamera          *camera,
                                          GError            **error);
 void        uca_camera_stop_readout     (UcaCamera          *camera,
@@ -173,6 +259,46 @@ gboolean    uca_camera_grab             (UcaCamera          *camera,
                                          gpointer            data,
                                          GError            **error)
                                         __attribute__((nonnull (2)));
+void        uca_camera_get_geometry     (UcaCamera          *camera,
+                                         UcaCameraGeometry  *geometry);
+gsize       uca_camera_get_frame_size   (UcaCamera          *camera);
+UcaCameraTriggerSource
+            uca_camera_get_trigger_source
+                                        (UcaCamera          *camera);
+UcaCameraTriggerType
+            uca_camera_get_trigger_type (UcaCamera          *camera);
+gboolean    uca_camera_get_transfer_asynchronously
+                                        (UcaCamera          *camera);
+void        uca_camera_get_frame_info   (UcaCamera          *camera,
+                                         UcaFrameInfo       *info);
+UcaFrame *  uca_camera_grab_frame       (UcaCamera          *camera,
+                                         GError            **error);
+gboolean    uca_camera_grab_many        (UcaCamera          *camera,
+                                         gpointer           *buffers,
+                                         guint               n,
+                                         guint              *n_done,
+                                         GError            **error);
+void        uca_camera_grab_async       (UcaCamera          *camera,
+                                         gpointer            data,
+                                         GCancellable       *cancellable,
+                                         GAsyncReadyCallback callback,
+                                         gpointer            user_data);
+gboolean    uca_camera_grab_finish      (UcaCamera          *camera,
+                                         GAsyncResult       *result,
+                                         GError            **error);
+gboolean    uca_camera_grab_borrow      (UcaCamera          *camera,
+                                         gpointer           *frame,
+                                         GError            **error);
+void        uca_camera_grab_release     (UcaCamera          *camera,
+                                         gpointer            frame);
+void        uca_camera_get_last_metadata
+                                        (UcaCamera          *camera,
+                                         UcaRingBufferMetadata *metadata);
+gint        uca_camera_get_frame_fd     (UcaCamera          *camera);
+GSource *   uca_camera_frame_source_new (UcaCamera          *camera);
+gboolean    uca_camera_freeze           (UcaCamera          *camera,
+                                         guint               n_post_frames,
+                                         GError            **error);
 gboolean    uca_camera_readout          (UcaCamera          *camera,
                                          gpointer            data,
                                          guint               index,
@@ -181,6 +307,18 @@ gboolean    uca_camera_readout          (UcaCamera          *camera,
 void        uca_camera_set_grab_func    (UcaCamera          *camera,
                                          UcaCameraGrabFunc   func,
                                          gpointer            user_data);
+gpointer    uca_camera_get_delivery_buffer
+                                        (UcaCamera          *camera);
+void        uca_camera_deliver_frame    (UcaCamera          *camera,
+                                         gpointer            data);
+gboolean    uca_camera_setup_thread     (UcaCamera          *camera,
+                                         GError            **error);
+void        uca_camera_add_filter       (UcaCamera          *camera,
+                                         UcaFilter          *filter);
+void        uca_camera_remove_filter    (UcaCamera          *camera,
+                                         UcaFilter          *filter);
+gboolean    uca_camera_is_filter_active (UcaCamera          *camera,
+                                         UcaFilter          *filter);
 void        uca_camera_register_unit    (UcaCamera          *camera,
                                          const gchar        *prop_name,
                                          UcaUnit             unit);
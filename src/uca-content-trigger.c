@@ -0,0 +1,793 @@
+/* Copyright (C) 2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-content-trigger
+ * @Short_description: Software trigger on frame content
+ * @Title: UcaContentTrigger
+ *
+ * A #UcaFilter that computes a statistic over a region of each frame and sets
+ * #UCA_FRAME_FLAG_TRIGGERED in the #UcaFrameInfo of frames where it exceeds
+ * #UcaContentTrigger:threshold. The statistic is the mean or maximum
+ * intensity, or the mean squared difference to the previous frame, which
+ * picks up transient events regardless of the background level. Frames are
+ * ordered by #UcaFrameInfo.sequence for this, because several filter threads
+ * may pass them in out of order.
+ *
+ * Pixel data is never changed. Together with #UcaCamera:event-gating, a
+ * buffered camera only hands out the frames around the events.
+ *
+ * The row reductions use AVX2 on x86 processors supporting it and NEON on
+ * ARM, with a scalar fallback.
+ */
+
+#include <string.h>
+#include "uca-content-trigger.h"
+#include "uca-enums.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+#define UCA_CONTENT_TRIGGER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_CONTENT_TRIGGER, UcaContentTriggerPrivate))
+
+static void uca_content_trigger_interface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UcaContentTrigger, uca_content_trigger, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_content_trigger_interface_init))
+
+enum {
+    PROP_0,
+    PROP_MODE,
+    PROP_THRESHOLD,
+    PROP_ROI_X,
+    PROP_ROI_Y,
+    PROP_ROI_WIDTH,
+    PROP_ROI_HEIGHT,
+    PROP_EVENTS,
+    PROP_LAST_VALUE,
+    N_PROPERTIES
+};
+
+static GParamSpec *trigger_properties[N_PROPERTIES] = { NULL, };
+
+#ifdef HAVE_AVX2_KERNELS
+static gboolean have_avx2 = FALSE;
+#endif
+
+struct _UcaContentTriggerPrivate {
+    UcaContentTriggerMode mode;
+    gdouble threshold;
+    guint roi_x;
+    guint roi_y;
+    guint roi_width;
+    guint roi_height;
+
+    /* Protects the results and the region of the previous frame */
+    GMutex lock;
+    guint64 n_events;
+    gdouble last_value;
+    gpointer previous;
+    gsize previous_size;
+    guint64 previous_sequence;
+    gboolean has_previous;
+};
+
+/*
+ * Scalar row reductions. They also finish the pixels at the end of a row
+ * that the vector kernels below leave over.
+ */
+#define MEASURE_ROW(type)                                                   \
+    static void                                                             \
+    measure_row_scalar_##type (const type *restrict x, gsize n,             \
+                               guint64 *sum, guint *max)                    \
+    {                                                                       \
+        guint64 row_sum = 0;                                                \
+        type row_max = 0;                                                   \
+                                                                            \
+        for (gsize i = 0; i < n; i++) {                                     \
+            row_sum += x[i];                                                \
+            row_max = x[i] > row_max ? x[i] : row_max;                      \
+        }                                                                   \
+                                                                            \
+        *sum += row_sum;                                                    \
+        *max = MAX (*max, row_max);                                         \
+    }
+
+#define DIFFERENCE_ROW(type)                                                \
+    static guint64                                                          \
+    difference_row_scalar_##type (const type *restrict x,                   \
+                                  type *restrict previous, gsize n)         \
+    {                                                                       \
+        guint64 energy = 0;                                                 \
+                                                                            \
+        for (gsize i = 0; i < n; i++) {                                     \
+            gint64 delta = (gint64) x[i] - previous[i];                     \
+                                                                            \
+            energy += (guint64) (delta * delta);                            \
+            previous[i] = x[i];                                             \
+        }                                                                   \
+                                                                            \
+        return energy;                                                      \
+    }
+
+MEASURE_ROW (guint8)
+MEASURE_ROW (guint16)
+DIFFERENCE_ROW (guint8)
+DIFFERENCE_ROW (guint16)
+
+/*
+ * The vector kernels add to the sum and maximum of a row and return how many
+ * pixels they covered. Sums of 32-bit lanes are widened to 64 bits at least
+ * every CHUNK_PIXELS pixels, before they can overflow.
+ */
+#define CHUNK_PIXELS 65536
+
+#ifdef HAVE_AVX2_KERNELS
+__attribute__ ((target ("avx2")))
+static guint64
+sum_epi64_avx2 (__m256i v)
+{
+    guint64 lanes[4];
+
+    _mm256_storeu_si256 ((__m256i *) lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__ ((target ("avx2")))
+static __m256i
+widen_epi32_avx2 (__m256i v)
+{
+    return _mm256_add_epi64 (_mm256_cvtepu32_epi64 (_mm256_castsi256_si128 (v)),
+                             _mm256_cvtepu32_epi64 (_mm256_extracti128_si256 (v, 1)));
+}
+
+__attribute__ ((target ("avx2")))
+static gsize
+measure_row_guint8_avx2 (const guint8 *x, gsize n, guint64 *sum, guint *max)
+{
+    __m256i zero = _mm256_setzero_si256 ();
+    __m256i row_sum = zero;
+    __m256i row_max = zero;
+    guint8 lanes[32];
+    gsize i;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256 ((const __m256i *) (x + i));
+
+        row_sum = _mm256_add_epi64 (row_sum, _mm256_sad_epu8 (v, zero));
+        row_max = _mm256_max_epu8 (row_max, v);
+    }
+
+    _mm256_storeu_si256 ((__m256i *) lanes, row_max);
+
+    for (guint j = 0; j < 32; j++)
+        *max = MAX (*max, lanes[j]);
+
+    *sum += sum_epi64_avx2 (row_sum);
+    return i;
+}
+
+__attribute__ ((target ("avx2")))
+static gsize
+measure_row_guint16_avx2 (const guint16 *x, gsize n, guint64 *sum, guint *max)
+{
+    __m256i zero = _mm256_setzero_si256 ();
+    __m256i row_sum = zero;
+    __m256i row_max = zero;
+    guint16 lanes[16];
+    gsize i = 0;
+
+    while (i + 16 <= n) {
+        gsize end = MIN (n, i + CHUNK_PIXELS);
+        __m256i chunk_sum = zero;
+
+        for (; i + 16 <= end; i += 16) {
+            __m256i v = _mm256_loadu_si256 ((const __m256i *) (x + i));
+
+            chunk_sum = _mm256_add_epi32 (chunk_sum, _mm256_unpacklo_epi16 (v, zero));
+            chunk_sum = _mm256_add_epi32 (chunk_sum, _mm256_unpackhi_epi16 (v, zero));
+            row_max = _mm256_max_epu16 (row_max, v);
+        }
+
+        row_sum = _mm256_add_epi64 (row_sum, widen_epi32_avx2 (chunk_sum));
+    }
+
+    _mm256_storeu_si256 ((__m256i *) lanes, row_max);
+
+    for (guint j = 0; j < 16; j++)
+        *max = MAX (*max, lanes[j]);
+
+    *sum += sum_epi64_avx2 (row_sum);
+    return i;
+}
+
+__attribute__ ((target ("avx2")))
+static gsize
+difference_row_guint8_avx2 (const guint8 *x, guint8 *previous, gsize n, guint64 *energy)
+{
+    __m256i zero = _mm256_setzero_si256 ();
+    __m256i total = zero;
+    gsize i = 0;
+
+    while (i + 32 <= n) {
+        gsize end = MIN (n, i + CHUNK_PIXELS);
+        __m256i chunk = zero;
+
+        for (; i + 32 <= end; i += 32) {
+            __m256i a = _mm256_loadu_si256 ((const __m256i *) (x + i));
+            __m256i b = _mm256_loadu_si256 ((const __m256i *) (previous + i));
+            __m256i d = _mm256_or_si256 (_mm256_subs_epu8 (a, b), _mm256_subs_epu8 (b, a));
+            __m256i lower = _mm256_unpacklo_epi8 (d, zero);
+            __m256i upper = _mm256_unpackhi_epi8 (d, zero);
+
+            chunk = _mm256_add_epi32 (chunk, _mm256_madd_epi16 (lower, lower));
+            chunk = _mm256_add_epi32 (chunk, _mm256_madd_epi16 (upper, upper));
+            _mm256_storeu_si256 ((__m256i *) (previous + i), a);
+        }
+
+        total = _mm256_add_epi64 (total, widen_epi32_avx2 (chunk));
+    }
+
+    *energy += sum_epi64_avx2 (total);
+    return i;
+}
+
+__attribute__ ((target ("avx2")))
+static __m256i
+square_epi32_avx2 (__m256i v)
+{
+    __m256i odd = _mm256_srli_epi64 (v, 32);
+
+    return _mm256_add_epi64 (_mm256_mul_epu32 (v, v), _mm256_mul_epu32 (odd, odd));
+}
+
+__attribute__ ((target ("avx2")))
+static gsize
+difference_row_guint16_avx2 (const guint16 *x, guint16 *previous, gsize n, guint64 *energy)
+{
+    __m256i zero = _mm256_setzero_si256 ();
+    __m256i total = zero;
+    gsize i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256 ((const __m256i *) (x + i));
+        __m256i b = _mm256_loadu_si256 ((const __m256i *) (previous + i));
+        __m256i d = _mm256_or_si256 (_mm256_subs_epu16 (a, b), _mm256_subs_epu16 (b, a));
+
+        total = _mm256_add_epi64 (total, square_epi32_avx2 (_mm256_unpacklo_epi16 (d, zero)));
+        total = _mm256_add_epi64 (total, square_epi32_avx2 (_mm256_unpackhi_epi16 (d, zero)));
+        _mm256_storeu_si256 ((__m256i *) (previous + i), a);
+    }
+
+    *energy += sum_epi64_avx2 (total);
+    return i;
+}
+#endif
+
+#ifdef HAVE_NEON_KERNELS
+static guint64
+sum_u64_neon (uint64x2_t v)
+{
+    return vgetq_lane_u64 (v, 0) + vgetq_lane_u64 (v, 1);
+}
+
+static gsize
+measure_row_guint8_neon (const guint8 *x, gsize n, guint64 *sum, guint *max)
+{
+    uint64x2_t row_sum = vdupq_n_u64 (0);
+    uint8x16_t row_max = vdupq_n_u8 (0);
+    guint8 lanes[16];
+    gsize i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8 (x + i);
+
+        row_sum = vpadalq_u32 (row_sum, vpaddlq_u16 (vpaddlq_u8 (v)));
+        row_max = vmaxq_u8 (row_max, v);
+    }
+
+    vst1q_u8 (lanes, row_max);
+
+    for (guint j = 0; j < 16; j++)
+        *max = MAX (*max, lanes[j]);
+
+    *sum += sum_u64_neon (row_sum);
+    return i;
+}
+
+static gsize
+measure_row_guint16_neon (const guint16 *x, gsize n, guint64 *sum, guint *max)
+{
+    uint64x2_t row_sum = vdupq_n_u64 (0);
+    uint16x8_t row_max = vdupq_n_u16 (0);
+    guint16 lanes[8];
+    gsize i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        uint16x8_t v = vld1q_u16 (x + i);
+
+        row_sum = vpadalq_u32 (row_sum, vpaddlq_u16 (v));
+        row_max = vmaxq_u16 (row_max, v);
+    }
+
+    vst1q_u16 (lanes, row_max);
+
+    for (guint j = 0; j < 8; j++)
+        *max = MAX (*max, lanes[j]);
+
+    *sum += sum_u64_neon (row_sum);
+    return i;
+}
+
+static gsize
+difference_row_guint8_neon (const guint8 *x, guint8 *previous, gsize n, guint64 *energy)
+{
+    uint64x2_t total = vdupq_n_u64 (0);
+    gsize i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        uint8x16_t a = vld1q_u8 (x + i);
+        uint8x16_t d = vabdq_u8 (a, vld1q_u8 (previous + i));
+        uint16x8_t lower = vmull_u8 (vget_low_u8 (d), vget_low_u8 (d));
+        uint16x8_t upper = vmull_u8 (vget_high_u8 (d), vget_high_u8 (d));
+
+        total = vpadalq_u32 (total, vpaddlq_u16 (lower));
+        total = vpadalq_u32 (total, vpaddlq_u16 (upper));
+        vst1q_u8 (previous + i, a);
+    }
+
+    *energy += sum_u64_neon (total);
+    return i;
+}
+
+static gsize
+difference_row_guint16_neon (const guint16 *x, guint16 *previous, gsize n, guint64 *energy)
+{
+    uint64x2_t total = vdupq_n_u64 (0);
+    gsize i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        uint16x8_t a = vld1q_u16 (x + i);
+        uint16x8_t d = vabdq_u16 (a, vld1q_u16 (previous + i));
+
+        total = vpadalq_u32 (total, vmull_u16 (vget_low_u16 (d), vget_low_u16 (d)));
+        total = vpadalq_u32 (total, vmull_u16 (vget_high_u16 (d), vget_high_u16 (d)));
+        vst1q_u16 (previous + i, a);
+    }
+
+    *energy += sum_u64_neon (total);
+    return i;
+}
+#endif
+
+static void
+measure_row_guint8 (const guint8 *x, gsize n, guint64 *sum, guint *max)
+{
+    gsize i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = measure_row_guint8_avx2 (x, n, sum, max);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = measure_row_guint8_neon (x, n, sum, max);
+#endif
+
+    measure_row_scalar_guint8 (x + i, n - i, sum, max);
+}
+
+static void
+measure_row_guint16 (const guint16 *x, gsize n, guint64 *sum, guint *max)
+{
+    gsize i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = measure_row_guint16_avx2 (x, n, sum, max);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = measure_row_guint16_neon (x, n, sum, max);
+#endif
+
+    measure_row_scalar_guint16 (x + i, n - i, sum, max);
+}
+
+static guint64
+difference_row_guint8 (const guint8 *x, guint8 *previous, gsize n)
+{
+    guint64 energy = 0;
+    gsize i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = difference_row_guint8_avx2 (x, previous, n, &energy);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = difference_row_guint8_neon (x, previous, n, &energy);
+#endif
+
+    return energy + difference_row_scalar_guint8 (x + i, previous + i, n - i);
+}
+
+static guint64
+difference_row_guint16 (const guint16 *x, guint16 *previous, gsize n)
+{
+    guint64 energy = 0;
+    gsize i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = difference_row_guint16_avx2 (x, previous, n, &energy);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = difference_row_guint16_neon (x, previous, n, &energy);
+#endif
+
+    return energy + difference_row_scalar_guint16 (x + i, previous + i, n - i);
+}
+
+/**
+ * uca_content_trigger_new:
+ * @mode: Statistic to compare
+ * @threshold: Value the statistic must exceed to mark a frame
+ *
+ * Returns: (transfer full): A new #UcaContentTrigger evaluating the whole
+ * frame.
+ * Since: 2.4
+ */
+UcaFilter *
+uca_content_trigger_new (UcaContentTriggerMode mode, gdouble threshold)
+{
+    return UCA_FILTER (g_object_new (UCA_TYPE_CONTENT_TRIGGER,
+                                     "mode", mode,
+                                     "threshold", threshold,
+                                     NULL));
+}
+
+static void
+measure (const guint8 *data, const UcaFrameInfo *info, guint x, guint width, guint height,
+         guint64 *sum, guint *max)
+{
+    for (guint y = 0; y < height; y++) {
+        const guint8 *row = data + y * info->stride;
+
+        if (info->format == UCA_PIXEL_FORMAT_MONO8)
+            measure_row_guint8 (row + x, width, sum, max);
+        else
+            measure_row_guint16 (((const guint16 *) row) + x, width, sum, max);
+    }
+}
+
+/*
+ * Compare with the latest frame seen so far and make this one the latest.
+ * Frames that filter threads pass in later than newer ones are not compared
+ * and return FALSE. Must be called with the lock held.
+ */
+static gboolean
+difference (UcaContentTriggerPrivate *priv, const guint8 *data, const UcaFrameInfo *info,
+            guint x, guint width, guint height, gdouble *value)
+{
+    gsize pixel_size;
+    guint64 energy = 0;
+
+    pixel_size = info->format == UCA_PIXEL_FORMAT_MONO8 ? 1 : 2;
+
+    if (priv->has_previous && info->sequence <= priv->previous_sequence)
+        return FALSE;
+
+    /* A new region or frame size starts over */
+    if (priv->previous_size != width * height * pixel_size) {
+        g_free (priv->previous);
+        priv->previous_size = width * height * pixel_size;
+        priv->previous = g_malloc (priv->previous_size);
+        priv->has_previous = FALSE;
+    }
+
+    for (guint y = 0; y < height; y++) {
+        const guint8 *row = data + y * info->stride;
+
+        if (pixel_size == 1)
+            energy += difference_row_guint8 (row + x, ((guint8 *) priv->previous) + y * width, width);
+        else
+            energy += difference_row_guint16 (((const guint16 *) row) + x,
+                                              ((guint16 *) priv->previous) + y * width, width);
+    }
+
+    *value = priv->has_previous ? (gdouble) energy / ((gdouble) width * height) : 0.0;
+    priv->previous_sequence = info->sequence;
+    priv->has_previous = TRUE;
+    return TRUE;
+}
+
+static gboolean
+uca_content_trigger_process (UcaFilter *filter, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    UcaContentTriggerPrivate *priv;
+    UcaContentTriggerMode mode;
+    guint x, y, width, height;
+    gdouble value;
+    gboolean triggered;
+
+    priv = UCA_CONTENT_TRIGGER (filter)->priv;
+    mode = priv->mode;
+    x = priv->roi_x;
+    y = priv->roi_y;
+    width = priv->roi_width;
+    height = priv->roi_height;
+
+    if (x >= info->width || y >= info->height ||
+        width > info->width - x || height > info->height - y) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                     "Region at %u,%u does not fit into frame of %ux%u",
+                     x, y, info->width, info->height);
+        return FALSE;
+    }
+
+    /* An empty region extends to the edges */
+    if (width == 0)
+        width = info->width - x;
+
+    if (height == 0)
+        height = info->height - y;
+
+    data = ((guint8 *) data) + y * info->stride;
+
+    if (mode == UCA_CONTENT_TRIGGER_DIFFERENCE) {
+        gboolean compared;
+
+        /* Frames from several filter threads can come out of order */
+        g_mutex_lock (&priv->lock);
+        compared = difference (priv, data, info, x, width, height, &value);
+        g_mutex_unlock (&priv->lock);
+
+        if (!compared)
+            return TRUE;
+    }
+    else {
+        guint64 sum = 0;
+        guint max = 0;
+
+        measure (data, info, x, width, height, &sum, &max);
+        value = mode == UCA_CONTENT_TRIGGER_MEAN ? (gdouble) sum / ((gdouble) width * height) : max;
+    }
+
+    triggered = value > priv->threshold;
+
+    g_mutex_lock (&priv->lock);
+    priv->last_value = value;
+
+    if (triggered)
+        priv->n_events++;
+
+    g_mutex_unlock (&priv->lock);
+
+    if (triggered)
+        info->flags |= UCA_FRAME_FLAG_TRIGGERED;
+
+    return TRUE;
+}
+
+static void
+uca_content_trigger_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+    UcaContentTriggerPrivate *priv = UCA_CONTENT_TRIGGER_GET_PRIVATE (object);
+
+    switch (property_id) {
+        case PROP_MODE:
+            priv->mode = g_value_get_enum (value);
+            break;
+        case PROP_THRESHOLD:
+            priv->threshold = g_value_get_double (value);
+            return;
+        case PROP_ROI_X:
+            priv->roi_x = g_value_get_uint (value);
+            break;
+        case PROP_ROI_Y:
+            priv->roi_y = g_value_get_uint (value);
+            break;
+        case PROP_ROI_WIDTH:
+            priv->roi_width = g_value_get_uint (value);
+            break;
+        case PROP_ROI_HEIGHT:
+            priv->roi_height = g_value_get_uint (value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            return;
+    }
+
+    /* Differences to a frame of another region are meaningless */
+    g_mutex_lock (&priv->lock);
+    priv->has_previous = FALSE;
+    g_mutex_unlock (&priv->lock);
+}
+
+static void
+uca_content_trigger_get_property (GObject *object, guint property_id, GValue *value, GParamSpec *pspec)
+{
+    UcaContentTriggerPrivate *priv = UCA_CONTENT_TRIGGER_GET_PRIVATE (object);
+
+    switch (property_id) {
+        case PROP_MODE:
+            g_value_set_enum (value, priv->mode);
+            break;
+        case PROP_THRESHOLD:
+            g_value_set_double (value, priv->threshold);
+            break;
+        case PROP_ROI_X:
+            g_value_set_uint (value, priv->roi_x);
+            break;
+        case PROP_ROI_Y:
+            g_value_set_uint (value, priv->roi_y);
+            break;
+        case PROP_ROI_WIDTH:
+            g_value_set_uint (value, priv->roi_width);
+            break;
+        case PROP_ROI_HEIGHT:
+            g_value_set_uint (value, priv->roi_height);
+            break;
+        case PROP_EVENTS:
+            g_mutex_lock (&priv->lock);
+            g_value_set_uint64 (value, priv->n_events);
+            g_mutex_unlock (&priv->lock);
+            break;
+        case PROP_LAST_VALUE:
+            g_mutex_lock (&priv->lock);
+            g_value_set_double (value, priv->last_value);
+            g_mutex_unlock (&priv->lock);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            return;
+    }
+}
+
+static void
+uca_content_trigger_finalize (GObject *object)
+{
+    UcaContentTriggerPrivate *priv;
+
+    priv = UCA_CONTENT_TRIGGER_GET_PRIVATE (object);
+    g_free (priv->previous);
+    g_mutex_clear (&priv->lock);
+
+    G_OBJECT_CLASS (uca_content_trigger_parent_class)->finalize (object);
+}
+
+static void
+uca_content_trigger_reset (UcaFilter *filter)
+{
+    UcaContentTriggerPrivate *priv;
+
+    priv = UCA_CONTENT_TRIGGER (filter)->priv;
+
+    g_mutex_lock (&priv->lock);
+    priv->has_previous = FALSE;
+    g_mutex_unlock (&priv->lock);
+}
+
+static void
+uca_content_trigger_interface_init (UcaFilterInterface *iface)
+{
+    iface->process = uca_content_trigger_process;
+    iface->reset = uca_content_trigger_reset;
+}
+
+static void
+uca_content_trigger_class_init (UcaContentTriggerClass *klass)
+{
+    GObjectClass *oclass = G_OBJECT_CLASS (klass);
+
+    oclass->set_property = uca_content_trigger_set_property;
+    oclass->get_property = uca_content_trigger_get_property;
+    oclass->finalize = uca_content_trigger_finalize;
+
+    trigger_properties[PROP_MODE] =
+        g_param_spec_enum ("mode",
+            "Statistic compared with the threshold",
+            "Statistic compared with the threshold",
+            UCA_TYPE_CONTENT_TRIGGER_MODE, UCA_CONTENT_TRIGGER_MEAN,
+            G_PARAM_READWRITE);
+
+    trigger_properties[PROP_THRESHOLD] =
+        g_param_spec_double ("threshold",
+            "Value the statistic must exceed",
+            "Value the statistic must exceed to mark a frame",
+            0.0, G_MAXDOUBLE, 0.0,
+            G_PARAM_READWRITE);
+
+    trigger_properties[PROP_ROI_X] =
+        g_param_spec_uint ("roi-x",
+            "Horizontal offset of the region",
+            "Horizontal offset of the region",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    trigger_properties[PROP_ROI_Y] =
+        g_param_spec_uint ("roi-y",
+            "Vertical offset of the region",
+            "Vertical offset of the region",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    trigger_properties[PROP_ROI_WIDTH] =
+        g_param_spec_uint ("roi-width",
+            "Width of the region",
+            "Width of the region, 0 to extend it to the right edge",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    trigger_properties[PROP_ROI_HEIGHT] =
+        g_param_spec_uint ("roi-height",
+            "Height of the region",
+            "Height of the region, 0 to extend it to the bottom edge",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    trigger_properties[PROP_EVENTS] =
+        g_param_spec_uint64 ("events",
+            "Number of marked frames",
+            "Number of frames in which the statistic exceeded the threshold",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READABLE);
+
+    trigger_properties[PROP_LAST_VALUE] =
+        g_param_spec_double ("last-value",
+            "Statistic of the last frame",
+            "Statistic of the last frame, useful to choose a threshold",
+            0.0, G_MAXDOUBLE, 0.0,
+            G_PARAM_READABLE);
+
+    for (guint id = PROP_0 + 1; id < N_PROPERTIES; id++)
+        g_object_class_install_property (oclass, id, trigger_properties[id]);
+
+    g_type_class_add_private (klass, sizeof (UcaContentTriggerPrivate));
+
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init ();
+    have_avx2 = __builtin_cpu_supports ("avx2");
+#endif
+}
+
+static void
+uca_content_trigger_init (UcaContentTrigger *trigger)
+{
+    UcaContentTriggerPrivate *priv;
+
+    trigger->priv = priv = UCA_CONTENT_TRIGGER_GET_PRIVATE (trigger);
+    priv->mode = UCA_CONTENT_TRIGGER_MEAN;
+    priv->threshold = 0.0;
+    priv->roi_x = 0;
+    priv->roi_y = 0;
+    priv->roi_width = 0;
+    priv->roi_height = 0;
+    priv->n_events = 0;
+    priv->last_value = 0.0;
+    priv->previous = NULL;
+    priv->previous_size = 0;
+    priv->previous_sequence = 0;
+    priv->has_previous = FALSE;
+    g_mutex_init (&priv->lock);
+}
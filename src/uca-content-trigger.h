@@ -0,0 +1,57 @@
+#ifndef UCA_CONTENT_TRIGGER_H
+#define UCA_CONTENT_TRIGGER_H
+
+#include <glib-object.h>
+#include "uca-filter.h"
+
+#define UCA_TYPE_CONTENT_TRIGGER            (uca_content_trigger_get_type())
+#define UCA_CONTENT_TRIGGER(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_CONTENT_TRIGGER, UcaContentTrigger))
+#define UCA_IS_CONTENT_TRIGGER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_CONTENT_TRIGGER))
+#define UCA_CONTENT_TRIGGER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_CONTENT_TRIGGER, UcaContentTriggerClass))
+#define UCA_IS_CONTENT_TRIGGER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_CONTENT_TRIGGER))
+#define UCA_CONTENT_TRIGGER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_CONTENT_TRIGGER, UcaContentTriggerClass))
+
+G_BEGIN_DECLS
+
+/**
+ * UcaContentTriggerMode:
+ * @UCA_CONTENT_TRIGGER_MEAN: Mean intensity of the region
+ * @UCA_CONTENT_TRIGGER_MAX: Maximum intensity of the region
+ * @UCA_CONTENT_TRIGGER_DIFFERENCE: Mean squared difference of the region to
+ *  the frame with the next lower #UcaFrameInfo.sequence seen before. Frames
+ *  older than one compared already are not evaluated.
+ *
+ * Statistic that a #UcaContentTrigger compares with its threshold.
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_CONTENT_TRIGGER_MEAN,
+    UCA_CONTENT_TRIGGER_MAX,
+    UCA_CONTENT_TRIGGER_DIFFERENCE,
+} UcaContentTriggerMode;
+
+typedef struct _UcaContentTrigger           UcaContentTrigger;
+typedef struct _UcaContentTriggerClass      UcaContentTriggerClass;
+typedef struct _UcaContentTriggerPrivate    UcaContentTriggerPrivate;
+
+struct _UcaContentTrigger {
+    /*< private >*/
+    GObject parent;
+
+    UcaContentTriggerPrivate *priv;
+};
+
+struct _UcaContentTriggerClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UcaFilter * uca_content_trigger_new (UcaContentTriggerMode mode,
+                                     gdouble               threshold);
+
+GType uca_content_trigger_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,279 @@
+/* Copyright (C) 2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-dark-filter
+ * @Short_description: Dark frame subtraction
+ * @Title: UcaDarkFilter
+ *
+ * A #UcaFilter that subtracts a dark frame from each frame. Results below
+ * zero are clamped to zero. Without a dark frame, frames are left untouched.
+ *
+ * The subtraction uses saturating AVX2 instructions on x86 processors
+ * supporting them and NEON on ARM, with a scalar fallback.
+ */
+
+#include <string.h>
+#include "uca-dark-filter.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+#define UCA_DARK_FILTER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_DARK_FILTER, UcaDarkFilterPrivate))
+
+static void uca_dark_filter_interface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UcaDarkFilter, uca_dark_filter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_dark_filter_interface_init))
+
+#ifdef HAVE_AVX2_KERNELS
+static gboolean have_avx2 = FALSE;
+#endif
+
+struct _UcaDarkFilterPrivate {
+    /* Frames are processed concurrently, the dark frame is replaced rarely */
+    GRWLock lock;
+    UcaFrameInfo info;
+    guint8 *dark;
+};
+
+/**
+ * uca_dark_filter_new:
+ *
+ * Returns: (transfer full): A new #UcaDarkFilter without a dark frame.
+ * Since: 2.4
+ */
+UcaFilter *
+uca_dark_filter_new (void)
+{
+    return UCA_FILTER (g_object_new (UCA_TYPE_DARK_FILTER, NULL));
+}
+
+/**
+ * uca_dark_filter_set_dark:
+ * @filter: A #UcaDarkFilter
+ * @data: (allow-none): Pixel data of the dark frame or %NULL to remove it
+ * @info: (allow-none): Description of @data
+ *
+ * Copy the dark frame that is subtracted from subsequent frames. Frames must
+ * have the same geometry and pixel format as @info.
+ *
+ * Since: 2.4
+ */
+void
+uca_dark_filter_set_dark (UcaDarkFilter *filter, gconstpointer data, const UcaFrameInfo *info)
+{
+    UcaDarkFilterPrivate *priv;
+
+    g_return_if_fail (UCA_IS_DARK_FILTER (filter));
+    g_return_if_fail (data == NULL || info != NULL);
+
+    priv = filter->priv;
+
+    g_rw_lock_writer_lock (&priv->lock);
+    g_free (priv->dark);
+    priv->dark = NULL;
+
+    if (data != NULL) {
+        priv->info = *info;
+        priv->dark = g_memdup (data, uca_frame_info_get_size (info));
+    }
+
+    g_rw_lock_writer_unlock (&priv->lock);
+}
+
+/*
+ * The vector kernels subtract as many pixels as fit into full vectors and
+ * return how many they did, the rest is left to the scalar loop.
+ */
+#ifdef HAVE_AVX2_KERNELS
+__attribute__ ((target ("avx2")))
+static guint
+subtract_8_avx2 (guint8 *data, const guint8 *dark, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256 ((const __m256i *) (data + i));
+        __m256i d = _mm256_loadu_si256 ((const __m256i *) (dark + i));
+        _mm256_storeu_si256 ((__m256i *) (data + i), _mm256_subs_epu8 (x, d));
+    }
+
+    return i;
+}
+
+__attribute__ ((target ("avx2")))
+static guint
+subtract_16_avx2 (guint16 *data, const guint16 *dark, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256 ((const __m256i *) (data + i));
+        __m256i d = _mm256_loadu_si256 ((const __m256i *) (dark + i));
+        _mm256_storeu_si256 ((__m256i *) (data + i), _mm256_subs_epu16 (x, d));
+    }
+
+    return i;
+}
+#endif
+
+#ifdef HAVE_NEON_KERNELS
+static guint
+subtract_8_neon (guint8 *data, const guint8 *dark, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+        vst1q_u8 (data + i, vqsubq_u8 (vld1q_u8 (data + i), vld1q_u8 (dark + i)));
+
+    return i;
+}
+
+static guint
+subtract_16_neon (guint16 *data, const guint16 *dark, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+        vst1q_u16 (data + i, vqsubq_u16 (vld1q_u16 (data + i), vld1q_u16 (dark + i)));
+
+    return i;
+}
+#endif
+
+static void
+subtract_8 (guint8 *data, const guint8 *dark, guint n)
+{
+    guint i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = subtract_8_avx2 (data, dark, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = subtract_8_neon (data, dark, n);
+#endif
+
+    for (; i < n; i++)
+        data[i] = data[i] > dark[i] ? data[i] - dark[i] : 0;
+}
+
+static void
+subtract_16 (guint16 *data, const guint16 *dark, guint n)
+{
+    guint i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = subtract_16_avx2 (data, dark, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = subtract_16_neon (data, dark, n);
+#endif
+
+    for (; i < n; i++)
+        data[i] = data[i] > dark[i] ? data[i] - dark[i] : 0;
+}
+
+static gboolean
+uca_dark_filter_process (UcaFilter *filter, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    UcaDarkFilterPrivate *priv;
+    gboolean result = TRUE;
+
+    priv = UCA_DARK_FILTER (filter)->priv;
+
+    g_rw_lock_reader_lock (&priv->lock);
+
+    if (priv->dark == NULL)
+        goto out;
+
+    if (info->width != priv->info.width || info->height != priv->info.height ||
+        info->format != priv->info.format) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                     "Frame of %ux%u does not match dark frame of %ux%u",
+                     info->width, info->height, priv->info.width, priv->info.height);
+        result = FALSE;
+        goto out;
+    }
+
+    for (guint y = 0; y < info->height; y++) {
+        guint8 *row = ((guint8 *) data) + y * info->stride;
+        const guint8 *dark_row = priv->dark + y * priv->info.stride;
+
+        if (info->format == UCA_PIXEL_FORMAT_MONO8)
+            subtract_8 (row, dark_row, info->width);
+        else
+            subtract_16 ((guint16 *) row, (const guint16 *) dark_row, info->width);
+    }
+
+out:
+    g_rw_lock_reader_unlock (&priv->lock);
+    return result;
+}
+
+static void
+uca_dark_filter_finalize (GObject *object)
+{
+    UcaDarkFilterPrivate *priv;
+
+    priv = UCA_DARK_FILTER_GET_PRIVATE (object);
+    g_free (priv->dark);
+    g_rw_lock_clear (&priv->lock);
+
+    G_OBJECT_CLASS (uca_dark_filter_parent_class)->finalize (object);
+}
+
+static void
+uca_dark_filter_interface_init (UcaFilterInterface *iface)
+{
+    iface->process = uca_dark_filter_process;
+}
+
+static void
+uca_dark_filter_class_init (UcaDarkFilterClass *klass)
+{
+    GObjectClass *oclass = G_OBJECT_CLASS (klass);
+
+    oclass->finalize = uca_dark_filter_finalize;
+
+    g_type_class_add_private (klass, sizeof (UcaDarkFilterPrivate));
+
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init ();
+    have_avx2 = __builtin_cpu_supports ("avx2");
+#endif
+}
+
+static void
+uca_dark_filter_init (UcaDarkFilter *filter)
+{
+    UcaDarkFilterPrivate *priv;
+
+    filter->priv = priv = UCA_DARK_FILTER_GET_PRIVATE (filter);
+    g_rw_lock_init (&priv->lock);
+    priv->dark = NULL;
+}
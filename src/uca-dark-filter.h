@@ -0,0 +1,41 @@
+#ifndef UCA_DARK_FILTER_H
+#define UCA_DARK_FILTER_H
+
+#include <glib-object.h>
+#include "uca-filter.h"
+
+#define UCA_TYPE_DARK_FILTER             (uca_dark_filter_get_type())
+#define UCA_DARK_FILTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_DARK_FILTER, UcaDarkFilter))
+#define UCA_IS_DARK_FILTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_DARK_FILTER))
+#define UCA_DARK_FILTER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_DARK_FILTER, UcaDarkFilterClass))
+#define UCA_IS_DARK_FILTER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_DARK_FILTER))
+#define UCA_DARK_FILTER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_DARK_FILTER, UcaDarkFilterClass))
+
+G_BEGIN_DECLS
+
+typedef struct _UcaDarkFilter           UcaDarkFilter;
+typedef struct _UcaDarkFilterClass      UcaDarkFilterClass;
+typedef struct _UcaDarkFilterPrivate    UcaDarkFilterPrivate;
+
+struct _UcaDarkFilter {
+    /*< private >*/
+    GObject parent;
+
+    UcaDarkFilterPrivate *priv;
+};
+
+struct _UcaDarkFilterClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UcaFilter * uca_dark_filter_new         (void);
+void        uca_dark_filter_set_dark    (UcaDarkFilter      *filter,
+                                         gconstpointer       data,
+                                         const UcaFrameInfo *info);
+
+GType uca_dark_filter_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,92 @@
+/* Copyright (C) 2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-filter
+ * @Short_description: Per-frame processing step
+ * @Title: UcaFilter
+ *
+ * A #UcaFilter corrects or transforms a frame in place. Filters are added to
+ * a camera with uca_camera_add_filter() and applied to every frame of a
+ * recording before it is handed to the consumer. libuca provides
+ * #UcaDarkFilter and #UcaHotPixelFilter for common corrections.
+ */
+
+#include "uca-filter.h"
+
+G_DEFINE_INTERFACE (UcaFilter, uca_filter, G_TYPE_OBJECT)
+
+GQuark
+uca_filter_error_quark (void)
+{
+    return g_quark_from_static_string ("uca-filter-error-quark");
+}
+
+static void
+uca_filter_default_init (UcaFilterInterface *iface)
+{
+}
+
+/**
+ * uca_filter_process:
+ * @filter: A #UcaFilter
+ * @data: Pixel data of the frame
+ * @info: Description of the frame, updated if @filter changes its size
+ * @error: Location for a #GError or %NULL
+ *
+ * Process a frame in place.
+ *
+ * Returns: %TRUE on success.
+ * Since: 2.4
+ */
+gboolean
+uca_filter_process (UcaFilter *filter, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    UcaFilterInterface *iface;
+
+    g_return_val_if_fail (UCA_IS_FILTER (filter), FALSE);
+    g_return_val_if_fail (data != NULL && info != NULL, FALSE);
+
+    iface = UCA_FILTER_GET_IFACE (filter);
+
+    if (iface->process == NULL)
+        return TRUE;
+
+    return iface->process (filter, data, info, error);
+}
+
+/**
+ * uca_filter_reset:
+ * @filter: A #UcaFilter
+ *
+ * Forget state that @filter carries from one frame to the next. Cameras call
+ * this for each of their filters when a recording starts.
+ *
+ * Since: 2.4
+ */
+void
+uca_filter_reset (UcaFilter *filter)
+{
+    UcaFilterInterface *iface;
+
+    g_return_if_fail (UCA_IS_FILTER (filter));
+
+    iface = UCA_FILTER_GET_IFACE (filter);
+
+    if (iface->reset != NULL)
+        iface->reset (filter);
+}
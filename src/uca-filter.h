@@ -0,0 +1,70 @@
+#ifndef UCA_FILTER_H
+#define UCA_FILTER_H
+
+#include <glib-object.h>
+#include "uca-frame.h"
+
+#define UCA_TYPE_FILTER             (uca_filter_get_type())
+#define UCA_FILTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_FILTER, UcaFilter))
+#define UCA_IS_FILTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_FILTER))
+#define UCA_FILTER_GET_IFACE(obj)   (G_TYPE_INSTANCE_GET_INTERFACE((obj), UCA_TYPE_FILTER, UcaFilterInterface))
+
+#define UCA_FILTER_ERROR            uca_filter_error_quark()
+
+G_BEGIN_DECLS
+
+GQuark uca_filter_error_quark (void);
+
+/**
+ * UcaFilterError:
+ * @UCA_FILTER_ERROR_FORMAT: The frame does not match what the filter was set
+ *  up for
+ * @UCA_FILTER_ERROR_NO_REFERENCE: Reference data needed for the operation has
+ *  not been set
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_FILTER_ERROR_FORMAT,
+    UCA_FILTER_ERROR_NO_REFERENCE,
+} UcaFilterError;
+
+typedef struct _UcaFilter           UcaFilter;
+typedef struct _UcaFilterInterface  UcaFilterInterface;
+
+/**
+ * UcaFilterInterface:
+ * @parent_iface: The parent interface
+ * @process: Process a frame in place. It may be called for different frames
+ *  from several threads at the same time. A filter that changes the size of
+ *  the frame must update the #UcaFrameInfo and may only shrink it.
+ * @reset: Forget what was learned from previous frames, called when a
+ *  recording starts. Frames of a recording are numbered from zero again in
+ *  #UcaFrameInfo.sequence. May be %NULL.
+ *
+ * Interface for processing steps that are applied to each frame of a
+ * recording, see uca_camera_add_filter().
+ *
+ * Since: 2.4
+ */
+struct _UcaFilterInterface {
+    GTypeInterface parent_iface;
+
+    gboolean (*process) (UcaFilter      *filter,
+                         gpointer        data,
+                         UcaFrameInfo   *info,
+                         GError        **error);
+    void     (*reset)   (UcaFilter      *filter);
+};
+
+gboolean    uca_filter_process      (UcaFilter      *filter,
+                                     gpointer        data,
+                                     UcaFrameInfo   *info,
+                                     GError        **error);
+void        uca_filter_reset        (UcaFilter      *filter);
+
+GType uca_filter_get_type (void);
+
+G_END_DECLS
+
+#endif
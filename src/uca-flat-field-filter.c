@@ -0,0 +1,840 @@
+/* Copyright (C) 2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-flat-field-filter
+ * @Short_description: Dark and flat field correction
+ * @Title: UcaFlatFieldFilter
+ *
+ * A #UcaFilter that computes (raw - dark) / (flat - dark) for every pixel.
+ * The dark and flat references can be averaged from frames grabbed with
+ * uca_flat_field_filter_acquire() or set from previously stored data. Without
+ * a flat, only the dark is subtracted, without a dark, only the flat divides.
+ *
+ * As part of a camera's filter chain, the result is rescaled with
+ * #UcaFlatFieldFilter:scale and written back in the pixel format of the
+ * frame, 16-bit frames then use the full 16-bit range. Floating point results
+ * are computed with uca_flat_field_filter_correct().
+ *
+ * References are kept in 64-byte aligned float buffers, with the reciprocal
+ * of (flat - dark) precomputed, so that correcting a pixel is one subtraction
+ * and one multiplication. The kernels use AVX2 on x86 processors supporting
+ * it and NEON on ARM, with a scalar fallback.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "uca-flat-field-filter.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+#define UCA_FLAT_FIELD_FILTER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_FLAT_FIELD_FILTER, UcaFlatFieldFilterPrivate))
+
+/* Alignment of the reference buffers, a cache line covers any vector width */
+#define REFERENCE_ALIGNMENT 64
+
+static void uca_flat_field_filter_interface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UcaFlatFieldFilter, uca_flat_field_filter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_flat_field_filter_interface_init))
+
+/* Property ids start after PROP_0, which uca-camera.h already defines */
+enum {
+    PROP_SCALE = 1,
+    N_FILTER_PROPERTIES
+};
+
+static GParamSpec *filter_properties[N_FILTER_PROPERTIES] = { NULL, };
+
+#ifdef HAVE_AVX2_KERNELS
+static gboolean have_avx2 = FALSE;
+#endif
+
+/* Frames summed for a reference, sized by the first one */
+typedef struct {
+    gdouble *values;
+    guint width;
+    guint height;
+    UcaPixelFormat format;
+    guint n_frames;
+    guint n_wanted;
+    GError *error;
+} Sum;
+
+struct _UcaFlatFieldFilterPrivate {
+    GRWLock lock;
+    guint width;
+    guint height;
+    gfloat *references[2];
+    gfloat *dark;
+    gfloat *gain;
+    gdouble scale;
+
+    /*
+     * While a reference is acquired with the filter in the camera's chain,
+     * the next frames passing through it are summed and left unchanged.
+     */
+    GMutex sum_lock;
+    Sum *sum;
+};
+
+static gfloat *
+alloc_floats (gsize n)
+{
+    gpointer data;
+
+    if (posix_memalign (&data, REFERENCE_ALIGNMENT, MAX (n, 1) * sizeof (gfloat)) != 0)
+        g_error ("Could not allocate %" G_GSIZE_FORMAT " bytes of reference data", n * sizeof (gfloat));
+
+    return data;
+}
+
+/*
+ * The vector kernels process as many pixels as fit into full vectors and
+ * return how many they did, the rest is left to the scalar loop.
+ */
+#ifdef HAVE_AVX2_KERNELS
+__attribute__ ((target ("avx2")))
+static guint
+correct_float_u8_avx2 (const guint8 *in, const gfloat *dark, const gfloat *gain, gfloat *out, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps (_mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) (in + i))));
+        __m256 r = _mm256_mul_ps (_mm256_sub_ps (x, _mm256_loadu_ps (dark + i)), _mm256_loadu_ps (gain + i));
+        _mm256_storeu_ps (out + i, r);
+    }
+
+    return i;
+}
+
+__attribute__ ((target ("avx2")))
+static guint
+correct_float_u16_avx2 (const guint16 *in, const gfloat *dark, const gfloat *gain, gfloat *out, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps (_mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *) (in + i))));
+        __m256 r = _mm256_mul_ps (_mm256_sub_ps (x, _mm256_loadu_ps (dark + i)), _mm256_loadu_ps (gain + i));
+        _mm256_storeu_ps (out + i, r);
+    }
+
+    return i;
+}
+
+__attribute__ ((target ("avx2")))
+static guint
+correct_u16_avx2 (guint16 *data, const gfloat *dark, const gfloat *gain, gfloat scale, gfloat max, guint n)
+{
+    const __m256 vscale = _mm256_set1_ps (scale);
+    const __m256 vmax = _mm256_set1_ps (max);
+    const __m256 vhalf = _mm256_set1_ps (0.5f);
+    const __m256 vzero = _mm256_setzero_ps ();
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps (_mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *) (data + i))));
+        __m256 r = _mm256_mul_ps (_mm256_sub_ps (x, _mm256_loadu_ps (dark + i)), _mm256_loadu_ps (gain + i));
+        __m256i v;
+
+        r = _mm256_add_ps (_mm256_mul_ps (r, vscale), vhalf);
+        r = _mm256_min_ps (_mm256_max_ps (r, vzero), vmax);
+        v = _mm256_cvttps_epi32 (r);
+
+        /* Packing works per 128-bit lane, move both halves together */
+        v = _mm256_permute4x64_epi64 (_mm256_packus_epi32 (v, v), 0x08);
+        _mm_storeu_si128 ((__m128i *) (data + i), _mm256_castsi256_si128 (v));
+    }
+
+    return i;
+}
+
+__attribute__ ((target ("avx2")))
+static guint
+correct_u8_avx2 (guint8 *data, const gfloat *dark, const gfloat *gain, gfloat scale, gfloat max, guint n)
+{
+    const __m256 vscale = _mm256_set1_ps (scale);
+    const __m256 vmax = _mm256_set1_ps (max);
+    const __m256 vhalf = _mm256_set1_ps (0.5f);
+    const __m256 vzero = _mm256_setzero_ps ();
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps (_mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) (data + i))));
+        __m256 r = _mm256_mul_ps (_mm256_sub_ps (x, _mm256_loadu_ps (dark + i)), _mm256_loadu_ps (gain + i));
+        __m256i v;
+        __m128i w;
+
+        r = _mm256_add_ps (_mm256_mul_ps (r, vscale), vhalf);
+        r = _mm256_min_ps (_mm256_max_ps (r, vzero), vmax);
+        v = _mm256_cvttps_epi32 (r);
+
+        /* Values are clamped already, so narrowing cannot saturate */
+        w = _mm_packus_epi32 (_mm256_castsi256_si128 (v), _mm256_extracti128_si256 (v, 1));
+        _mm_storel_epi64 ((__m128i *) (data + i), _mm_packus_epi16 (w, w));
+    }
+
+    return i;
+}
+#endif
+
+#ifdef HAVE_NEON_KERNELS
+static inline float32x4_t
+correct_neon (uint32x4_t x, const gfloat *dark, const gfloat *gain)
+{
+    return vmulq_f32 (vsubq_f32 (vcvtq_f32_u32 (x), vld1q_f32 (dark)), vld1q_f32 (gain));
+}
+
+static inline uint16x4_t
+rescale_neon (float32x4_t r, float32x4_t vscale, float32x4_t vmax)
+{
+    r = vaddq_f32 (vmulq_f32 (r, vscale), vdupq_n_f32 (0.5f));
+    r = vminq_f32 (vmaxq_f32 (r, vdupq_n_f32 (0.0f)), vmax);
+    return vmovn_u32 (vcvtq_u32_f32 (r));
+}
+
+static guint
+correct_float_u8_neon (const guint8 *in, const gfloat *dark, const gfloat *gain, gfloat *out, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        uint16x8_t v = vmovl_u8 (vld1_u8 (in + i));
+
+        vst1q_f32 (out + i, correct_neon (vmovl_u16 (vget_low_u16 (v)), dark + i, gain + i));
+        vst1q_f32 (out + i + 4, correct_neon (vmovl_u16 (vget_high_u16 (v)), dark + i + 4, gain + i + 4));
+    }
+
+    return i;
+}
+
+static guint
+correct_float_u16_neon (const guint16 *in, const gfloat *dark, const gfloat *gain, gfloat *out, guint n)
+{
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        uint16x8_t v = vld1q_u16 (in + i);
+
+        vst1q_f32 (out + i, correct_neon (vmovl_u16 (vget_low_u16 (v)), dark + i, gain + i));
+        vst1q_f32 (out + i + 4, correct_neon (vmovl_u16 (vget_high_u16 (v)), dark + i + 4, gain + i + 4));
+    }
+
+    return i;
+}
+
+static guint
+correct_u16_neon (guint16 *data, const gfloat *dark, const gfloat *gain, gfloat scale, gfloat max, guint n)
+{
+    const float32x4_t vscale = vdupq_n_f32 (scale);
+    const float32x4_t vmax = vdupq_n_f32 (max);
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        uint16x8_t v = vld1q_u16 (data + i);
+        uint16x4_t lo = rescale_neon (correct_neon (vmovl_u16 (vget_low_u16 (v)), dark + i, gain + i), vscale, vmax);
+        uint16x4_t hi = rescale_neon (correct_neon (vmovl_u16 (vget_high_u16 (v)), dark + i + 4, gain + i + 4), vscale, vmax);
+
+        vst1q_u16 (data + i, vcombine_u16 (lo, hi));
+    }
+
+    return i;
+}
+
+static guint
+correct_u8_neon (guint8 *data, const gfloat *dark, const gfloat *gain, gfloat scale, gfloat max, guint n)
+{
+    const float32x4_t vscale = vdupq_n_f32 (scale);
+    const float32x4_t vmax = vdupq_n_f32 (max);
+    guint i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        uint16x8_t v = vmovl_u8 (vld1_u8 (data + i));
+        uint16x4_t lo = rescale_neon (correct_neon (vmovl_u16 (vget_low_u16 (v)), dark + i, gain + i), vscale, vmax);
+        uint16x4_t hi = rescale_neon (correct_neon (vmovl_u16 (vget_high_u16 (v)), dark + i + 4, gain + i + 4), vscale, vmax);
+
+        vst1_u8 (data + i, vmovn_u16 (vcombine_u16 (lo, hi)));
+    }
+
+    return i;
+}
+#endif
+
+static inline gfloat
+rescale (gfloat r, gfloat scale, gfloat max)
+{
+    r = r * scale + 0.5f;
+    return r > 0.0f ? (r < max ? r : max) : 0.0f;
+}
+
+static void
+correct_row_float_u8 (const guint8 *in, const gfloat *dark, const gfloat *gain, gfloat *out, guint n)
+{
+    guint i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = correct_float_u8_avx2 (in, dark, gain, out, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = correct_float_u8_neon (in, dark, gain, out, n);
+#endif
+
+    for (; i < n; i++)
+        out[i] = ((gfloat) in[i] - dark[i]) * gain[i];
+}
+
+static void
+correct_row_float_u16 (const guint16 *in, const gfloat *dark, const gfloat *gain, gfloat *out, guint n)
+{
+    guint i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = correct_float_u16_avx2 (in, dark, gain, out, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = correct_float_u16_neon (in, dark, gain, out, n);
+#endif
+
+    for (; i < n; i++)
+        out[i] = ((gfloat) in[i] - dark[i]) * gain[i];
+}
+
+static void
+correct_row_u16 (guint16 *data, const gfloat *dark, const gfloat *gain, gfloat scale, gfloat max, guint n)
+{
+    guint i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = correct_u16_avx2 (data, dark, gain, scale, max, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = correct_u16_neon (data, dark, gain, scale, max, n);
+#endif
+
+    for (; i < n; i++)
+        data[i] = (guint16) rescale (((gfloat) data[i] - dark[i]) * gain[i], scale, max);
+}
+
+static void
+correct_row_u8 (guint8 *data, const gfloat *dark, const gfloat *gain, gfloat scale, gfloat max, guint n)
+{
+    guint i = 0;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (have_avx2)
+        i = correct_u8_avx2 (data, dark, gain, scale, max, n);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    i = correct_u8_neon (data, dark, gain, scale, max, n);
+#endif
+
+    for (; i < n; i++)
+        data[i] = (guint8) rescale (((gfloat) data[i] - dark[i]) * gain[i], scale, max);
+}
+
+/*
+ * Derive what the kernels use from the references. Must be called with the
+ * writer lock held.
+ */
+static void
+update_coefficients (UcaFlatFieldFilterPrivate *priv)
+{
+    const gfloat *dark_ref;
+    const gfloat *flat_ref;
+    gsize n_pixels;
+
+    free (priv->dark);
+    free (priv->gain);
+    priv->dark = NULL;
+    priv->gain = NULL;
+
+    dark_ref = priv->references[UCA_FLAT_FIELD_DARK];
+    flat_ref = priv->references[UCA_FLAT_FIELD_FLAT];
+
+    if (dark_ref == NULL && flat_ref == NULL)
+        return;
+
+    n_pixels = (gsize) priv->width * priv->height;
+    priv->dark = alloc_floats (n_pixels);
+    priv->gain = alloc_floats (n_pixels);
+
+    for (gsize i = 0; i < n_pixels; i++) {
+        gfloat dark = dark_ref != NULL ? dark_ref[i] : 0.0f;
+        gfloat range = flat_ref != NULL ? flat_ref[i] - dark : 1.0f;
+
+        /* Dead pixels without any response are set to zero */
+        priv->dark[i] = dark;
+        priv->gain[i] = range > 0.0f ? 1.0f / range : 0.0f;
+    }
+}
+
+/* Takes ownership of data, which must come from alloc_floats() */
+static void
+store_reference (UcaFlatFieldFilterPrivate *priv, UcaFlatFieldReference reference,
+                 gfloat *data, guint width, guint height)
+{
+    UcaFlatFieldReference other;
+
+    other = reference == UCA_FLAT_FIELD_DARK ? UCA_FLAT_FIELD_FLAT : UCA_FLAT_FIELD_DARK;
+
+    g_rw_lock_writer_lock (&priv->lock);
+
+    /* A reference of another size makes the other one useless */
+    if (data != NULL && (width != priv->width || height != priv->height)) {
+        free (priv->references[other]);
+        priv->references[other] = NULL;
+    }
+
+    free (priv->references[reference]);
+    priv->references[reference] = data;
+
+    if (data != NULL) {
+        priv->width = width;
+        priv->height = height;
+    }
+
+    update_coefficients (priv);
+    g_rw_lock_writer_unlock (&priv->lock);
+}
+
+/**
+ * uca_flat_field_filter_new:
+ *
+ * Returns: (transfer full): A new #UcaFlatFieldFilter without references.
+ * Since: 2.4
+ */
+UcaFilter *
+uca_flat_field_filter_new (void)
+{
+    return UCA_FILTER (g_object_new (UCA_TYPE_FLAT_FIELD_FILTER, NULL));
+}
+
+/*
+ * Add a frame to sum, the first one determines the geometry. Must be called
+ * with sum_lock held if sum is shared with the filter chain.
+ */
+static gboolean
+add_to_sum (Sum *sum, gconstpointer data, const UcaFrameInfo *info, GError **error)
+{
+    if (sum->values == NULL) {
+        /* Sum in double precision, floats lose counts after a few hundred frames */
+        sum->values = g_new0 (gdouble, (gsize) info->width * info->height);
+        sum->width = info->width;
+        sum->height = info->height;
+        sum->format = info->format;
+    }
+    else if (info->width != sum->width || info->height != sum->height || info->format != sum->format) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                     "Frame of %ux%u does not match reference frames of %ux%u",
+                     info->width, info->height, sum->width, sum->height);
+        return FALSE;
+    }
+
+    for (guint y = 0; y < info->height; y++) {
+        const guint8 *row = ((const guint8 *) data) + y * info->stride;
+        gdouble *sum_row = sum->values + (gsize) y * info->width;
+
+        if (info->format == UCA_PIXEL_FORMAT_MONO8) {
+            for (guint x = 0; x < info->width; x++)
+                sum_row[x] += row[x];
+        }
+        else {
+            for (guint x = 0; x < info->width; x++)
+                sum_row[x] += ((const guint16 *) row)[x];
+        }
+    }
+
+    sum->n_frames++;
+    return TRUE;
+}
+
+/*
+ * Grab frames until the chain has passed enough of them through the filter.
+ * Frames grabbed here may have been corrected before acquisition started, so
+ * the filter sums the frames it sees instead.
+ */
+static gboolean
+sum_from_chain (UcaFlatFieldFilterPrivate *priv, UcaCamera *camera, Sum *sum, GError **error)
+{
+    UcaFrame *frame;
+    gboolean done = FALSE;
+    gboolean result = TRUE;
+
+    g_mutex_lock (&priv->sum_lock);
+    g_atomic_pointer_set (&priv->sum, sum);
+    g_mutex_unlock (&priv->sum_lock);
+
+    while (result && !done) {
+        frame = uca_camera_grab_frame (camera, error);
+        result = frame != NULL;
+
+        if (frame != NULL)
+            uca_frame_unref (frame);
+
+        g_mutex_lock (&priv->sum_lock);
+        done = sum->n_frames == sum->n_wanted || sum->error != NULL;
+        g_mutex_unlock (&priv->sum_lock);
+    }
+
+    g_mutex_lock (&priv->sum_lock);
+    g_atomic_pointer_set (&priv->sum, NULL);
+    g_mutex_unlock (&priv->sum_lock);
+
+    if (result && sum->error != NULL) {
+        g_propagate_error (error, sum->error);
+        sum->error = NULL;
+        result = FALSE;
+    }
+
+    g_clear_error (&sum->error);
+    return result;
+}
+
+/**
+ * uca_flat_field_filter_acquire:
+ * @filter: A #UcaFlatFieldFilter
+ * @camera: A recording #UcaCamera
+ * @reference: Which reference to acquire
+ * @n_frames: Number of frames to average
+ * @error: Location for a #GError or %NULL
+ *
+ * Grab frames from @camera with uca_camera_grab_frame() and use the mean of
+ * @n_frames of them as @reference. Setting up the illumination is up to the
+ * caller.
+ *
+ * If @filter is an active filter of @camera, the reference is averaged from
+ * the next @n_frames frames that reach @filter in the chain, which lets them
+ * pass unchanged. Frames corrected before are grabbed and dropped meanwhile.
+ * Otherwise the grabbed frames are averaged as the other filters of @camera
+ * left them.
+ *
+ * Returns: %TRUE on success, the previous reference is kept otherwise.
+ * Since: 2.4
+ */
+gboolean
+uca_flat_field_filter_acquire (UcaFlatFieldFilter *filter, UcaCamera *camera, UcaFlatFieldReference reference,
+                               guint n_frames, GError **error)
+{
+    UcaFlatFieldFilterPrivate *priv;
+    Sum sum = { NULL, 0, 0, UCA_PIXEL_FORMAT_MONO8, 0, 0, NULL };
+    UcaFrame *frame;
+    gfloat *mean;
+    gsize n_pixels;
+    gboolean result = TRUE;
+
+    g_return_val_if_fail (UCA_IS_FLAT_FIELD_FILTER (filter), FALSE);
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (reference == UCA_FLAT_FIELD_DARK || reference == UCA_FLAT_FIELD_FLAT, FALSE);
+    g_return_val_if_fail (n_frames > 0, FALSE);
+
+    priv = filter->priv;
+    sum.n_wanted = n_frames;
+
+    if (uca_camera_is_filter_active (camera, UCA_FILTER (filter)))
+        result = sum_from_chain (priv, camera, &sum, error);
+    else {
+        for (guint i = 0; i < n_frames && result; i++) {
+            frame = uca_camera_grab_frame (camera, error);
+            result = frame != NULL &&
+                     add_to_sum (&sum, uca_frame_get_data (frame), uca_frame_get_info (frame), error);
+
+            if (frame != NULL)
+                uca_frame_unref (frame);
+        }
+    }
+
+    if (result) {
+        n_pixels = (gsize) sum.width * sum.height;
+        mean = alloc_floats (n_pixels);
+
+        for (gsize i = 0; i < n_pixels; i++)
+            mean[i] = (gfloat) (sum.values[i] / n_frames);
+
+        store_reference (priv, reference, mean, sum.width, sum.height);
+    }
+
+    g_free (sum.values);
+    return result;
+}
+
+/**
+ * uca_flat_field_filter_set_reference:
+ * @filter: A #UcaFlatFieldFilter
+ * @reference: Which reference to set
+ * @data: (allow-none) (array): @width times @height values or %NULL to
+ *  remove @reference
+ * @width: Width of the reference
+ * @height: Height of the reference
+ *
+ * Set a reference from stored data. If the other reference has a different
+ * size, it is removed.
+ *
+ * Since: 2.4
+ */
+void
+uca_flat_field_filter_set_reference (UcaFlatFieldFilter *filter, UcaFlatFieldReference reference,
+                                     const gfloat *data, guint width, guint height)
+{
+    gfloat *copy = NULL;
+
+    g_return_if_fail (UCA_IS_FLAT_FIELD_FILTER (filter));
+    g_return_if_fail (reference == UCA_FLAT_FIELD_DARK || reference == UCA_FLAT_FIELD_FLAT);
+
+    if (data != NULL) {
+        copy = alloc_floats ((gsize) width * height);
+        memcpy (copy, data, (gsize) width * height * sizeof (gfloat));
+    }
+
+    store_reference (filter->priv, reference, copy, width, height);
+}
+
+static gboolean
+check_frame (UcaFlatFieldFilterPrivate *priv, const UcaFrameInfo *info, GError **error)
+{
+    if (priv->gain == NULL) {
+        g_set_error_literal (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_NO_REFERENCE,
+                             "Neither dark nor flat field reference set");
+        return FALSE;
+    }
+
+    if (info->width != priv->width || info->height != priv->height) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                     "Frame of %ux%u does not match references of %ux%u",
+                     info->width, info->height, priv->width, priv->height);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * uca_flat_field_filter_correct:
+ * @filter: A #UcaFlatFieldFilter
+ * @data: Pixel data of the frame
+ * @info: Description of @data
+ * @output: (array): Location for width times height corrected values
+ * @error: Location for a #GError or %NULL
+ *
+ * Correct a frame without rescaling and store the result as tightly packed
+ * floats in @output.
+ *
+ * Returns: %TRUE on success.
+ * Since: 2.4
+ */
+gboolean
+uca_flat_field_filter_correct (UcaFlatFieldFilter *filter, gconstpointer data, const UcaFrameInfo *info,
+                               gfloat *output, GError **error)
+{
+    UcaFlatFieldFilterPrivate *priv;
+    gboolean result;
+
+    g_return_val_if_fail (UCA_IS_FLAT_FIELD_FILTER (filter), FALSE);
+    g_return_val_if_fail (data != NULL && info != NULL && output != NULL, FALSE);
+
+    priv = filter->priv;
+
+    g_rw_lock_reader_lock (&priv->lock);
+    result = check_frame (priv, info, error);
+
+    for (guint y = 0; result && y < info->height; y++) {
+        const guint8 *row = ((const guint8 *) data) + y * info->stride;
+        gsize offset = (gsize) y * info->width;
+
+        if (info->format == UCA_PIXEL_FORMAT_MONO8)
+            correct_row_float_u8 (row, priv->dark + offset, priv->gain + offset, output + offset, info->width);
+        else
+            correct_row_float_u16 ((const guint16 *) row, priv->dark + offset, priv->gain + offset,
+                                   output + offset, info->width);
+    }
+
+    g_rw_lock_reader_unlock (&priv->lock);
+    return result;
+}
+
+static gboolean
+uca_flat_field_filter_process (UcaFilter *filter, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    UcaFlatFieldFilterPrivate *priv;
+    gfloat scale, max;
+    gboolean result = TRUE;
+
+    priv = UCA_FLAT_FIELD_FILTER (filter)->priv;
+
+    if (g_atomic_pointer_get (&priv->sum) != NULL) {
+        gboolean summed = FALSE;
+
+        g_mutex_lock (&priv->sum_lock);
+
+        /* Errors end acquisition, the frame itself passes */
+        if (priv->sum != NULL && priv->sum->n_frames < priv->sum->n_wanted && priv->sum->error == NULL) {
+            add_to_sum (priv->sum, data, info, &priv->sum->error);
+            summed = TRUE;
+        }
+
+        g_mutex_unlock (&priv->sum_lock);
+
+        if (summed)
+            return TRUE;
+    }
+
+    g_rw_lock_reader_lock (&priv->lock);
+
+    if (priv->gain == NULL)
+        goto out;
+
+    if (!check_frame (priv, info, error)) {
+        result = FALSE;
+        goto out;
+    }
+
+    /* By default a pixel as bright as the flat ends up in the middle */
+    max = info->format == UCA_PIXEL_FORMAT_MONO8 ? G_MAXUINT8 : G_MAXUINT16;
+    scale = priv->scale > 0.0 ? (gfloat) priv->scale : (max + 1.0f) / 2.0f;
+
+    for (guint y = 0; y < info->height; y++) {
+        guint8 *row = ((guint8 *) data) + y * info->stride;
+        gsize offset = (gsize) y * info->width;
+
+        if (info->format == UCA_PIXEL_FORMAT_MONO8)
+            correct_row_u8 (row, priv->dark + offset, priv->gain + offset, scale, max, info->width);
+        else
+            correct_row_u16 ((guint16 *) row, priv->dark + offset, priv->gain + offset, scale, max, info->width);
+    }
+
+    info->bitdepth = info->format == UCA_PIXEL_FORMAT_MONO8 ? 8 : 16;
+
+out:
+    g_rw_lock_reader_unlock (&priv->lock);
+    return result;
+}
+
+static void
+uca_flat_field_filter_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+    UcaFlatFieldFilterPrivate *priv = UCA_FLAT_FIELD_FILTER_GET_PRIVATE (object);
+
+    switch (property_id) {
+        case PROP_SCALE:
+            g_rw_lock_writer_lock (&priv->lock);
+            priv->scale = g_value_get_double (value);
+            g_rw_lock_writer_unlock (&priv->lock);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            return;
+    }
+}
+
+static void
+uca_flat_field_filter_get_property (GObject *object, guint property_id, GValue *value, GParamSpec *pspec)
+{
+    UcaFlatFieldFilterPrivate *priv = UCA_FLAT_FIELD_FILTER_GET_PRIVATE (object);
+
+    switch (property_id) {
+        case PROP_SCALE:
+            g_value_set_double (value, priv->scale);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            return;
+    }
+}
+
+static void
+uca_flat_field_filter_finalize (GObject *object)
+{
+    UcaFlatFieldFilterPrivate *priv;
+
+    priv = UCA_FLAT_FIELD_FILTER_GET_PRIVATE (object);
+    free (priv->references[UCA_FLAT_FIELD_DARK]);
+    free (priv->references[UCA_FLAT_FIELD_FLAT]);
+    free (priv->dark);
+    free (priv->gain);
+    g_rw_lock_clear (&priv->lock);
+    g_mutex_clear (&priv->sum_lock);
+
+    G_OBJECT_CLASS (uca_flat_field_filter_parent_class)->finalize (object);
+}
+
+static void
+uca_flat_field_filter_interface_init (UcaFilterInterface *iface)
+{
+    iface->process = uca_flat_field_filter_process;
+}
+
+static void
+uca_flat_field_filter_class_init (UcaFlatFieldFilterClass *klass)
+{
+    GObjectClass *oclass = G_OBJECT_CLASS (klass);
+
+    oclass->set_property = uca_flat_field_filter_set_property;
+    oclass->get_property = uca_flat_field_filter_get_property;
+    oclass->finalize = uca_flat_field_filter_finalize;
+
+    filter_properties[PROP_SCALE] =
+        g_param_spec_double ("scale",
+            "Factor applied to corrected values in the filter chain",
+            "Factor applied to corrected values in the filter chain, 0 for half of the output range",
+            0.0, G_MAXDOUBLE, 0.0,
+            G_PARAM_READWRITE);
+
+    for (guint id = PROP_SCALE; id < N_FILTER_PROPERTIES; id++)
+        g_object_class_install_property (oclass, id, filter_properties[id]);
+
+    g_type_class_add_private (klass, sizeof (UcaFlatFieldFilterPrivate));
+
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init ();
+    have_avx2 = __builtin_cpu_supports ("avx2");
+#endif
+}
+
+static void
+uca_flat_field_filter_init (UcaFlatFieldFilter *filter)
+{
+    UcaFlatFieldFilterPrivate *priv;
+
+    filter->priv = priv = UCA_FLAT_FIELD_FILTER_GET_PRIVATE (filter);
+    g_rw_lock_init (&priv->lock);
+    priv->width = 0;
+    priv->height = 0;
+    priv->references[UCA_FLAT_FIELD_DARK] = NULL;
+    priv->references[UCA_FLAT_FIELD_FLAT] = NULL;
+    priv->dark = NULL;
+    priv->gain = NULL;
+    priv->scale = 0.0;
+    g_mutex_init (&priv->sum_lock);
+    priv->sum = NULL;
+}
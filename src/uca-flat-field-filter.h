@@ -0,0 +1,65 @@
+#ifndef UCA_FLAT_FIELD_FILTER_H
+#define UCA_FLAT_FIELD_FILTER_H
+
+#include <glib-object.h>
+#include "uca-camera.h"
+
+#define UCA_TYPE_FLAT_FIELD_FILTER             (uca_flat_field_filter_get_type())
+#define UCA_FLAT_FIELD_FILTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_FLAT_FIELD_FILTER, UcaFlatFieldFilter))
+#define UCA_IS_FLAT_FIELD_FILTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_FLAT_FIELD_FILTER))
+#define UCA_FLAT_FIELD_FILTER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_FLAT_FIELD_FILTER, UcaFlatFieldFilterClass))
+#define UCA_IS_FLAT_FIELD_FILTER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_FLAT_FIELD_FILTER))
+#define UCA_FLAT_FIELD_FILTER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_FLAT_FIELD_FILTER, UcaFlatFieldFilterClass))
+
+G_BEGIN_DECLS
+
+/**
+ * UcaFlatFieldReference:
+ * @UCA_FLAT_FIELD_DARK: Frame taken without illumination
+ * @UCA_FLAT_FIELD_FLAT: Frame taken with illumination but without a sample
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_FLAT_FIELD_DARK,
+    UCA_FLAT_FIELD_FLAT,
+} UcaFlatFieldReference;
+
+typedef struct _UcaFlatFieldFilter           UcaFlatFieldFilter;
+typedef struct _UcaFlatFieldFilterClass      UcaFlatFieldFilterClass;
+typedef struct _UcaFlatFieldFilterPrivate    UcaFlatFieldFilterPrivate;
+
+struct _UcaFlatFieldFilter {
+    /*< private >*/
+    GObject parent;
+
+    UcaFlatFieldFilterPrivate *priv;
+};
+
+struct _UcaFlatFieldFilterClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UcaFilter * uca_flat_field_filter_new           (void);
+gboolean    uca_flat_field_filter_acquire       (UcaFlatFieldFilter     *filter,
+                                                 UcaCamera              *camera,
+                                                 UcaFlatFieldReference   reference,
+                                                 guint                   n_frames,
+                                                 GError                **error);
+void        uca_flat_field_filter_set_reference (UcaFlatFieldFilter     *filter,
+                                                 UcaFlatFieldReference   reference,
+                                                 const gfloat           *data,
+                                                 guint                   width,
+                                                 guint                   height);
+gboolean    uca_flat_field_filter_correct       (UcaFlatFieldFilter     *filter,
+                                                 gconstpointer           data,
+                                                 const UcaFrameInfo     *info,
+                                                 gfloat                 *output,
+                                                 GError                **error);
+
+GType uca_flat_field_filter_get_type (void);
+
+G_END_DECLS
+
+#endif
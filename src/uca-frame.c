@@ -0,0 +1,213 @@
+/* Copyright (C) 2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-frame
+ * @Short_description: Reference counted frame with its description
+ * @Title: UcaFrame
+ *
+ * A #UcaFrame holds the pixel data of a single frame together with a
+ * #UcaFrameInfo describing its geometry, so that consumers neither have to
+ * query camera properties to size buffers nor guess where a frame came from.
+ * Frames are returned by uca_camera_grab_frame().
+ */
+
+#include <string.h>
+#include "uca-frame.h"
+
+/* Pixel data starts at this offset from the frame header */
+#define FRAME_DATA_OFFSET   128
+
+struct _UcaFrame {
+    volatile gint ref_count;
+    gsize size;
+    UcaFrameInfo info;
+};
+
+G_STATIC_ASSERT (sizeof (UcaFrame) <= FRAME_DATA_OFFSET);
+
+G_DEFINE_BOXED_TYPE (UcaFrame, uca_frame, uca_frame_ref, uca_frame_unref)
+
+/**
+ * uca_frame_info_init:
+ * @info: A #UcaFrameInfo
+ * @width: Width in pixels
+ * @height: Height in pixels
+ * @bitdepth: Number of significant bits per pixel
+ *
+ * Describe a tightly packed frame of the given geometry. The sequence number
+ * and timestamps are set to zero.
+ *
+ * Since: 2.4
+ */
+void
+uca_frame_info_init (UcaFrameInfo *info, guint width, guint height, guint bitdepth)
+{
+    g_return_if_fail (info != NULL);
+
+    memset (info, 0, sizeof (UcaFrameInfo));
+    info->width = width;
+    info->height = height;
+    info->bitdepth = bitdepth;
+    info->format = bitdepth <= 8 ? UCA_PIXEL_FORMAT_MONO8 : UCA_PIXEL_FORMAT_MONO16;
+    info->stride = (gsize) width * (bitdepth <= 8 ? 1 : 2);
+}
+
+/**
+ * uca_frame_info_get_size:
+ * @info: A #UcaFrameInfo
+ *
+ * Returns: Number of bytes needed to store a frame described by @info.
+ * Since: 2.4
+ */
+gsize
+uca_frame_info_get_size (const UcaFrameInfo *info)
+{
+    g_return_val_if_fail (info != NULL, 0);
+    return info->stride * info->height;
+}
+
+/**
+ * uca_frame_new:
+ * @info: Description of the frame
+ *
+ * Allocate an uninitialized frame large enough for @info.
+ *
+ * Returns: (transfer full): A new #UcaFrame with a reference count of one.
+ * Since: 2.4
+ */
+UcaFrame *
+uca_frame_new (const UcaFrameInfo *info)
+{
+    UcaFrame *frame;
+    gsize size;
+
+    g_return_val_if_fail (info != NULL, NULL);
+
+    /* Header and data in one block, so a frame costs a single allocation */
+    size = uca_frame_info_get_size (info);
+    frame = g_malloc (FRAME_DATA_OFFSET + size);
+    frame->ref_count = 1;
+    frame->size = size;
+    frame->info = *info;
+
+    return frame;
+}
+
+/**
+ * uca_frame_new_sized:
+ * @size: Number of bytes to allocate for pixel data
+ *
+ * Allocate an uninitialized frame that can hold up to @size bytes, for frames
+ * whose geometry is only known once they have been filled. The #UcaFrameInfo
+ * is cleared and must be filled in by the owner.
+ *
+ * Returns: (transfer full): A new #UcaFrame with a reference count of one.
+ * Since: 2.4
+ */
+UcaFrame *
+uca_frame_new_sized (gsize size)
+{
+    UcaFrame *frame;
+
+    frame = g_malloc (FRAME_DATA_OFFSET + size);
+    frame->ref_count = 1;
+    frame->size = size;
+    memset (&frame->info, 0, sizeof (UcaFrameInfo));
+
+    return frame;
+}
+
+/**
+ * uca_frame_ref:
+ * @frame: A #UcaFrame
+ *
+ * Returns: (transfer full): @frame with its reference count increased.
+ * Since: 2.4
+ */
+UcaFrame *
+uca_frame_ref (UcaFrame *frame)
+{
+    g_return_val_if_fail (frame != NULL, NULL);
+
+    g_atomic_int_inc (&frame->ref_count);
+    return frame;
+}
+
+/**
+ * uca_frame_unref:
+ * @frame: A #UcaFrame
+ *
+ * Decrease the reference count of @frame and free it when it drops to zero.
+ *
+ * Since: 2.4
+ */
+void
+uca_frame_unref (UcaFrame *frame)
+{
+    g_return_if_fail (frame != NULL);
+
+    if (g_atomic_int_dec_and_test (&frame->ref_count))
+        g_free (frame);
+}
+
+/**
+ * uca_frame_get_info:
+ * @frame: A #UcaFrame
+ *
+ * Get the description of @frame. Only the owner of the frame, usually the
+ * camera that filled it, should modify it.
+ *
+ * Returns: (transfer none): The #UcaFrameInfo of @frame
+ * Since: 2.4
+ */
+UcaFrameInfo *
+uca_frame_get_info (UcaFrame *frame)
+{
+    g_return_val_if_fail (frame != NULL, NULL);
+    return &frame->info;
+}
+
+/**
+ * uca_frame_get_data:
+ * @frame: A #UcaFrame
+ *
+ * Returns: (transfer none): Pointer to the pixel data of @frame
+ * Since: 2.4
+ */
+gpointer
+uca_frame_get_data (UcaFrame *frame)
+{
+    g_return_val_if_fail (frame != NULL, NULL);
+    return ((guint8 *) frame) + FRAME_DATA_OFFSET;
+}
+
+/**
+ * uca_frame_get_size:
+ * @frame: A #UcaFrame
+ *
+ * Returns: Number of bytes of pixel data in @frame
+ * Since: 2.4
+ */
+gsize
+uca_frame_get_size (UcaFrame *frame)
+{
+    g_return_val_if_fail (frame != NULL, 0);
+
+    /* The owner may have described a frame smaller than the allocation */
+    return MIN (frame->size, uca_frame_info_get_size (&frame->info));
+}
@@ -0,0 +1,87 @@
+#ifndef UCA_FRAME_H
+#define UCA_FRAME_H
+
+#include <glib-object.h>
+
+#define UCA_TYPE_FRAME  (uca_frame_get_type())
+
+G_BEGIN_DECLS
+
+/**
+ * UcaPixelFormat:
+ * @UCA_PIXEL_FORMAT_MONO8: One byte per pixel
+ * @UCA_PIXEL_FORMAT_MONO16: Two bytes per pixel in host byte order, used for
+ *  bit depths between 9 and 16
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_PIXEL_FORMAT_MONO8,
+    UCA_PIXEL_FORMAT_MONO16,
+} UcaPixelFormat;
+
+/**
+ * UcaFrameFlags:
+ * @UCA_FRAME_FLAG_NONE: Nothing happened in the frame
+ * @UCA_FRAME_FLAG_TRIGGERED: A filter such as #UcaContentTrigger detected an
+ *  event in the frame
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_FRAME_FLAG_NONE      = 0,
+    UCA_FRAME_FLAG_TRIGGERED = 1 << 0,
+} UcaFrameFlags;
+
+/**
+ * UcaFrameInfo:
+ * @width: Width of the frame in pixels
+ * @height: Height of the frame in pixels
+ * @stride: Distance between the start of two rows in bytes
+ * @format: Layout of a pixel
+ * @bitdepth: Number of significant bits per pixel
+ * @sequence: Running number of the frame within a recording, gaps mean that
+ *  frames were lost
+ * @start_time: Monotonic host time in microseconds when grabbing started
+ * @end_time: Monotonic host time in microseconds when the frame was complete
+ * @settings_serial: Number of queued property updates applied before the
+ *  frame was acquired, see #UcaRingBufferMetadata
+ * @flags: Events that filters detected in the frame
+ *
+ * Describes the layout and origin of a #UcaFrame.
+ *
+ * Since: 2.4
+ */
+typedef struct {
+    guint           width;
+    guint           height;
+    gsize           stride;
+    UcaPixelFormat  format;
+    guint           bitdepth;
+    guint64         sequence;
+    gint64          start_time;
+    gint64          end_time;
+    guint           settings_serial;
+    UcaFrameFlags   flags;
+} UcaFrameInfo;
+
+typedef struct _UcaFrame UcaFrame;
+
+UcaFrame *      uca_frame_new               (const UcaFrameInfo *info);
+UcaFrame *      uca_frame_new_sized         (gsize               size);
+UcaFrame *      uca_frame_ref               (UcaFrame           *frame);
+void            uca_frame_unref             (UcaFrame           *frame);
+UcaFrameInfo *  uca_frame_get_info          (UcaFrame           *frame);
+gpointer        uca_frame_get_data          (UcaFrame           *frame);
+gsize           uca_frame_get_size          (UcaFrame           *frame);
+void            uca_frame_info_init         (UcaFrameInfo       *info,
+                                             guint               width,
+                                             guint               height,
+                                             guint               bitdepth);
+gsize           uca_frame_info_get_size     (const UcaFrameInfo *info);
+
+GType uca_frame_get_type (void);
+
+G_END_DECLS
+
+#endif
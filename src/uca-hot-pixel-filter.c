@@ -0,0 +1,207 @@
+/* Copyright (C) 2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-hot-pixel-filter
+ * @Short_description: Hot pixel replacement
+ * @Title: UcaHotPixelFilter
+ *
+ * A #UcaFilter that replaces known defective pixels with the mean of the
+ * nearest good pixels to their left and right in the same row. The positions
+ * are taken from a mask once, so that processing a frame only touches the
+ * defective pixels.
+ */
+
+#include "uca-hot-pixel-filter.h"
+
+#define UCA_HOT_PIXEL_FILTER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_HOT_PIXEL_FILTER, UcaHotPixelFilterPrivate))
+
+static void uca_hot_pixel_filter_interface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UcaHotPixelFilter, uca_hot_pixel_filter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_hot_pixel_filter_interface_init))
+
+typedef struct {
+    guint x;
+    guint y;
+    gint left;      /* column of the nearest good pixel or -1 */
+    gint right;
+} HotPixel;
+
+struct _UcaHotPixelFilterPrivate {
+    GRWLock lock;
+    guint width;
+    guint height;
+    GArray *pixels;
+};
+
+/**
+ * uca_hot_pixel_filter_new:
+ *
+ * Returns: (transfer full): A new #UcaHotPixelFilter without defective
+ * pixels.
+ * Since: 2.4
+ */
+UcaFilter *
+uca_hot_pixel_filter_new (void)
+{
+    return UCA_FILTER (g_object_new (UCA_TYPE_HOT_PIXEL_FILTER, NULL));
+}
+
+/**
+ * uca_hot_pixel_filter_set_mask:
+ * @filter: A #UcaHotPixelFilter
+ * @mask: (allow-none) (array): @width times @height bytes, non-zero entries
+ *  mark defective pixels. %NULL removes all of them.
+ * @width: Width of the mask
+ * @height: Height of the mask
+ *
+ * Set the defective pixels. Frames must have the same geometry as the mask.
+ *
+ * Since: 2.4
+ */
+void
+uca_hot_pixel_filter_set_mask (UcaHotPixelFilter *filter, const guint8 *mask, guint width, guint height)
+{
+    UcaHotPixelFilterPrivate *priv;
+    GArray *pixels;
+
+    g_return_if_fail (UCA_IS_HOT_PIXEL_FILTER (filter));
+
+    priv = filter->priv;
+    pixels = g_array_new (FALSE, FALSE, sizeof (HotPixel));
+
+    for (guint y = 0; mask != NULL && y < height; y++) {
+        const guint8 *row = mask + (gsize) y * width;
+
+        for (guint x = 0; x < width; x++) {
+            HotPixel pixel;
+            gint i;
+
+            if (!row[x])
+                continue;
+
+            pixel.x = x;
+            pixel.y = y;
+
+            for (i = (gint) x - 1; i >= 0 && row[i]; i--)
+                ;
+
+            pixel.left = i;
+
+            for (i = (gint) x + 1; i < (gint) width && row[i]; i++)
+                ;
+
+            pixel.right = i < (gint) width ? i : -1;
+            g_array_append_val (pixels, pixel);
+        }
+    }
+
+    g_rw_lock_writer_lock (&priv->lock);
+    g_array_free (priv->pixels, TRUE);
+    priv->pixels = pixels;
+    priv->width = width;
+    priv->height = height;
+    g_rw_lock_writer_unlock (&priv->lock);
+}
+
+#define REPLACE_PIXELS(type)                                                \
+    for (guint i = 0; i < priv->pixels->len; i++) {                         \
+        HotPixel *p = &g_array_index (priv->pixels, HotPixel, i);           \
+        type *row = (type *) (((guint8 *) data) + p->y * info->stride);     \
+                                                                            \
+        if (p->left >= 0 && p->right >= 0)                                  \
+            row[p->x] = (type) (((guint) row[p->left] + row[p->right]) / 2);\
+        else if (p->left >= 0)                                              \
+            row[p->x] = row[p->left];                                       \
+        else if (p->right >= 0)                                             \
+            row[p->x] = row[p->right];                                      \
+    }
+
+static gboolean
+uca_hot_pixel_filter_process (UcaFilter *filter, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    UcaHotPixelFilterPrivate *priv;
+    gboolean result = TRUE;
+
+    priv = UCA_HOT_PIXEL_FILTER (filter)->priv;
+
+    g_rw_lock_reader_lock (&priv->lock);
+
+    if (priv->pixels->len == 0)
+        goto out;
+
+    if (info->width != priv->width || info->height != priv->height) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                     "Frame of %ux%u does not match hot pixel mask of %ux%u",
+                     info->width, info->height, priv->width, priv->height);
+        result = FALSE;
+        goto out;
+    }
+
+    if (info->format == UCA_PIXEL_FORMAT_MONO8) {
+        REPLACE_PIXELS (guint8)
+    }
+    else {
+        REPLACE_PIXELS (guint16)
+    }
+
+out:
+    g_rw_lock_reader_unlock (&priv->lock);
+    return result;
+}
+
+static void
+uca_hot_pixel_filter_finalize (GObject *object)
+{
+    UcaHotPixelFilterPrivate *priv;
+
+    priv = UCA_HOT_PIXEL_FILTER_GET_PRIVATE (object);
+    g_array_free (priv->pixels, TRUE);
+    g_rw_lock_clear (&priv->lock);
+
+    G_OBJECT_CLASS (uca_hot_pixel_filter_parent_class)->finalize (object);
+}
+
+static void
+uca_hot_pixel_filter_interface_init (UcaFilterInterface *iface)
+{
+    iface->process = uca_hot_pixel_filter_process;
+}
+
+static void
+uca_hot_pixel_filter_class_init (UcaHotPixelFilterClass *klass)
+{
+    GObjectClass *oclass = G_OBJECT_CLASS (klass);
+
+    oclass->finalize = uca_hot_pixel_filter_finalize;
+
+    g_type_class_add_private (klass, sizeof (UcaHotPixelFilterPrivate));
+}
+
+static void
+uca_hot_pixel_filter_init (UcaHotPixelFilter *filter)
+{
+    UcaHotPixelFilterPrivate *priv;
+
+    filter->priv = priv = UCA_HOT_PIXEL_FILTER_GET_PRIVATE (filter);
+    g_rw_lock_init (&priv->lock);
+    priv->pixels = g_array_new (FALSE, FALSE, sizeof (HotPixel));
+    priv->width = 0;
+    priv->height = 0;
+}
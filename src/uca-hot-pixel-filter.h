@@ -0,0 +1,42 @@
+#ifndef UCA_HOT_PIXEL_FILTER_H
+#define UCA_HOT_PIXEL_FILTER_H
+
+#include <glib-object.h>
+#include "uca-filter.h"
+
+#define UCA_TYPE_HOT_PIXEL_FILTER             (uca_hot_pixel_filter_get_type())
+#define UCA_HOT_PIXEL_FILTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_HOT_PIXEL_FILTER, UcaHotPixelFilter))
+#define UCA_IS_HOT_PIXEL_FILTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_HOT_PIXEL_FILTER))
+#define UCA_HOT_PIXEL_FILTER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_HOT_PIXEL_FILTER, UcaHotPixelFilterClass))
+#define UCA_IS_HOT_PIXEL_FILTER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_HOT_PIXEL_FILTER))
+#define UCA_HOT_PIXEL_FILTER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_HOT_PIXEL_FILTER, UcaHotPixelFilterClass))
+
+G_BEGIN_DECLS
+
+typedef struct _UcaHotPixelFilter           UcaHotPixelFilter;
+typedef struct _UcaHotPixelFilterClass      UcaHotPixelFilterClass;
+typedef struct _UcaHotPixelFilterPrivate    UcaHotPixelFilterPrivate;
+
+struct _UcaHotPixelFilter {
+    /*< private >*/
+    GObject parent;
+
+    UcaHotPixelFilterPrivate *priv;
+};
+
+struct _UcaHotPixelFilterClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UcaFilter * uca_hot_pixel_filter_new        (void);
+void        uca_hot_pixel_filter_set_mask   (UcaHotPixelFilter  *filter,
+                                             const guint8       *mask,
+                                             guint               width,
+                                             guint               height);
+
+GType uca_hot_pixel_filter_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -15,119 +15,1306 @@
    with this library; if not, write to the Free Software Foundation, Inc., 51
    Franklin St, Fifth Floor, Boston, MA 02110, USA */
 
+/* Needed for MAP_ANONYMOUS, madvise() and syscall() with -std=c99 */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <glib.h>
 #include <math.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
 #include "uca-ring-buffer.h"
+#include "uca-enums.h"
 
 #define UCA_RING_BUFFER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_RING_BUFFER, UcaRingBufferPrivate))
 
+#define CACHE_LINE_SIZE 64
+
+/*
+ * Bounds for the number of iterations a waiting consumer busy-polls before it
+ * goes to sleep on the condition variable. The actual limit adapts to whether
+ * spinning paid off the last time.
+ */
+#define MIN_SPIN_COUNT  64
+#define MAX_SPIN_COUNT  16384
+
+/* Maximum number of readers added with uca_ring_buffer_add_reader() */
+#define MAX_READERS     16
+
+/*
+ * Default huge page size, used when the kernel does not report one in
+ * /proc/meminfo. Mappings using huge pages are rounded and aligned to the
+ * actual size returned by get_huge_page_size().
+ */
+#define DEFAULT_HUGE_PAGE_SIZE  (2 << 20)
+
+/* Pages are faulted in chunks so that a prefault thread can be stopped early */
+#define PREFAULT_CHUNK_SIZE (4 << 20)
+
+#ifdef __linux__
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+#endif
+
 G_DEFINE_TYPE(UcaRingBuffer, uca_ring_buffer, G_TYPE_OBJECT)
 
+/*
+ * The buffer is a single-producer/single-consumer queue. write_index is only
+ * ever modified by the producer. read_index is advanced by the consumer and,
+ * when the producer laps it with uca_ring_buffer_wait_writable(), by the
+ * producer dropping the oldest block. Both are monotonically increasing and
+ * live on separate cache lines so that producer and consumer do not
+ * invalidate each other's lines on every frame.
+ *
+ * pins counts the outstanding borrows per block. A block is pinned before
+ * read_index is moved past it, so the producer either sees the pin or fails to
+ * move read_index itself and leaves the block alone.
+ *
+ * Additional readers have their own cursor. Lossless readers follow the same
+ * protocol as read_index and are taken into account by the producer, lossy
+ * readers jump to the newest block and never hold the producer back.
+ *
+ * Every block has a metadata record in a separate, densely packed array so
+ * that scanning metadata does not pull in pixel data. The record is stamped
+ * with the running number of frames the producer has seen, so that consumers
+ * can detect gaps. The statistics next to
+ * write_index are only modified by the producer.
+ *
+ * stage_index is where the producer writes. It runs ahead of write_index when
+ * blocks are staged with uca_ring_buffer_write_stage() and published later
+ * with uca_ring_buffer_commit(), otherwise both are the same. Readers only
+ * ever see blocks before write_index, the producer never overwrites blocks
+ * between them.
+ */
+struct _UcaRingBufferReader {
+    gsize cursor;
+    gsize drops;
+    volatile gint active;
+    UcaRingBufferReaderMode mode;
+    guint spin_count;
+    gchar pad[CACHE_LINE_SIZE - 2 * sizeof (gsize) - 3 * sizeof (gint)];
+};
+
 struct _UcaRingBufferPrivate {
     guchar  *data;
     gsize    block_size;
     guint    n_blocks_total;
-    guint    write_index;
-    guint    read_index;
-    guint    read;
-    guint    written;
+    volatile gint *pins;
+    UcaRingBufferMetadata *metadata;
+    UcaRingBufferMetadata scratch_metadata;
+    guchar  *scratch;
+    UcaRingBufferPolicy policy;
+
+    guint    alloc_flags;
+    gsize    alignment;
+    gint     numa_node;
+    gsize    mapped_size;
+    gboolean constructed;
+    GThread *prefault_thread;
+    volatile gint prefault_cancelled;
+
+    gchar    pad0[CACHE_LINE_SIZE];
+    gsize write_index;
+    gsize stage_index;
+    gsize    n_produced;
+    gsize overruns;
+    volatile guint max_fill;
+    gboolean dropping;
+    gchar    pad1[CACHE_LINE_SIZE - 4 * sizeof (gsize) - 2 * sizeof (guint)];
+    gsize read_index;
+    guint    spin_count;
+    gchar    pad2[CACHE_LINE_SIZE - sizeof (gsize) - sizeof (guint)];
+
+    GMutex   wait_mutex;
+    GCond    wait_cond;
+    volatile gint n_waiters;
+
+    UcaRingBufferReader readers[MAX_READERS];
+    volatile gint n_readers;
+};
+
+enum {
+    PROP_0,
+    PROP_BLOCK_SIZE,
+    PROP_NUM_BLOCKS,
+    PROP_ALLOC_FLAGS,
+    PROP_ALIGNMENT,
+    PROP_NUMA_NODE,
+    PROP_POLICY,
+    N_PROPERTIES
 };
 
-enum {
-    PROP_0,
-    PROP_BLOCK_SIZE,
-    PROP_NUM_BLOCKS,
-    N_PROPERTIES
-};
+static GParamSpec *properties[N_PROPERTIES] = { NULL, };
+
+static void realloc_mem (UcaRingBufferPrivate *priv);
+
+static inline gsize
+get_index (gsize *index)
+{
+    return (gsize) g_atomic_pointer_get (index);
+}
+
+static inline void
+set_index (gsize *index, gsize value)
+{
+    g_atomic_pointer_set (index, value);
+}
+
+static inline gboolean
+cas_index (gsize *index, gsize old_value, gsize new_value)
+{
+    return g_atomic_pointer_compare_and_exchange (index, old_value, new_value);
+}
+
+/*
+ * Return the cursor of the reader that lags behind most, taking read_index and
+ * all lossless readers into account.
+ */
+static gsize
+slowest_cursor (UcaRingBufferPrivate *priv)
+{
+    gsize slowest;
+    gint n_readers;
+
+    slowest = get_index (&priv->read_index);
+    n_readers = g_atomic_int_get (&priv->n_readers);
+
+    for (gint i = 0; i < n_readers; i++) {
+        UcaRingBufferReader *reader = &priv->readers[i];
+
+        if (g_atomic_int_get (&reader->active) && reader->mode == UCA_RING_BUFFER_READER_LOSSLESS)
+            slowest = MIN (slowest, get_index (&reader->cursor));
+    }
+
+    return slowest;
+}
+
+/* Check if the producer would overwrite a block that was not read yet */
+static inline gboolean
+is_full (UcaRingBufferPrivate *priv)
+{
+    return get_index (&priv->stage_index) - slowest_cursor (priv) >= priv->n_blocks_total;
+}
+
+static inline void
+cpu_relax (void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__ ("pause" ::: "memory");
+#endif
+}
+
+static inline guchar *
+block_pointer (UcaRingBufferPrivate *priv, gsize index)
+{
+    return priv->data + (index % priv->n_blocks_total) * priv->block_size;
+}
+
+/*
+ * Map a pointer into the block memory back to its slot. Returns FALSE if data
+ * does not point into the buffer.
+ */
+static gboolean
+block_slot (UcaRingBufferPrivate *priv, gpointer data, guint *slot)
+{
+    gsize offset;
+
+    if ((guchar *) data < priv->data)
+        return FALSE;
+
+    offset = (gsize) ((guchar *) data - priv->data);
+
+    if (offset >= priv->n_blocks_total * priv->block_size)
+        return FALSE;
+
+    *slot = (guint) (offset / priv->block_size);
+    return TRUE;
+}
+
+static void
+wake_waiters (UcaRingBufferPrivate *priv)
+{
+    if (g_atomic_int_get (&priv->n_waiters) > 0) {
+        g_mutex_lock (&priv->wait_mutex);
+        g_cond_broadcast (&priv->wait_cond);
+        g_mutex_unlock (&priv->wait_mutex);
+    }
+}
+
+typedef gboolean (*ConditionFunc) (UcaRingBuffer *buffer, gpointer user_data);
+
+/*
+ * Sleep until condition holds or the absolute monotonic end_time passed. A
+ * negative end_time waits indefinitely.
+ */
+static gboolean
+wait_until (UcaRingBuffer *buffer, ConditionFunc condition, gpointer user_data, gint64 end_time)
+{
+    UcaRingBufferPrivate *priv;
+    gboolean result;
+
+    priv = buffer->priv;
+    g_mutex_lock (&priv->wait_mutex);
+
+    /*
+     * Announce ourselves before checking again, otherwise the other side could
+     * change the state in between and miss that someone is waiting.
+     */
+    g_atomic_int_inc (&priv->n_waiters);
+
+    while (!(result = condition (buffer, user_data))) {
+        if (end_time < 0)
+            g_cond_wait (&priv->wait_cond, &priv->wait_mutex);
+        else if (!g_cond_wait_until (&priv->wait_cond, &priv->wait_mutex, end_time)) {
+            result = condition (buffer, user_data);
+            break;
+        }
+    }
+
+    g_atomic_int_add (&priv->n_waiters, -1);
+    g_mutex_unlock (&priv->wait_mutex);
+
+    return result;
+}
+
+/*
+ * Poll for a short, adaptive period and then sleep on the condition variable.
+ * spin_count is doubled when polling paid off and halved otherwise.
+ */
+static gboolean
+spin_then_wait (UcaRingBuffer *buffer, guint *spin_count,
+                ConditionFunc condition, gpointer user_data, gint64 timeout_us)
+{
+    for (guint i = 0; i < *spin_count; i++) {
+        if (condition (buffer, user_data)) {
+            *spin_count = MIN (*spin_count * 2, MAX_SPIN_COUNT);
+            return TRUE;
+        }
+
+        cpu_relax ();
+    }
+
+    *spin_count = MAX (*spin_count / 2, MIN_SPIN_COUNT);
+
+    if (timeout_us == 0)
+        return condition (buffer, user_data);
+
+    return wait_until (buffer, condition, user_data,
+                       timeout_us > 0 ? g_get_monotonic_time () + timeout_us : -1);
+}
+
+static gboolean
+cursor_readable (UcaRingBuffer *buffer, gpointer cursor)
+{
+    return get_index ((gsize *) cursor) < get_index (&buffer->priv->write_index);
+}
+
+UcaRingBuffer *
+uca_ring_buffer_new (gsize block_size,
+                     guint n_blocks)
+{
+    UcaRingBuffer *buffer;
+
+    buffer = g_object_new (UCA_TYPE_RING_BUFFER,
+                           "block-size", (guint64) block_size,
+                           "num-blocks", n_blocks,
+                           NULL);
+    return buffer;
+}
+
+static void
+reset_state (UcaRingBufferPrivate *priv)
+{
+    set_index (&priv->write_index, 0);
+    set_index (&priv->stage_index, 0);
+    set_index (&priv->read_index, 0);
+    set_index (&priv->overruns, 0);
+    g_atomic_int_set (&priv->max_fill, 0);
+    priv->n_produced = 0;
+    priv->dropping = FALSE;
+
+    for (guint i = 0; i < MAX_READERS; i++) {
+        set_index (&priv->readers[i].cursor, 0);
+        set_index (&priv->readers[i].drops, 0);
+    }
+}
+
+static guint
+count_borrowed (UcaRingBufferPrivate *priv)
+{
+    guint n_borrowed = 0;
+
+    for (guint i = 0; i < priv->n_blocks_total; i++) {
+        if (g_atomic_int_get (&priv->pins[i]) > 0)
+            n_borrowed++;
+    }
+
+    return n_borrowed;
+}
+
+/**
+ * uca_ring_buffer_reset:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Empty @buffer. Blocks that are still borrowed stay valid and are not
+ * written until they are released.
+ */
+void
+uca_ring_buffer_reset (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+
+    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+    priv = buffer->priv;
+
+    reset_state (priv);
+
+    /* The pins of borrowed blocks must balance their late release */
+    for (guint i = 0; i < priv->n_blocks_total; i++) {
+        if (g_atomic_int_get (&priv->pins[i]) == 0)
+            memset (&priv->metadata[i], 0, sizeof (UcaRingBufferMetadata));
+    }
+}
+
+/**
+ * uca_ring_buffer_get_num_borrowed:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get the number of blocks that were borrowed and not released yet.
+ *
+ * Return value: Number of borrowed blocks
+ * Since: 2.4
+ */
+guint
+uca_ring_buffer_get_num_borrowed (UcaRingBuffer *buffer)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
+    return count_borrowed (buffer->priv);
+}
+
+/**
+ * uca_ring_buffer_contains:
+ * @buffer: A #UcaRingBuffer object
+ * @data: A pointer
+ *
+ * Return value: %TRUE if @data points into a block of @buffer.
+ * Since: 2.4
+ */
+gboolean
+uca_ring_buffer_contains (UcaRingBuffer *buffer,
+                          gpointer       data)
+{
+    guint slot;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    return block_slot (buffer->priv, data, &slot);
+}
+
+/**
+ * uca_ring_buffer_resize:
+ * @buffer: A #UcaRingBuffer object
+ * @block_size: Number of bytes per block
+ * @n_blocks: Number of blocks
+ *
+ * Change the geometry of @buffer. Memory is only reallocated if @block_size or
+ * @n_blocks differ from the current values. In either case the buffer is
+ * empty afterwards.
+ *
+ * Memory that still holds borrowed blocks is never freed. If it would have to
+ * be reallocated, @buffer is left unchanged and %FALSE is returned, so that
+ * the caller can use a new buffer and keep this one until all blocks are
+ * released.
+ *
+ * Return value: %TRUE if @buffer has the requested geometry.
+ * Since: 2.4
+ */
+gboolean
+uca_ring_buffer_resize (UcaRingBuffer *buffer,
+                        gsize          block_size,
+                        guint          n_blocks)
+{
+    UcaRingBufferPrivate *priv;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    priv = buffer->priv;
+
+    if (priv->block_size == block_size && priv->n_blocks_total == n_blocks) {
+        uca_ring_buffer_reset (buffer);
+        return TRUE;
+    }
+
+    if (count_borrowed (priv) > 0)
+        return FALSE;
+
+    priv->block_size = block_size;
+    priv->n_blocks_total = n_blocks;
+    realloc_mem (priv);
+
+    g_object_notify_by_pspec (G_OBJECT (buffer), properties[PROP_BLOCK_SIZE]);
+    g_object_notify_by_pspec (G_OBJECT (buffer), properties[PROP_NUM_BLOCKS]);
+    return TRUE;
+}
+
+gsize
+uca_ring_buffer_get_block_size (UcaRingBuffer *buffer)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
+    return buffer->priv->block_size;
+}
+
+gboolean
+uca_ring_buffer_available (UcaRingBuffer *buffer)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    return cursor_readable (buffer, (gpointer) &buffer->priv->read_index);
+}
+
+/**
+ * uca_ring_buffer_wait_readable:
+ * @buffer: A #UcaRingBuffer object
+ * @timeout_us: Maximum time to wait in microseconds, 0 to return immediately
+ *  or a negative value to wait indefinitely
+ *
+ * Wait until a block can be read. The consumer polls for a short, adaptive
+ * period and then sleeps until the producer calls
+ * uca_ring_buffer_write_advance() or @timeout_us has elapsed.
+ *
+ * Return value: %TRUE if data is available, %FALSE if the timeout elapsed.
+ * Since: 2.4
+ */
+gboolean
+uca_ring_buffer_wait_readable (UcaRingBuffer *buffer,
+                               gint64         timeout_us)
+{
+    UcaRingBufferPrivate *priv;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    priv = buffer->priv;
+
+    return spin_then_wait (buffer, &priv->spin_count, cursor_readable,
+                           (gpointer) &priv->read_index, timeout_us);
+}
+
+/*
+ * Move cursor past the oldest unread block and return its index. If pin is
+ * TRUE, the block is protected from being overwritten until it is unpinned.
+ */
+static gboolean
+claim_read_index (UcaRingBufferPrivate *priv, gsize *cursor, gboolean pin, gsize *index)
+{
+    while (1) {
+        gsize read_index;
+        guint slot;
+
+        read_index = get_index (cursor);
+
+        if (read_index >= get_index (&priv->write_index))
+            return FALSE;
+
+        slot = read_index % priv->n_blocks_total;
+
+        if (pin)
+            g_atomic_int_inc (&priv->pins[slot]);
+
+        if (cas_index (cursor, read_index, read_index + 1)) {
+            /* A producer blocked on a full buffer can continue now */
+            if (priv->policy == UCA_RING_BUFFER_POLICY_BLOCK_PRODUCER)
+                wake_waiters (priv);
+
+            *index = read_index;
+            return TRUE;
+        }
+
+        /* The producer dropped this block in the meantime, try the next one */
+        if (pin && g_atomic_int_dec_and_test (&priv->pins[slot]))
+            wake_waiters (priv);
+    }
+}
+
+/**
+ * uca_ring_buffer_proceed:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Advance the read location past the oldest unread block without accessing
+ * it. Nothing happens if no data is available.
+ */
+void
+uca_ring_buffer_proceed (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+    gsize read_index;
+
+    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+    priv = buffer->priv;
+
+    claim_read_index (priv, &priv->read_index, FALSE, &read_index);
+}
+
+/**
+ * uca_ring_buffer_get_read_pointer:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get pointer to current read location. If no data is available, %NULL is
+ * returned.
+ *
+ * Return value: (transfer none): Pointer to current read location
+ */
+gpointer
+uca_ring_buffer_get_read_pointer (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+    gsize read_index;
+    gboolean ok;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    priv = buffer->priv;
+
+    ok = claim_read_index (priv, &priv->read_index, FALSE, &read_index);
+    g_return_val_if_fail (ok, NULL);
+    return block_pointer (priv, read_index);
+}
+
+/**
+ * uca_ring_buffer_borrow_read_pointer:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get pointer to current read location and advance. In contrast to
+ * uca_ring_buffer_get_read_pointer(), the block is not overwritten until it is
+ * given back with uca_ring_buffer_release_read_pointer().
+ *
+ * Return value: (transfer none): Pointer to borrowed block or %NULL if no data
+ * is available.
+ * Since: 2.4
+ */
+gpointer
+uca_ring_buffer_borrow_read_pointer (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+    gsize read_index;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    priv = buffer->priv;
+
+    if (!claim_read_index (priv, &priv->read_index, TRUE, &read_index))
+        return NULL;
+
+    return block_pointer (priv, read_index);
+}
+
+/*
+ * Like claim_read_index() but move cursor past the newest block instead,
+ * skipping all older unread blocks.
+ */
+static gboolean
+claim_newest_read_index (UcaRingBufferPrivate *priv, gsize *cursor, gsize *index, gsize *n_skipped)
+{
+    while (1) {
+        gsize read_index;
+        gsize newest;
+        guint slot;
+
+        read_index = get_index (cursor);
+        newest = get_index (&priv->write_index);
+
+        if (read_index >= newest)
+            return FALSE;
+
+        newest--;
+        slot = newest % priv->n_blocks_total;
+        g_atomic_int_inc (&priv->pins[slot]);
+
+        if (cas_index (cursor, read_index, newest + 1)) {
+            if (priv->policy == UCA_RING_BUFFER_POLICY_BLOCK_PRODUCER)
+                wake_waiters (priv);
+
+            *index = newest;
+            *n_skipped = newest - read_index;
+            return TRUE;
+        }
+
+        /* The producer dropped the oldest block in the meantime, try again */
+        if (g_atomic_int_dec_and_test (&priv->pins[slot]))
+            wake_waiters (priv);
+    }
+}
+
+/**
+ * uca_ring_buffer_borrow_newest_pointer:
+ * @buffer: A #UcaRingBuffer object
+ * @n_skipped: (out) (allow-none): Location to store the number of unread
+ *  blocks that were skipped or %NULL
+ *
+ * Like uca_ring_buffer_borrow_read_pointer() but borrow the most recently
+ * written block and advance past it. Older unread blocks are skipped and
+ * will not be read.
+ *
+ * Return value: (transfer none): Pointer to borrowed block or %NULL if no data
+ * is available.
+ * Since: 2.4
+ */
+gpointer
+uca_ring_buffer_borrow_newest_pointer (UcaRingBuffer *buffer,
+                                       guint64       *n_skipped)
+{
+    UcaRingBufferPrivate *priv;
+    gsize read_index;
+    gsize skipped;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    priv = buffer->priv;
+
+    if (n_skipped != NULL)
+        *n_skipped = 0;
+
+    if (!claim_newest_read_index (priv, &priv->read_index, &read_index, &skipped))
+        return NULL;
+
+    if (n_skipped != NULL)
+        *n_skipped = skipped;
+
+    return block_pointer (priv, read_index);
+}
+
+/**
+ * uca_ring_buffer_release_read_pointer:
+ * @buffer: A #UcaRingBuffer object
+ * @data: Pointer returned by uca_ring_buffer_borrow_read_pointer()
+ *
+ * Give a borrowed block back so that it can be overwritten again.
+ *
+ * Since: 2.4
+ */
+void
+uca_ring_buffer_release_read_pointer (UcaRingBuffer *buffer,
+                                      gpointer       data)
+{
+    UcaRingBufferPrivate *priv;
+    guint slot;
+    gboolean ok;
+
+    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+    priv = buffer->priv;
+
+    ok = block_slot (priv, data, &slot);
+    g_return_if_fail (ok);
+
+    if (g_atomic_int_dec_and_test (&priv->pins[slot]))
+        wake_waiters (priv);
+}
+
+static gboolean
+write_block_pinned (UcaRingBuffer *buffer, gpointer user_data)
+{
+    UcaRingBufferPrivate *priv;
+
+    priv = buffer->priv;
+    return g_atomic_int_get (&priv->pins[get_index (&priv->stage_index) % priv->n_blocks_total]) > 0;
+}
+
+static void drop_oldest (UcaRingBufferPrivate *priv);
+
+static gboolean
+write_block_free (UcaRingBuffer *buffer, gpointer user_data)
+{
+    UcaRingBufferPrivate *priv;
+
+    priv = buffer->priv;
+
+    /* Committing staged blocks may have made more blocks droppable */
+    if (priv->policy == UCA_RING_BUFFER_POLICY_OVERWRITE_OLDEST)
+        drop_oldest (priv);
+
+    /* Only staged blocks remain, which must not be overwritten either */
+    if (is_full (priv))
+        return FALSE;
+
+    return !write_block_pinned (buffer, NULL);
+}
+
+/*
+ * Move cursor past the oldest block if the producer is about to overwrite it.
+ * Blocks that are staged but not yet committed cannot be dropped. Returns TRUE
+ * if a block was dropped.
+ */
+static gboolean
+drop_oldest_for (UcaRingBufferPrivate *priv, gsize *cursor, gsize stage_index, gsize write_index)
+{
+    gsize read_index;
+
+    do {
+        read_index = get_index (cursor);
+
+        if (stage_index - read_index < priv->n_blocks_total || read_index >= write_index)
+            return FALSE;
+    } while (!cas_index (cursor, read_index, read_index + 1));
+
+    return TRUE;
+}
+
+static void
+drop_oldest (UcaRingBufferPrivate *priv)
+{
+    gsize stage_index;
+    gsize write_index;
+    gboolean dropped;
+    gint n_readers;
+
+    stage_index = get_index (&priv->stage_index);
+    write_index = get_index (&priv->write_index);
+    dropped = drop_oldest_for (priv, &priv->read_index, stage_index, write_index);
+    n_readers = g_atomic_int_get (&priv->n_readers);
+
+    for (gint i = 0; i < n_readers; i++) {
+        UcaRingBufferReader *reader = &priv->readers[i];
+
+        if (!g_atomic_int_get (&reader->active) || reader->mode != UCA_RING_BUFFER_READER_LOSSLESS)
+            continue;
+
+        if (drop_oldest_for (priv, &reader->cursor, stage_index, write_index)) {
+            g_atomic_pointer_add (&reader->drops, 1);
+            dropped = TRUE;
+        }
+    }
+
+    if (dropped)
+        g_atomic_pointer_add (&priv->overruns, 1);
+}
+
+/**
+ * uca_ring_buffer_wait_writable:
+ * @buffer: A #UcaRingBuffer object
+ * @timeout_us: Maximum time to wait in microseconds, 0 to return immediately
+ *  or a negative value to wait indefinitely
+ *
+ * Prepare the current write location for a producer that runs concurrently to
+ * a consumer. What happens if the buffer is full depends on the
+ * #UcaRingBuffer:policy. If the block at the write location is still
+ * borrowed, wait until it is released.
+ *
+ * Return value: %TRUE if the write location can be written, %FALSE if the
+ * timeout elapsed.
+ * Since: 2.4
+ */
+gboolean
+uca_ring_buffer_wait_writable (UcaRingBuffer *buffer,
+                               gint64         timeout_us)
+{
+    UcaRingBufferPrivate *priv;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    priv = buffer->priv;
+    priv->dropping = FALSE;
+
+    switch (priv->policy) {
+        case UCA_RING_BUFFER_POLICY_OVERWRITE_OLDEST:
+            drop_oldest (priv);
+            break;
+
+        case UCA_RING_BUFFER_POLICY_DROP_NEWEST:
+            if (is_full (priv)) {
+                /* Let the producer write somewhere and discard it afterwards */
+                if (priv->scratch == NULL)
+                    priv->scratch = g_malloc (priv->block_size);
+
+                priv->dropping = TRUE;
+                return TRUE;
+            }
+            break;
+
+        case UCA_RING_BUFFER_POLICY_BLOCK_PRODUCER:
+            break;
+    }
+
+    if (write_block_free (buffer, NULL))
+        return TRUE;
+
+    if (timeout_us == 0)
+        return FALSE;
+
+    return wait_until (buffer, write_block_free, NULL,
+                       timeout_us > 0 ? g_get_monotonic_time () + timeout_us : -1);
+}
+
+/**
+ * uca_ring_buffer_get_write_pointer:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get pointer to current write location.
+ *
+ * Return value: (transfer none): Pointer to current write location
+ */
+gpointer
+uca_ring_buffer_get_write_pointer (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+    gpointer data;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+
+    priv = buffer->priv;
+
+    if (priv->dropping)
+        return priv->scratch;
+
+    data = block_pointer (priv, get_index (&priv->stage_index));
+
+    return data;
+}
+
+/**
+ * uca_ring_buffer_write_advance:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Publish the block at the current write location to the consumer and wake it
+ * up if it is waiting in uca_ring_buffer_wait_readable(). If the block holds
+ * a frame that was never read, it is counted as an overrun.
+ */
+void
+uca_ring_buffer_write_advance (UcaRingBuffer *buffer)
+{
+    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+
+    if (uca_ring_buffer_write_stage (buffer))
+        uca_ring_buffer_commit (buffer);
+}
+
+/**
+ * uca_ring_buffer_write_stage:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Move the write location past the block that was just written without
+ * publishing it. Staged blocks stay invisible to readers and are not
+ * overwritten until they are published in the order they were staged with
+ * uca_ring_buffer_commit(). This lets other threads process a block in place
+ * while the producer writes the next ones.
+ *
+ * Return value: %TRUE if the block was staged, %FALSE if it was dropped
+ * because of #UCA_RING_BUFFER_POLICY_DROP_NEWEST and must not be committed.
+ * Since: 2.4
+ */
+gboolean
+uca_ring_buffer_write_stage (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+    gsize stage_index;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    priv = buffer->priv;
+
+    if (priv->dropping) {
+        priv->dropping = FALSE;
+        priv->n_produced++;
+        g_atomic_pointer_add (&priv->overruns, 1);
+        return FALSE;
+    }
+
+    stage_index = get_index (&priv->stage_index);
+
+    if (is_full (priv))
+        g_atomic_pointer_add (&priv->overruns, 1);
+
+    priv->metadata[stage_index % priv->n_blocks_total].sequence = priv->n_produced++;
+    set_index (&priv->stage_index, stage_index + 1);
+    return TRUE;
+}
+
+/**
+ * uca_ring_buffer_commit:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Publish the oldest block staged with uca_ring_buffer_write_stage() and wake
+ * up a consumer waiting in uca_ring_buffer_wait_readable(). Calls must be
+ * serialized but may come from another thread than the producer.
+ *
+ * Since: 2.4
+ */
+void
+uca_ring_buffer_commit (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+    gsize write_index;
+    gsize fill;
+
+    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+    priv = buffer->priv;
+
+    write_index = get_index (&priv->write_index);
+    g_return_if_fail (write_index < get_index (&priv->stage_index));
+
+    /* The atomic increment is a full barrier, block data is visible before */
+    g_atomic_pointer_add (&priv->write_index, 1);
+    wake_waiters (priv);
+
+    fill = MIN (write_index + 1 - slowest_cursor (priv), priv->n_blocks_total);
+
+    if (fill > (guint) g_atomic_int_get (&priv->max_fill))
+        g_atomic_int_set (&priv->max_fill, (guint) fill);
+}
+
+/**
+ * uca_ring_buffer_add_reader:
+ * @buffer: A #UcaRingBuffer object
+ * @mode: Whether the reader may lose frames
+ *
+ * Add a reader with its own read position that starts at the next block
+ * written. The producer only drops or waits for frames with respect to the
+ * slowest #UCA_RING_BUFFER_READER_LOSSLESS reader and the read position used
+ * by uca_ring_buffer_borrow_read_pointer(). #UCA_RING_BUFFER_READER_LOSSY
+ * readers always get the newest frame and skip the others.
+ *
+ * Blocks are borrowed with uca_ring_buffer_reader_borrow() and given back with
+ * uca_ring_buffer_release_read_pointer().
+ *
+ * Return value: (transfer none): A reader handle or %NULL if too many readers
+ * were added.
+ * Since: 2.4
+ */
+UcaRingBufferReader *
+uca_ring_buffer_add_reader (UcaRingBuffer          *buffer,
+                            UcaRingBufferReaderMode mode)
+{
+    UcaRingBufferPrivate *priv;
+    UcaRingBufferReader *reader = NULL;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    priv = buffer->priv;
+
+    g_mutex_lock (&priv->wait_mutex);
+
+    for (gint i = 0; i < MAX_READERS; i++) {
+        if (g_atomic_int_get (&priv->readers[i].active))
+            continue;
+
+        reader = &priv->readers[i];
+        reader->mode = mode;
+        reader->spin_count = MIN_SPIN_COUNT;
+        set_index (&reader->drops, 0);
+        set_index (&reader->cursor, get_index (&priv->write_index));
+        g_atomic_int_set (&reader->active, TRUE);
+
+        if (i >= g_atomic_int_get (&priv->n_readers))
+            g_atomic_int_set (&priv->n_readers, i + 1);
+
+        break;
+    }
+
+    g_mutex_unlock (&priv->wait_mutex);
+
+    if (reader == NULL)
+        g_warning ("Cannot add more than %i readers", MAX_READERS);
+
+    return reader;
+}
+
+/**
+ * uca_ring_buffer_remove_reader:
+ * @buffer: A #UcaRingBuffer object
+ * @reader: A reader returned by uca_ring_buffer_add_reader()
+ *
+ * Remove @reader. Blocks it borrowed must be released before.
+ *
+ * Since: 2.4
+ */
+void
+uca_ring_buffer_remove_reader (UcaRingBuffer       *buffer,
+                               UcaRingBufferReader *reader)
+{
+    UcaRingBufferPrivate *priv;
+
+    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+    g_return_if_fail (reader != NULL);
+    priv = buffer->priv;
+
+    g_mutex_lock (&priv->wait_mutex);
+    g_atomic_int_set (&reader->active, FALSE);
+    g_mutex_unlock (&priv->wait_mutex);
+
+    /* A producer waiting for this reader can continue */
+    wake_waiters (priv);
+}
+
+/**
+ * uca_ring_buffer_reader_wait_readable:
+ * @buffer: A #UcaRingBuffer object
+ * @reader: A reader returned by uca_ring_buffer_add_reader()
+ * @timeout_us: Maximum time to wait in microseconds, 0 to return immediately
+ *  or a negative value to wait indefinitely
+ *
+ * Like uca_ring_buffer_wait_readable() but for @reader.
+ *
+ * Return value: %TRUE if data is available, %FALSE if the timeout elapsed.
+ * Since: 2.4
+ */
+gboolean
+uca_ring_buffer_reader_wait_readable (UcaRingBuffer       *buffer,
+                                      UcaRingBufferReader *reader,
+                                      gint64               timeout_us)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    g_return_val_if_fail (reader != NULL, FALSE);
+
+    return spin_then_wait (buffer, &reader->spin_count, cursor_readable,
+                           (gpointer) &reader->cursor, timeout_us);
+}
+
+/*
+ * Pin the newest block for a lossy reader. The producer checks the pin before
+ * it writes index + n_blocks_total into the same block, so the block is safe
+ * if write_index did not reach that far after pinning.
+ */
+static gboolean
+claim_newest_index (UcaRingBufferPrivate *priv, UcaRingBufferReader *reader, gsize *index)
+{
+    while (1) {
+        gsize write_index;
+        gsize cursor;
+        gsize newest;
+        guint slot;
+
+        write_index = get_index (&priv->write_index);
+        cursor = get_index (&reader->cursor);
+
+        if (cursor >= write_index)
+            return FALSE;
+
+        newest = write_index - 1;
+        slot = newest % priv->n_blocks_total;
+        g_atomic_int_inc (&priv->pins[slot]);
+
+        if (get_index (&priv->write_index) < newest + priv->n_blocks_total) {
+            g_atomic_pointer_add (&reader->drops, newest - cursor);
+            set_index (&reader->cursor, newest + 1);
+            *index = newest;
+            return TRUE;
+        }
+
+        if (g_atomic_int_dec_and_test (&priv->pins[slot]))
+            wake_waiters (priv);
+    }
+}
+
+/**
+ * uca_ring_buffer_reader_borrow:
+ * @buffer: A #UcaRingBuffer object
+ * @reader: A reader returned by uca_ring_buffer_add_reader()
+ *
+ * Borrow the next block for @reader, which is the oldest unread block for
+ * lossless and the newest block for lossy readers. The block must be given
+ * back with uca_ring_buffer_release_read_pointer().
+ *
+ * Return value: (transfer none): Pointer to borrowed block or %NULL if no data
+ * is available.
+ * Since: 2.4
+ */
+gpointer
+uca_ring_buffer_reader_borrow (UcaRingBuffer       *buffer,
+                               UcaRingBufferReader *reader)
+{
+    UcaRingBufferPrivate *priv;
+    gboolean claimed;
+    gsize index;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    g_return_val_if_fail (reader != NULL, NULL);
+    priv = buffer->priv;
+
+    if (reader->mode == UCA_RING_BUFFER_READER_LOSSY)
+        claimed = claim_newest_index (priv, reader, &index);
+    else
+        claimed = claim_read_index (priv, &reader->cursor, TRUE, &index);
 
-static GParamSpec *properties[N_PROPERTIES] = { NULL, };
+    return claimed ? block_pointer (priv, index) : NULL;
+}
 
-UcaRingBuffer *
-uca_ring_buffer_new (gsize block_size,
-                     guint n_blocks)
+/**
+ * uca_ring_buffer_reader_get_lag:
+ * @buffer: A #UcaRingBuffer object
+ * @reader: A reader returned by uca_ring_buffer_add_reader()
+ *
+ * Return value: Number of blocks written that @reader has not read yet.
+ * Since: 2.4
+ */
+guint64
+uca_ring_buffer_reader_get_lag (UcaRingBuffer       *buffer,
+                                UcaRingBufferReader *reader)
 {
-    UcaRingBuffer *buffer;
+    gsize write_index;
+    gsize cursor;
 
-    buffer = g_object_new (UCA_TYPE_RING_BUFFER,
-                           "block-size", (guint64) block_size,
-                           "num-blocks", n_blocks,
-                           NULL);
-    return buffer;
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
+    g_return_val_if_fail (reader != NULL, 0);
+
+    write_index = get_index (&buffer->priv->write_index);
+    cursor = get_index (&reader->cursor);
+    return cursor < write_index ? (guint64) (write_index - cursor) : 0;
 }
 
-void
-uca_ring_buffer_reset (UcaRingBuffer *buffer)
+/**
+ * uca_ring_buffer_reader_get_drops:
+ * @buffer: A #UcaRingBuffer object
+ * @reader: A reader returned by uca_ring_buffer_add_reader()
+ *
+ * Return value: Number of blocks @reader missed because they were
+ * overwritten or, for lossy readers, skipped.
+ * Since: 2.4
+ */
+guint64
+uca_ring_buffer_reader_get_drops (UcaRingBuffer       *buffer,
+                                  UcaRingBufferReader *reader)
 {
-    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
-
-    buffer->priv->write_index = 0;
-    buffer->priv->read_index = 0;
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
+    g_return_val_if_fail (reader != NULL, 0);
+    return (guint64) get_index (&reader->drops);
 }
 
-gsize
-uca_ring_buffer_get_block_size (UcaRingBuffer *buffer)
+/**
+ * uca_ring_buffer_get_sequence:
+ * @buffer: A #UcaRingBuffer object
+ * @data: Pointer to a block of @buffer
+ *
+ * Get the sequence number of the frame stored in the block at @data. Sequence
+ * numbers count every frame the producer wrote, including those that were
+ * dropped, so a gap between two consecutively read frames means data loss.
+ *
+ * Return value: Sequence number of the frame at @data
+ * Since: 2.4
+ */
+guint64
+uca_ring_buffer_get_sequence (UcaRingBuffer *buffer,
+                              gpointer       data)
 {
+    UcaRingBufferPrivate *priv;
+    guint slot;
+    gboolean ok;
+
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
-    return buffer->priv->block_size;
+    priv = buffer->priv;
+
+    ok = block_slot (priv, data, &slot);
+    g_return_val_if_fail (ok, 0);
+    return priv->metadata[slot].sequence;
 }
 
-gboolean
-uca_ring_buffer_available (UcaRingBuffer *buffer)
+/**
+ * uca_ring_buffer_get_metadata:
+ * @buffer: A #UcaRingBuffer object
+ * @index: Block index of queried metadata
+ *
+ * Get the metadata of the block identified by @index, counted in the same way
+ * as for uca_ring_buffer_get_pointer().
+ *
+ * Return value: (transfer none): Metadata of indexed block
+ * Since: 2.4
+ */
+const UcaRingBufferMetadata *
+uca_ring_buffer_get_metadata (UcaRingBuffer *buffer,
+                              guint          index)
 {
-    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
-    return buffer->priv->read_index < buffer->priv->write_index;
+    UcaRingBufferPrivate *priv;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    priv = buffer->priv;
+    return &priv->metadata[(get_index (&priv->read_index) + index) % priv->n_blocks_total];
 }
 
 /**
- * uca_ring_buffer_get_read_pointer:
+ * uca_ring_buffer_get_pointer_metadata:
  * @buffer: A #UcaRingBuffer object
+ * @data: Pointer to a block of @buffer
  *
- * Get pointer to current read location. If no data is available, %NULL is
- * returned.
+ * Get the metadata of the block at @data, for example a block borrowed with
+ * uca_ring_buffer_borrow_read_pointer().
  *
- * Return value: (transfer none): Pointer to current read location
+ * Return value: (transfer none): Metadata of the block at @data
+ * Since: 2.4
  */
-gpointer
-uca_ring_buffer_get_read_pointer (UcaRingBuffer *buffer)
+const UcaRingBufferMetadata *
+uca_ring_buffer_get_pointer_metadata (UcaRingBuffer *buffer,
+                                      gpointer       data)
 {
     UcaRingBufferPrivate *priv;
-    gpointer data;
+    guint slot;
+    gboolean ok;
 
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
     priv = buffer->priv;
 
-    g_return_val_if_fail (priv->read_index != priv->write_index, NULL);
-    data = priv->data + (priv->read_index % priv->n_blocks_total) * priv->block_size;
-    priv->read_index++;
-    return data;
+    ok = block_slot (priv, data, &slot);
+    g_return_val_if_fail (ok, NULL);
+    return &priv->metadata[slot];
 }
 
 /**
- * uca_ring_buffer_get_write_pointer:
+ * uca_ring_buffer_get_write_metadata:
  * @buffer: A #UcaRingBuffer object
  *
- * Get pointer to current write location.
+ * Get the metadata record that belongs to the current write location. The
+ * producer fills it before calling uca_ring_buffer_write_advance(), which
+ * sets the sequence number.
  *
- * Return value: (transfer none): Pointer to current write location
+ * Return value: (transfer none): Metadata of current write location
+ * Since: 2.4
  */
-gpointer
-uca_ring_buffer_get_write_pointer (UcaRingBuffer *buffer)
+UcaRingBufferMetadata *
+uca_ring_buffer_get_write_metadata (UcaRingBuffer *buffer)
 {
     UcaRingBufferPrivate *priv;
-    gpointer data;
 
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
-
     priv = buffer->priv;
-    data = priv->data + (priv->write_index % priv->n_blocks_total) * priv->block_size;
 
-    return data;
+    if (priv->dropping)
+        return &priv->scratch_metadata;
+
+    return &priv->metadata[get_index (&priv->stage_index) % priv->n_blocks_total];
 }
 
-void
-uca_ring_buffer_write_advance (UcaRingBuffer *buffer)
+/**
+ * uca_ring_buffer_get_overruns:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get the number of frames that were lost since the last reset, either because
+ * they were overwritten before being read or because they were dropped.
+ *
+ * Return value: Number of lost frames
+ * Since: 2.4
+ */
+guint64
+uca_ring_buffer_get_overruns (UcaRingBuffer *buffer)
 {
-    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
-    buffer->priv->write_index++;
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
+    return (guint64) get_index (&buffer->priv->overruns);
+}
+
+/**
+ * uca_ring_buffer_get_max_fill:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get the highest number of unread blocks since the last reset.
+ *
+ * Return value: High-water mark of the queue depth
+ * Since: 2.4
+ */
+guint
+uca_ring_buffer_get_max_fill (UcaRingBuffer *buffer)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
+    return (guint) g_atomic_int_get (&buffer->priv->max_fill);
 }
 
 /**
@@ -144,7 +1331,7 @@ uca_ring_buffer_peek_pointer (UcaRingBuffer *buffer)
     UcaRingBufferPrivate *priv;
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
     priv = buffer->priv;
-    return ((guint8 *) priv->data) + ((priv->write_index % priv->n_blocks_total) * priv->block_size);
+    return ((guint8 *) priv->data) + ((get_index (&priv->stage_index) % priv->n_blocks_total) * priv->block_size);
 }
 
 /**
@@ -163,26 +1350,334 @@ uca_ring_buffer_get_pointer (UcaRingBuffer *buffer,
     UcaRingBufferPrivate *priv;
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
     priv = buffer->priv;
-    return ((guint8 *) priv->data) + (((priv->read_index + index) % priv->n_blocks_total) * priv->block_size);
+    return ((guint8 *) priv->data) + (((get_index (&priv->read_index) + index) % priv->n_blocks_total) * priv->block_size);
+}
+
+/**
+ * uca_ring_buffer_get_stored_pointer:
+ * @buffer: A #UcaRingBuffer object
+ * @index: Index of a stored block, 0 is the oldest
+ *
+ * Get pointer to one of the blocks still held by @buffer independent of any
+ * read position. @index must be smaller than
+ * uca_ring_buffer_get_num_blocks(), the highest index is the newest block.
+ *
+ * Return value: (transfer none): Pointer to the stored block
+ * Since: 2.4
+ */
+gpointer
+uca_ring_buffer_get_stored_pointer (UcaRingBuffer *buffer,
+                                    guint          index)
+{
+    UcaRingBufferPrivate *priv;
+    gsize write_index;
+    gsize n_stored;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    priv = buffer->priv;
+    write_index = get_index (&priv->write_index);
+    n_stored = MIN (write_index, priv->n_blocks_total);
+
+    g_return_val_if_fail (index < n_stored, NULL);
+    return block_pointer (priv, write_index - n_stored + index);
 }
 
 guint
 uca_ring_buffer_get_num_blocks (UcaRingBuffer *buffer)
 {
     UcaRingBufferPrivate *priv;
+    gsize write_index;
 
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
     priv = buffer->priv;
-    return priv->write_index < priv->n_blocks_total ? priv->write_index : priv->n_blocks_total;
+    write_index = get_index (&priv->write_index);
+    return write_index < priv->n_blocks_total ? (guint) write_index : priv->n_blocks_total;
+}
+
+static gsize
+get_page_size (void)
+{
+#ifdef G_OS_UNIX
+    return (gsize) sysconf (_SC_PAGESIZE);
+#else
+    return 4096;
+#endif
+}
+
+/**
+ * uca_ring_buffer_alignment_is_valid:
+ * @alignment: Alignment in bytes
+ *
+ * Check if @alignment can be used for #UcaRingBuffer:alignment. Block memory
+ * is mapped and trimmed in whole pages, so the alignment must be 0 or a power
+ * of two that is at least the page size.
+ *
+ * Return value: %TRUE if @alignment is valid.
+ * Since: 2.4
+ */
+gboolean
+uca_ring_buffer_alignment_is_valid (gsize alignment)
+{
+    if (alignment == 0)
+        return TRUE;
+
+    return (alignment & (alignment - 1)) == 0 && alignment >= get_page_size ();
+}
+
+#ifdef G_OS_UNIX
+/*
+ * Read the default huge page size from the Hugepagesize line of /proc/meminfo,
+ * which is 2 MiB on x86-64 but for example 512 MiB on arm64 with 64 KiB base
+ * pages. The value is looked up once and cached.
+ */
+static gsize
+get_huge_page_size (void)
+{
+    static gsize huge_page_size = 0;
+
+    if (g_once_init_enter (&huge_page_size)) {
+        gsize size = DEFAULT_HUGE_PAGE_SIZE;
+        gchar *contents;
+
+        if (g_file_get_contents ("/proc/meminfo", &contents, NULL, NULL)) {
+            const gchar *line;
+
+            line = strstr (contents, "Hugepagesize:");
+
+            if (line != NULL) {
+                guint64 kib;
+
+                kib = g_ascii_strtoull (line + strlen ("Hugepagesize:"), NULL, 10);
+
+                /* Only power-of-two sizes can be used as an alignment */
+                if (kib > 0 && (kib & (kib - 1)) == 0)
+                    size = (gsize) kib * 1024;
+            }
+
+            g_free (contents);
+        }
+
+        g_once_init_leave (&huge_page_size, size);
+    }
+
+    return huge_page_size;
+}
+
+static gsize
+round_up (gsize value, gsize multiple)
+{
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+/*
+ * Map anonymous memory for the blocks. Apart from being naturally page-aligned,
+ * anonymous mappings are zeroed lazily by the kernel, so unlike g_malloc0 we
+ * do not pay for touching every page up front.
+ */
+static gboolean
+map_blocks (UcaRingBufferPrivate *priv, gsize size)
+{
+    const gint prot = PROT_READ | PROT_WRITE;
+    const gint flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    gsize page_size;
+    gsize alignment;
+    gsize map_size;
+    gsize head;
+    guchar *base;
+    guchar *aligned;
+
+    /* The alignment is a multiple of the page size, trimming keeps whole pages */
+    page_size = get_page_size ();
+    alignment = MAX (priv->alignment, page_size);
+
+    if (priv->alloc_flags & (UCA_RING_BUFFER_ALLOC_HUGE_PAGES | UCA_RING_BUFFER_ALLOC_HUGETLB)) {
+        gsize huge_page_size = get_huge_page_size ();
+
+        alignment = MAX (alignment, huge_page_size);
+        size = round_up (size, huge_page_size);
+    }
+    else {
+        size = round_up (size, page_size);
+    }
+
+#ifdef MAP_HUGETLB
+    if (priv->alloc_flags & UCA_RING_BUFFER_ALLOC_HUGETLB) {
+        base = mmap (NULL, size, prot, flags | MAP_HUGETLB, -1, 0);
+
+        if (base != MAP_FAILED && ((guintptr) base % alignment) == 0) {
+            priv->data = base;
+            priv->mapped_size = size;
+            return TRUE;
+        }
+
+        if (base != MAP_FAILED)
+            munmap (base, size);
+
+        g_warning ("Could not map %" G_GSIZE_FORMAT " bytes of huge pages, using regular pages", size);
+    }
+#endif
+
+    /* Over-allocate and trim so that the start is aligned as requested */
+    map_size = size + alignment - page_size;
+    base = mmap (NULL, map_size, prot, flags, -1, 0);
+
+    if (base == MAP_FAILED)
+        return FALSE;
+
+    aligned = (guchar *) round_up ((guintptr) base, alignment);
+    head = (gsize) (aligned - base);
+
+    if (head > 0)
+        munmap (base, head);
+
+    if (map_size - head > size)
+        munmap (aligned + size, map_size - head - size);
+
+    priv->data = aligned;
+    priv->mapped_size = size;
+
+#ifdef MADV_HUGEPAGE
+    if (priv->alloc_flags & UCA_RING_BUFFER_ALLOC_HUGE_PAGES)
+        madvise (priv->data, size, MADV_HUGEPAGE);
+#endif
+
+    return TRUE;
+}
+
+static void
+bind_to_numa_node (UcaRingBufferPrivate *priv)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    unsigned long mask[4] = { 0, };
+    const gsize bits_per_long = sizeof (unsigned long) * 8;
+    const gsize max_node = G_N_ELEMENTS (mask) * bits_per_long;
+
+    if ((gsize) priv->numa_node >= max_node) {
+        g_warning ("NUMA node %i out of range", priv->numa_node);
+        return;
+    }
+
+    mask[priv->numa_node / bits_per_long] = 1UL << (priv->numa_node % bits_per_long);
+
+    /* Pages are not faulted in yet, so they will all be placed on the node */
+    if (syscall (SYS_mbind, priv->data, priv->mapped_size, MPOL_BIND, mask, max_node + 1, 0) != 0)
+        g_warning ("Could not bind ring buffer to NUMA node %i: %s", priv->numa_node, g_strerror (errno));
+#else
+    g_warning ("Binding memory to a NUMA node is not supported on this platform");
+#endif
+}
+
+static void
+prefault_range (guchar *data, gsize size, gboolean lock)
+{
+    gsize page_size;
+
+    if (lock) {
+        /* mlock faults in all pages as a side effect */
+        if (mlock (data, size) != 0)
+            g_warning ("Could not lock ring buffer memory: %s", g_strerror (errno));
+
+        return;
+    }
+
+#ifdef __linux__
+    if (madvise (data, size, MADV_POPULATE_WRITE) == 0)
+        return;
+#endif
+
+    /*
+     * Fall back to touching one word per page. The atomic no-op add makes the
+     * write fault harmless even if a producer already writes into the page.
+     */
+    page_size = get_page_size ();
+
+    for (gsize offset = 0; offset < size; offset += page_size)
+        g_atomic_int_add ((volatile gint *) (data + offset), 0);
+}
+
+static gpointer
+prefault_thread (UcaRingBufferPrivate *priv)
+{
+    gboolean lock;
+
+    lock = (priv->alloc_flags & UCA_RING_BUFFER_ALLOC_LOCK) != 0;
+
+    for (gsize offset = 0; offset < priv->mapped_size; offset += PREFAULT_CHUNK_SIZE) {
+        if (g_atomic_int_get (&priv->prefault_cancelled))
+            break;
+
+        prefault_range (priv->data + offset, MIN (PREFAULT_CHUNK_SIZE, priv->mapped_size - offset), lock);
+    }
+
+    return NULL;
+}
+#endif
+
+static void
+free_mem (UcaRingBufferPrivate *priv)
+{
+    if (priv->prefault_thread != NULL) {
+        g_atomic_int_set (&priv->prefault_cancelled, 1);
+        g_thread_join (priv->prefault_thread);
+        priv->prefault_thread = NULL;
+    }
+
+#ifdef G_OS_UNIX
+    if (priv->mapped_size > 0) {
+        munmap (priv->data, priv->mapped_size);
+        priv->mapped_size = 0;
+        priv->data = NULL;
+    }
+#endif
+
+    g_free (priv->data);
+    g_free ((gpointer) priv->pins);
+    g_free (priv->metadata);
+    g_free (priv->scratch);
+    priv->data = NULL;
+    priv->pins = NULL;
+    priv->metadata = NULL;
+    priv->scratch = NULL;
 }
 
 static void
 realloc_mem (UcaRingBufferPrivate *priv)
 {
-    if (priv->data != NULL)
-        g_free (priv->data);
+    gsize size;
+
+    free_mem (priv);
+
+    reset_state (priv);
+    priv->pins = g_new0 (gint, priv->n_blocks_total);
+    priv->metadata = g_new0 (UcaRingBufferMetadata, priv->n_blocks_total);
+    size = priv->n_blocks_total * priv->block_size;
+
+    if (size == 0)
+        return;
+
+#ifdef G_OS_UNIX
+    if (map_blocks (priv, size)) {
+        if (priv->numa_node >= 0)
+            bind_to_numa_node (priv);
 
-    priv->data = g_malloc0_n (priv->n_blocks_total, priv->block_size);
+        if (priv->alloc_flags & UCA_RING_BUFFER_ALLOC_PREFAULT_BACKGROUND) {
+            g_atomic_int_set (&priv->prefault_cancelled, 0);
+            priv->prefault_thread = g_thread_new ("ring-buffer-prefault",
+                                                  (GThreadFunc) prefault_thread, priv);
+        }
+        else if (priv->alloc_flags & (UCA_RING_BUFFER_ALLOC_PREFAULT | UCA_RING_BUFFER_ALLOC_LOCK)) {
+            prefault_range (priv->data, priv->mapped_size,
+                            (priv->alloc_flags & UCA_RING_BUFFER_ALLOC_LOCK) != 0);
+        }
+
+        return;
+    }
+
+    g_warning ("Could not map ring buffer memory: %s", g_strerror (errno));
+#endif
+
+    /* Blocks are always written before they are read, no need to clear them */
+    priv->data = g_malloc_n (priv->n_blocks_total, priv->block_size);
 }
 
 static void
@@ -205,12 +1700,43 @@ uca_ring_buffer_get_property (GObject *object,
             g_value_set_uint (value, priv->n_blocks_total);
             break;
 
+        case PROP_ALLOC_FLAGS:
+            g_value_set_flags (value, priv->alloc_flags);
+            break;
+
+        case PROP_ALIGNMENT:
+            g_value_set_uint (value, (guint) priv->alignment);
+            break;
+
+        case PROP_NUMA_NODE:
+            g_value_set_int (value, priv->numa_node);
+            break;
+
+        case PROP_POLICY:
+            g_value_set_enum (value, priv->policy);
+            break;
+
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
             break;
     }
 }
 
+/*
+ * Memory cannot be reallocated under borrowed blocks. Before construction
+ * nothing is allocated yet.
+ */
+static gboolean
+can_realloc (UcaRingBufferPrivate *priv, GParamSpec *pspec)
+{
+    if (priv->constructed && count_borrowed (priv) > 0) {
+        g_warning ("Cannot change ::%s while blocks are borrowed", pspec->name);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 static void
 uca_ring_buffer_set_property (GObject *object,
                               guint property_id,
@@ -224,19 +1750,91 @@ uca_ring_buffer_set_property (GObject *object,
 
     switch (property_id) {
         case PROP_BLOCK_SIZE:
-            priv->block_size = (gsize) g_value_get_uint64 (value);
-            realloc_mem (priv);
+            {
+                gsize block_size = (gsize) g_value_get_uint64 (value);
+
+                if (block_size == priv->block_size || !can_realloc (priv, pspec))
+                    return;
+
+                priv->block_size = block_size;
+            }
             break;
 
         case PROP_NUM_BLOCKS:
-            priv->n_blocks_total = g_value_get_uint (value);
-            realloc_mem (priv);
+            {
+                guint n_blocks = g_value_get_uint (value);
+
+                if (n_blocks == priv->n_blocks_total || !can_realloc (priv, pspec))
+                    return;
+
+                priv->n_blocks_total = n_blocks;
+            }
+            break;
+
+        case PROP_ALLOC_FLAGS:
+            {
+                guint alloc_flags = g_value_get_flags (value);
+
+                if (alloc_flags == priv->alloc_flags || !can_realloc (priv, pspec))
+                    return;
+
+                priv->alloc_flags = alloc_flags;
+            }
+            break;
+
+        case PROP_ALIGNMENT:
+            {
+                gsize alignment = (gsize) g_value_get_uint (value);
+
+                if (!uca_ring_buffer_alignment_is_valid (alignment)) {
+                    g_warning ("Alignment of %" G_GSIZE_FORMAT " bytes is not a power of two "
+                               "of at least the page size", alignment);
+                    return;
+                }
+
+                if (alignment == priv->alignment || !can_realloc (priv, pspec))
+                    return;
+
+                priv->alignment = alignment;
+            }
+            break;
+
+        case PROP_NUMA_NODE:
+            {
+                gint numa_node = g_value_get_int (value);
+
+                if (numa_node == priv->numa_node || !can_realloc (priv, pspec))
+                    return;
+
+                priv->numa_node = numa_node;
+            }
             break;
 
+        case PROP_POLICY:
+            /* Does not affect the memory layout */
+            priv->policy = g_value_get_enum (value);
+            return;
+
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
-            break;
+            return;
     }
+
+    /* Allocate once all construct properties are known */
+    if (priv->constructed)
+        realloc_mem (priv);
+}
+
+static void
+uca_ring_buffer_constructed (GObject *object)
+{
+    UcaRingBufferPrivate *priv;
+
+    priv = UCA_RING_BUFFER_GET_PRIVATE (object);
+    priv->constructed = TRUE;
+    realloc_mem (priv);
+
+    G_OBJECT_CLASS (uca_ring_buffer_parent_class)->constructed (object);
 }
 
 static void
@@ -251,8 +1849,9 @@ uca_ring_buffer_finalize (GObject *object)
     UcaRingBufferPrivate *priv;
 
     priv = UCA_RING_BUFFER_GET_PRIVATE (object);
-    g_free (priv->data);
-    priv->data = NULL;
+    free_mem (priv);
+    g_mutex_clear (&priv->wait_mutex);
+    g_cond_clear (&priv->wait_cond);
     G_OBJECT_CLASS (uca_ring_buffer_parent_class)->finalize (object);
 }
 
@@ -265,6 +1864,7 @@ uca_ring_buffer_class_init (UcaRingBufferClass *klass)
 
     oclass->get_property = uca_ring_buffer_get_property;
     oclass->set_property = uca_ring_buffer_set_property;
+    oclass->constructed = uca_ring_buffer_constructed;
     oclass->dispose = uca_ring_buffer_dispose;
     oclass->finalize = uca_ring_buffer_finalize;
 
@@ -282,6 +1882,34 @@ uca_ring_buffer_class_init (UcaRingBufferClass *klass)
                            0, G_MAXUINT, 0,
                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
 
+    properties[PROP_ALLOC_FLAGS] =
+        g_param_spec_flags ("alloc-flags",
+                            "Allocation policy",
+                            "How block memory is allocated and faulted in",
+                            UCA_TYPE_RING_BUFFER_ALLOC_FLAGS, UCA_RING_BUFFER_ALLOC_DEFAULT,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+
+    properties[PROP_ALIGNMENT] =
+        g_param_spec_uint ("alignment",
+                           "Alignment of block memory in bytes",
+                           "Alignment of block memory in bytes, a power of two of at least the page size or 0 to align to pages",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+
+    properties[PROP_NUMA_NODE] =
+        g_param_spec_int ("numa-node",
+                          "NUMA node",
+                          "NUMA node to bind block memory to, -1 for no binding",
+                          -1, G_MAXINT, -1,
+                          G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+
+    properties[PROP_POLICY] =
+        g_param_spec_enum ("policy",
+                           "Policy if the buffer is full",
+                           "Policy if the buffer is full",
+                           UCA_TYPE_RING_BUFFER_POLICY, UCA_RING_BUFFER_POLICY_OVERWRITE_OLDEST,
+                           G_PARAM_READWRITE);
+
     for (guint i = PROP_0 + 1; i < N_PROPERTIES; i++)
         g_object_class_install_property (oclass, i, properties[i]);
 
@@ -297,4 +1925,31 @@ uca_ring_buffer_init (UcaRingBuffer *buffer)
     priv->n_blocks_total = 0;
     priv->block_size = 0;
     priv->data = NULL;
+    priv->pins = NULL;
+    priv->metadata = NULL;
+    priv->scratch = NULL;
+    priv->policy = UCA_RING_BUFFER_POLICY_OVERWRITE_OLDEST;
+    priv->n_produced = 0;
+    priv->overruns = 0;
+    priv->max_fill = 0;
+    priv->dropping = FALSE;
+    priv->alloc_flags = UCA_RING_BUFFER_ALLOC_DEFAULT;
+    priv->alignment = 0;
+    priv->numa_node = -1;
+    priv->mapped_size = 0;
+    priv->constructed = FALSE;
+    priv->prefault_thread = NULL;
+    priv->prefault_cancelled = 0;
+    priv->write_index = 0;
+    priv->stage_index = 0;
+    priv->read_index = 0;
+    priv->spin_count = MIN_SPIN_COUNT;
+    priv->n_waiters = 0;
+    priv->n_readers = 0;
+
+    for (guint i = 0; i < MAX_READERS; i++)
+        priv->readers[i].active = FALSE;
+
+    g_mutex_init (&priv->wait_mutex);
+    g_cond_init (&priv->wait_cond);
 }
@@ -12,9 +12,102 @@
 
 G_BEGIN_DECLS
 
+/**
+ * UcaRingBufferAllocFlags:
+ * @UCA_RING_BUFFER_ALLOC_DEFAULT: Regular, lazily faulted pages
+ * @UCA_RING_BUFFER_ALLOC_HUGE_PAGES: Ask for transparent huge pages
+ * @UCA_RING_BUFFER_ALLOC_HUGETLB: Use explicit huge pages from the hugetlbfs
+ *  pool and fall back to regular pages if none are available
+ * @UCA_RING_BUFFER_ALLOC_PREFAULT: Fault in all pages on allocation
+ * @UCA_RING_BUFFER_ALLOC_PREFAULT_BACKGROUND: Fault in all pages in a
+ *  background thread so that allocation returns immediately
+ * @UCA_RING_BUFFER_ALLOC_LOCK: Lock all pages in memory with mlock()
+ *
+ * Controls how the memory of a #UcaRingBuffer is obtained.
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_RING_BUFFER_ALLOC_DEFAULT               = 0,
+    UCA_RING_BUFFER_ALLOC_HUGE_PAGES            = 1 << 0,
+    UCA_RING_BUFFER_ALLOC_HUGETLB               = 1 << 1,
+    UCA_RING_BUFFER_ALLOC_PREFAULT              = 1 << 2,
+    UCA_RING_BUFFER_ALLOC_PREFAULT_BACKGROUND   = 1 << 3,
+    UCA_RING_BUFFER_ALLOC_LOCK                  = 1 << 4,
+} UcaRingBufferAllocFlags;
+
+/**
+ * UcaRingBufferPolicy:
+ * @UCA_RING_BUFFER_POLICY_OVERWRITE_OLDEST: Drop the oldest unread block
+ * @UCA_RING_BUFFER_POLICY_DROP_NEWEST: Discard the block being written
+ * @UCA_RING_BUFFER_POLICY_BLOCK_PRODUCER: Wait until a block has been read
+ *
+ * Determines what uca_ring_buffer_wait_writable() does if all blocks are
+ * unread.
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_RING_BUFFER_POLICY_OVERWRITE_OLDEST,
+    UCA_RING_BUFFER_POLICY_DROP_NEWEST,
+    UCA_RING_BUFFER_POLICY_BLOCK_PRODUCER,
+} UcaRingBufferPolicy;
+
+/**
+ * UcaRingBufferReaderMode:
+ * @UCA_RING_BUFFER_READER_LOSSLESS: Read every frame, the producer applies
+ *  the #UcaRingBuffer:policy if the reader falls behind
+ * @UCA_RING_BUFFER_READER_LOSSY: Always read the newest frame and skip older
+ *  ones
+ *
+ * Since: 2.4
+ */
+typedef enum {
+    UCA_RING_BUFFER_READER_LOSSLESS,
+    UCA_RING_BUFFER_READER_LOSSY,
+} UcaRingBufferReaderMode;
+
+/**
+ * UcaRingBufferMetadata:
+ * @sequence: Running number of the frame, counting dropped frames as well
+ * @timestamp: Monotonic host time in microseconds when the frame was acquired
+ * @start_timestamp: Monotonic host time in microseconds when acquiring the
+ *  frame started
+ * @exposure_time: Exposure time in seconds
+ * @roi_x: Horizontal offset of the region of interest
+ * @roi_y: Vertical offset of the region of interest
+ * @roi_width: Width of the region of interest
+ * @roi_height: Height of the region of interest
+ * @settings_serial: Number of queued property updates applied before the
+ *  frame was acquired, it changes with the first frame that used new settings
+ * @flags: #UcaFrameFlags of the frame
+ * @bitdepth: Number of significant bits per pixel of the stored frame
+ * @size: Number of bytes of the stored frame, which can be less than the
+ *  block size
+ *
+ * Fixed-size record stored next to each block of a #UcaRingBuffer.
+ *
+ * Since: 2.4
+ */
+typedef struct {
+    guint64 sequence;
+    gint64  timestamp;
+    gint64  start_timestamp;
+    gdouble exposure_time;
+    guint   roi_x;
+    guint   roi_y;
+    guint   roi_width;
+    guint   roi_height;
+    guint   settings_serial;
+    guint   flags;
+    guint   bitdepth;
+    guint64 size;
+} UcaRingBufferMetadata;
+
 typedef struct _UcaRingBuffer           UcaRingBuffer;
 typedef struct _UcaRingBufferClass      UcaRingBufferClass;
 typedef struct _UcaRingBufferPrivate    UcaRingBufferPrivate;
+typedef struct _UcaRingBufferReader     UcaRingBufferReader;
 
 struct _UcaRingBuffer {
     /*< private >*/
@@ -31,16 +124,66 @@ struct _UcaRingBufferClass {
 UcaRingBuffer * uca_ring_buffer_new                 (gsize          block_size,
                                                      guint          n_blocks);
 void            uca_ring_buffer_reset               (UcaRingBuffer *buffer);
+gboolean        uca_ring_buffer_resize              (UcaRingBuffer *buffer,
+                                                     gsize          block_size,
+                                                     guint          n_blocks);
+guint           uca_ring_buffer_get_num_borrowed    (UcaRingBuffer *buffer);
+gboolean        uca_ring_buffer_contains            (UcaRingBuffer *buffer,
+                                                     gpointer       data);
 gsize           uca_ring_buffer_get_block_size      (UcaRingBuffer *buffer);
 guint           uca_ring_buffer_get_num_blocks      (UcaRingBuffer *buffer);
+gboolean        uca_ring_buffer_alignment_is_valid  (gsize          alignment);
 gboolean        uca_ring_buffer_available           (UcaRingBuffer *buffer);
+gboolean        uca_ring_buffer_wait_readable       (UcaRingBuffer *buffer,
+                                                     gint64         timeout_us);
 void            uca_ring_buffer_proceed             (UcaRingBuffer *buffer);
 gpointer        uca_ring_buffer_get_read_pointer    (UcaRingBuffer *buffer);
+gpointer        uca_ring_buffer_borrow_read_pointer (UcaRingBuffer *buffer);
+gpointer        uca_ring_buffer_borrow_newest_pointer
+                                                    (UcaRingBuffer *buffer,
+                                                     guint64       *n_skipped);
+void            uca_ring_buffer_release_read_pointer
+                                                    (UcaRingBuffer *buffer,
+                                                     gpointer       data);
+gboolean        uca_ring_buffer_wait_writable       (UcaRingBuffer *buffer,
+                                                     gint64         timeout_us);
 gpointer        uca_ring_buffer_get_write_pointer   (UcaRingBuffer *buffer);
 void            uca_ring_buffer_write_advance       (UcaRingBuffer *buffer);
+gboolean        uca_ring_buffer_write_stage         (UcaRingBuffer *buffer);
+void            uca_ring_buffer_commit              (UcaRingBuffer *buffer);
 gpointer        uca_ring_buffer_get_pointer         (UcaRingBuffer *buffer,
                                                      guint          index);
 gpointer        uca_ring_buffer_peek_pointer        (UcaRingBuffer *buffer);
+gpointer        uca_ring_buffer_get_stored_pointer  (UcaRingBuffer *buffer,
+                                                     guint          index);
+guint64         uca_ring_buffer_get_sequence        (UcaRingBuffer *buffer,
+                                                     gpointer       data);
+const UcaRingBufferMetadata *
+                uca_ring_buffer_get_metadata        (UcaRingBuffer *buffer,
+                                                     guint          index);
+const UcaRingBufferMetadata *
+                uca_ring_buffer_get_pointer_metadata
+                                                    (UcaRingBuffer *buffer,
+                                                     gpointer       data);
+UcaRingBufferMetadata *
+                uca_ring_buffer_get_write_metadata  (UcaRingBuffer *buffer);
+guint64         uca_ring_buffer_get_overruns        (UcaRingBuffer *buffer);
+guint           uca_ring_buffer_get_max_fill        (UcaRingBuffer *buffer);
+UcaRingBufferReader *
+                uca_ring_buffer_add_reader          (UcaRingBuffer *buffer,
+                                                     UcaRingBufferReaderMode mode);
+void            uca_ring_buffer_remove_reader       (UcaRingBuffer *buffer,
+                                                     UcaRingBufferReader *reader);
+gboolean        uca_ring_buffer_reader_wait_readable
+                                                    (UcaRingBuffer *buffer,
+                                                     UcaRingBufferReader *reader,
+                                                     gint64         timeout_us);
+gpointer        uca_ring_buffer_reader_borrow       (UcaRingBuffer *buffer,
+                                                     UcaRingBufferReader *reader);
+guint64         uca_ring_buffer_reader_get_lag      (UcaRingBuffer *buffer,
+                                                     UcaRingBufferReader *reader);
+guint64         uca_ring_buffer_reader_get_drops    (UcaRingBuffer *buffer,
+                                                     UcaRingBufferReader *reader);
 
 GType uca_ring_buffer_get_type (void);
 
@@ -0,0 +1,256 @@
+/* Copyright (C) 2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-roi-filter
+ * @Short_description: Software region of interest
+ * @Title: UcaRoiFilter
+ *
+ * A #UcaFilter that cuts one or more rectangular regions out of each frame,
+ * for cameras whose hardware cannot restrict readout or only to a single
+ * region. All regions have the same width and are stacked from top to bottom
+ * in the order they were added, so the result is a compact frame of that
+ * width and the sum of their heights.
+ */
+
+#include <string.h>
+#include "uca-roi-filter.h"
+
+#define UCA_ROI_FILTER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_ROI_FILTER, UcaRoiFilterPrivate))
+
+static void uca_roi_filter_interface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UcaRoiFilter, uca_roi_filter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_roi_filter_interface_init))
+
+typedef struct {
+    guint x;
+    guint y;
+    guint width;
+    guint height;
+} Region;
+
+typedef struct {
+    gsize size;
+    guint8 data[];
+} Scratch;
+
+struct _UcaRoiFilterPrivate {
+    GRWLock lock;
+    GArray *regions;
+};
+
+/*
+ * Regions may overlap or come in any order, so they are assembled in a
+ * per-thread buffer before they are copied back.
+ */
+static GPrivate scratch_key = G_PRIVATE_INIT (g_free);
+
+static guint8 *
+get_scratch (gsize size)
+{
+    Scratch *scratch;
+
+    scratch = g_private_get (&scratch_key);
+
+    if (scratch == NULL || scratch->size < size) {
+        scratch = g_malloc (sizeof (Scratch) + size);
+        scratch->size = size;
+        g_private_replace (&scratch_key, scratch);
+    }
+
+    return scratch->data;
+}
+
+/**
+ * uca_roi_filter_new:
+ *
+ * Returns: (transfer full): A new #UcaRoiFilter without regions, which lets
+ * frames pass unchanged.
+ * Since: 2.4
+ */
+UcaFilter *
+uca_roi_filter_new (void)
+{
+    return UCA_FILTER (g_object_new (UCA_TYPE_ROI_FILTER, NULL));
+}
+
+/**
+ * uca_roi_filter_add_region:
+ * @filter: A #UcaRoiFilter
+ * @x: Horizontal offset of the region in the frame
+ * @y: Vertical offset of the region in the frame
+ * @width: Width of the region, the same for all regions
+ * @height: Height of the region
+ * @error: Location for a #GError or %NULL
+ *
+ * Add a region that is extracted from each frame below the regions added
+ * before. Regions may overlap, but together they must not hold more bytes
+ * than the frame, otherwise processing fails.
+ *
+ * Returns: %TRUE if the region was added, %FALSE with a
+ * #UCA_FILTER_ERROR_FORMAT error if its width differs from the others.
+ * Since: 2.4
+ */
+gboolean
+uca_roi_filter_add_region (UcaRoiFilter *filter, guint x, guint y, guint width, guint height, GError **error)
+{
+    UcaRoiFilterPrivate *priv;
+    Region region = { x, y, width, height };
+    gboolean result = TRUE;
+
+    g_return_val_if_fail (UCA_IS_ROI_FILTER (filter), FALSE);
+    g_return_val_if_fail (width > 0 && height > 0, FALSE);
+
+    priv = filter->priv;
+
+    g_rw_lock_writer_lock (&priv->lock);
+
+    if (priv->regions->len > 0 && g_array_index (priv->regions, Region, 0).width != width) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                     "Region width %u differs from %u", width,
+                     g_array_index (priv->regions, Region, 0).width);
+        result = FALSE;
+    }
+    else
+        g_array_append_val (priv->regions, region);
+
+    g_rw_lock_writer_unlock (&priv->lock);
+    return result;
+}
+
+/**
+ * uca_roi_filter_clear_regions:
+ * @filter: A #UcaRoiFilter
+ *
+ * Remove all regions.
+ *
+ * Since: 2.4
+ */
+void
+uca_roi_filter_clear_regions (UcaRoiFilter *filter)
+{
+    g_return_if_fail (UCA_IS_ROI_FILTER (filter));
+
+    g_rw_lock_writer_lock (&filter->priv->lock);
+    g_array_set_size (filter->priv->regions, 0);
+    g_rw_lock_writer_unlock (&filter->priv->lock);
+}
+
+static gboolean
+uca_roi_filter_process (UcaFilter *filter, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    UcaRoiFilterPrivate *priv;
+    gsize pixel_size;
+    gsize row_size;
+    guint height = 0;
+    guint8 *out;
+    gboolean result = TRUE;
+
+    priv = UCA_ROI_FILTER (filter)->priv;
+    pixel_size = info->format == UCA_PIXEL_FORMAT_MONO8 ? 1 : 2;
+
+    g_rw_lock_reader_lock (&priv->lock);
+
+    if (priv->regions->len == 0)
+        goto out;
+
+    for (guint i = 0; i < priv->regions->len; i++) {
+        Region *region = &g_array_index (priv->regions, Region, i);
+
+        if (region->x + region->width > info->width || region->y + region->height > info->height) {
+            g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                         "Region %ux%u at %u,%u exceeds frame of %ux%u",
+                         region->width, region->height, region->x, region->y,
+                         info->width, info->height);
+            result = FALSE;
+            goto out;
+        }
+
+        height += region->height;
+    }
+
+    row_size = g_array_index (priv->regions, Region, 0).width * pixel_size;
+
+    /* Overlapping regions can add up to more than fits in place */
+    if (row_size * height > info->stride * info->height) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT,
+                     "Regions of %" G_GSIZE_FORMAT " bytes exceed frame of %" G_GSIZE_FORMAT " bytes",
+                     row_size * height, info->stride * info->height);
+        result = FALSE;
+        goto out;
+    }
+
+    out = get_scratch (row_size * height);
+
+    for (guint i = 0, y_out = 0; i < priv->regions->len; i++) {
+        Region *region = &g_array_index (priv->regions, Region, i);
+        const guint8 *src = ((const guint8 *) data) + region->y * info->stride + region->x * pixel_size;
+
+        for (guint y = 0; y < region->height; y++, y_out++)
+            memcpy (out + y_out * row_size, src + y * info->stride, row_size);
+    }
+
+    memcpy (data, out, row_size * height);
+
+    info->width = g_array_index (priv->regions, Region, 0).width;
+    info->height = height;
+    info->stride = row_size;
+
+out:
+    g_rw_lock_reader_unlock (&priv->lock);
+    return result;
+}
+
+static void
+uca_roi_filter_finalize (GObject *object)
+{
+    UcaRoiFilterPrivate *priv;
+
+    priv = UCA_ROI_FILTER_GET_PRIVATE (object);
+    g_array_free (priv->regions, TRUE);
+    g_rw_lock_clear (&priv->lock);
+
+    G_OBJECT_CLASS (uca_roi_filter_parent_class)->finalize (object);
+}
+
+static void
+uca_roi_filter_interface_init (UcaFilterInterface *iface)
+{
+    iface->process = uca_roi_filter_process;
+}
+
+static void
+uca_roi_filter_class_init (UcaRoiFilterClass *klass)
+{
+    GObjectClass *oclass = G_OBJECT_CLASS (klass);
+
+    oclass->finalize = uca_roi_filter_finalize;
+
+    g_type_class_add_private (klass, sizeof (UcaRoiFilterPrivate));
+}
+
+static void
+uca_roi_filter_init (UcaRoiFilter *filter)
+{
+    UcaRoiFilterPrivate *priv;
+
+    filter->priv = priv = UCA_ROI_FILTER_GET_PRIVATE (filter);
+    g_rw_lock_init (&priv->lock);
+    priv->regions = g_array_new (FALSE, FALSE, sizeof (Region));
+}
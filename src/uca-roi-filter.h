@@ -0,0 +1,45 @@
+#ifndef UCA_ROI_FILTER_H
+#define UCA_ROI_FILTER_H
+
+#include <glib-object.h>
+#include "uca-filter.h"
+
+#define UCA_TYPE_ROI_FILTER             (uca_roi_filter_get_type())
+#define UCA_ROI_FILTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_ROI_FILTER, UcaRoiFilter))
+#define UCA_IS_ROI_FILTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_ROI_FILTER))
+#define UCA_ROI_FILTER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_ROI_FILTER, UcaRoiFilterClass))
+#define UCA_IS_ROI_FILTER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_ROI_FILTER))
+#define UCA_ROI_FILTER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_ROI_FILTER, UcaRoiFilterClass))
+
+G_BEGIN_DECLS
+
+typedef struct _UcaRoiFilter           UcaRoiFilter;
+typedef struct _UcaRoiFilterClass      UcaRoiFilterClass;
+typedef struct _UcaRoiFilterPrivate    UcaRoiFilterPrivate;
+
+struct _UcaRoiFilter {
+    /*< private >*/
+    GObject parent;
+
+    UcaRoiFilterPrivate *priv;
+};
+
+struct _UcaRoiFilterClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UcaFilter * uca_roi_filter_new             (void);
+gboolean    uca_roi_filter_add_region      (UcaRoiFilter   *filter,
+                                            guint           x,
+                                            guint           y,
+                                            guint           width,
+                                            guint           height,
+                                            GError        **error);
+void        uca_roi_filter_clear_regions   (UcaRoiFilter   *filter);
+
+GType uca_roi_filter_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,713 @@
+#include <glib.h>
+#include <string.h>
+#include "uca-accumulator.h"
+#include "uca-binning-filter.h"
+#include "uca-content-trigger.h"
+#include "uca-dark-filter.h"
+#include "uca-flat-field-filter.h"
+#include "uca-hot-pixel-filter.h"
+#include "uca-roi-filter.h"
+
+
+static void
+test_dark_8 (void)
+{
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    guint8 dark[] = { 10, 20, 30, 40, 50, 60 };
+    guint8 data[] = { 15, 20, 25, 255, 0, 61 };
+    GError *error = NULL;
+
+    uca_frame_info_init (&info, 3, 2, 8);
+    filter = uca_dark_filter_new ();
+
+    /* Without a dark frame nothing changes */
+    g_assert (uca_filter_process (filter, data, &info, &error));
+    g_assert_no_error (error);
+    g_assert (data[0] == 15);
+
+    uca_dark_filter_set_dark (UCA_DARK_FILTER (filter), dark, &info);
+    g_assert (uca_filter_process (filter, data, &info, &error));
+    g_assert_no_error (error);
+
+    g_assert (data[0] == 5);
+    g_assert (data[1] == 0);
+    g_assert (data[2] == 0);
+    g_assert (data[3] == 215);
+    g_assert (data[4] == 0);
+    g_assert (data[5] == 1);
+
+    g_object_unref (filter);
+}
+
+static void
+test_dark_16 (void)
+{
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    guint16 dark[] = { 100, 1000, 4000, 0 };
+    guint16 data[] = { 4095, 999, 4000, 7 };
+    GError *error = NULL;
+
+    uca_frame_info_init (&info, 2, 2, 12);
+    filter = uca_dark_filter_new ();
+    uca_dark_filter_set_dark (UCA_DARK_FILTER (filter), dark, &info);
+
+    g_assert (uca_filter_process (filter, data, &info, &error));
+    g_assert_no_error (error);
+
+    g_assert (data[0] == 3995);
+    g_assert (data[1] == 0);
+    g_assert (data[2] == 0);
+    g_assert (data[3] == 7);
+
+    g_object_unref (filter);
+}
+
+static void
+test_dark_wide (void)
+{
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    guint8 dark8[37], data8[37];
+    guint16 dark16[37], data16[37];
+    GError *error = NULL;
+
+    /* Wider than a vector and odd, so that both kernels and the tail run */
+    for (guint i = 0; i < 37; i++) {
+        dark8[i] = (guint8) (i * 7);
+        data8[i] = (guint8) (i * 11 % 256);
+        dark16[i] = (guint16) (i * 1000);
+        data16[i] = (guint16) (65535 - i * 900);
+    }
+
+    filter = uca_dark_filter_new ();
+
+    uca_frame_info_init (&info, 37, 1, 8);
+    uca_dark_filter_set_dark (UCA_DARK_FILTER (filter), dark8, &info);
+    g_assert (uca_filter_process (filter, data8, &info, &error));
+    g_assert_no_error (error);
+
+    for (guint i = 0; i < 37; i++) {
+        guint x = i * 11 % 256;
+        g_assert_cmpuint (data8[i], ==, x > i * 7 ? x - i * 7 : 0);
+    }
+
+    uca_frame_info_init (&info, 37, 1, 16);
+    uca_dark_filter_set_dark (UCA_DARK_FILTER (filter), dark16, &info);
+    g_assert (uca_filter_process (filter, data16, &info, &error));
+    g_assert_no_error (error);
+
+    for (guint i = 0; i < 37; i++) {
+        guint x = 65535 - i * 900;
+        g_assert_cmpuint (data16[i], ==, x > i * 1000 ? x - i * 1000 : 0);
+    }
+
+    g_object_unref (filter);
+}
+
+static void
+test_dark_mismatch (void)
+{
+    UcaFilter *filter;
+    UcaFrameInfo dark_info;
+    UcaFrameInfo info;
+    guint8 dark[4] = { 0, };
+    guint8 data[6] = { 0, };
+    GError *error = NULL;
+
+    uca_frame_info_init (&dark_info, 2, 2, 8);
+    uca_frame_info_init (&info, 3, 2, 8);
+    filter = uca_dark_filter_new ();
+    uca_dark_filter_set_dark (UCA_DARK_FILTER (filter), dark, &dark_info);
+
+    g_assert (!uca_filter_process (filter, data, &info, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT);
+    g_error_free (error);
+
+    g_object_unref (filter);
+}
+
+static void
+test_hot_pixel (void)
+{
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    guint8 mask[] = { 1, 0, 1, 1, 0,
+                      0, 0, 0, 0, 1 };
+    guint16 data[] = { 999, 10, 999, 999, 30,
+                       1, 2, 3, 4, 999 };
+    GError *error = NULL;
+
+    uca_frame_info_init (&info, 5, 2, 16);
+    filter = uca_hot_pixel_filter_new ();
+    uca_hot_pixel_filter_set_mask (UCA_HOT_PIXEL_FILTER (filter), mask, 5, 2);
+
+    g_assert (uca_filter_process (filter, data, &info, &error));
+    g_assert_no_error (error);
+
+    /* Edges copy their only neighbour, runs use the closest good pixels */
+    g_assert (data[0] == 10);
+    g_assert (data[1] == 10);
+    g_assert (data[2] == 20);
+    g_assert (data[3] == 20);
+    g_assert (data[4] == 30);
+    g_assert (data[9] == 4);
+
+    info.width = 4;
+    g_assert (!uca_filter_process (filter, data, &info, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT);
+    g_error_free (error);
+
+    g_object_unref (filter);
+}
+
+static void
+test_flat_field (void)
+{
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    gfloat dark[22];
+    gfloat flat[22];
+    gfloat output[22];
+    guint16 data[22];
+    guint8 data8[22];
+    GError *error = NULL;
+
+    /* Odd width, so that rows end with pixels the vector kernels leave over */
+    uca_frame_info_init (&info, 11, 2, 12);
+
+    for (guint i = 0; i < 22; i++) {
+        dark[i] = 10.0f;
+        flat[i] = 110.0f;
+        data[i] = 10 + i * 5;
+    }
+
+    flat[3] = 10.0f;
+
+    filter = uca_flat_field_filter_new ();
+
+    g_assert (!uca_flat_field_filter_correct (UCA_FLAT_FIELD_FILTER (filter), data, &info, output, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_NO_REFERENCE);
+    g_clear_error (&error);
+
+    /* Without references frames pass unchanged */
+    g_assert (uca_filter_process (filter, data, &info, &error));
+    g_assert_no_error (error);
+    g_assert (data[21] == 115);
+
+    uca_flat_field_filter_set_reference (UCA_FLAT_FIELD_FILTER (filter), UCA_FLAT_FIELD_DARK, dark, 11, 2);
+    uca_flat_field_filter_set_reference (UCA_FLAT_FIELD_FILTER (filter), UCA_FLAT_FIELD_FLAT, flat, 11, 2);
+
+    g_assert (uca_flat_field_filter_correct (UCA_FLAT_FIELD_FILTER (filter), data, &info, output, &error));
+    g_assert_no_error (error);
+
+    for (guint i = 0; i < 22; i++) {
+        if (i == 3)
+            g_assert_cmpfloat (output[i], ==, 0.0f);
+        else
+            g_assert_cmpfloat (ABS (output[i] - i * 0.05f), <, 1e-5);
+    }
+
+    g_object_set (filter, "scale", 1000.0, NULL);
+    g_assert (uca_filter_process (filter, data, &info, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (info.bitdepth, ==, 16);
+
+    for (guint i = 0; i < 22; i++)
+        g_assert_cmpuint (data[i], ==, i == 3 ? 0 : i * 50);
+
+    /* 8-bit frames are corrected in place and clamped to their range */
+    uca_frame_info_init (&info, 11, 2, 8);
+
+    for (guint i = 0; i < 22; i++)
+        data8[i] = 10 + i * 5;
+
+    g_object_set (filter, "scale", 300.0, NULL);
+    g_assert (uca_filter_process (filter, data8, &info, &error));
+    g_assert_no_error (error);
+
+    for (guint i = 0; i < 22; i++)
+        g_assert_cmpuint (data8[i], ==, i == 3 ? 0 : MIN (i * 15, 255));
+
+    uca_frame_info_init (&info, 11, 2, 12);
+
+    /* A reference of another size replaces both */
+    uca_flat_field_filter_set_reference (UCA_FLAT_FIELD_FILTER (filter), UCA_FLAT_FIELD_DARK, dark, 2, 2);
+    g_assert (!uca_filter_process (filter, data, &info, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT);
+    g_error_free (error);
+
+    g_object_unref (filter);
+}
+
+static void
+test_binning (void)
+{
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    guint16 data[] = { 1, 2, 3, 4, 9,
+                       5, 6, 7, 8, 9,
+                       9, 9, 9, 9, 9 };
+    guint8 data8[64];
+    GError *error = NULL;
+
+    uca_frame_info_init (&info, 5, 3, 16);
+    filter = uca_binning_filter_new (2, 2);
+
+    /* The last column and row do not fill a block and are dropped */
+    g_assert (uca_filter_process (filter, data, &info, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (info.width, ==, 2);
+    g_assert_cmpuint (info.height, ==, 1);
+    g_assert_cmpuint (info.stride, ==, 4);
+    g_assert (data[0] == 4);
+    g_assert (data[1] == 6);
+
+    g_object_unref (filter);
+
+    for (guint i = 0; i < 64; i++)
+        data8[i] = i % 8 < 4 ? 10 : 255;
+
+    uca_frame_info_init (&info, 8, 8, 8);
+    filter = uca_binning_filter_new (4, 4);
+    g_assert (uca_filter_process (filter, data8, &info, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (info.width, ==, 2);
+    g_assert_cmpuint (info.height, ==, 2);
+    g_assert (data8[0] == 10 && data8[1] == 255 && data8[2] == 10 && data8[3] == 255);
+
+    info.width = 1;
+    g_assert (!uca_filter_process (filter, data8, &info, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT);
+    g_error_free (error);
+
+    g_object_unref (filter);
+}
+
+static void
+test_binning_wide (void)
+{
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    guint8 data8[2 * 39];
+    guint16 data16[2 * 39];
+    guint expected8[13], expected16[13];
+    GError *error = NULL;
+
+    /* Rows wider than a vector and not a multiple of it, so that both kernels and the tail run */
+    for (guint i = 0; i < 2 * 39; i++) {
+        data8[i] = (guint8) (i * 37 % 256);
+        data16[i] = (guint16) (65535 - i * 811);
+    }
+
+    for (guint x = 0; x < 13; x++) {
+        guint sum8 = 0, sum16 = 0;
+
+        for (guint y = 0; y < 2; y++) {
+            for (guint i = 0; i < 3; i++) {
+                sum8 += data8[y * 39 + x * 3 + i];
+                sum16 += data16[y * 39 + x * 3 + i];
+            }
+        }
+
+        expected8[x] = (sum8 + 3) / 6;
+        expected16[x] = (sum16 + 3) / 6;
+    }
+
+    filter = uca_binning_filter_new (3, 2);
+
+    uca_frame_info_init (&info, 39, 2, 8);
+    g_assert (uca_filter_process (filter, data8, &info, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (info.width, ==, 13);
+    g_assert_cmpuint (info.height, ==, 1);
+
+    for (guint x = 0; x < 13; x++)
+        g_assert_cmpuint (data8[x], ==, expected8[x]);
+
+    uca_frame_info_init (&info, 39, 2, 16);
+    g_assert (uca_filter_process (filter, data16, &info, &error));
+    g_assert_no_error (error);
+
+    for (guint x = 0; x < 13; x++)
+        g_assert_cmpuint (data16[x], ==, expected16[x]);
+
+    g_object_unref (filter);
+}
+
+static void
+test_roi (void)
+{
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    guint8 data[] = {  0,  1,  2,  3,
+                      10, 11, 12, 13,
+                      20, 21, 22, 23 };
+    GError *error = NULL;
+
+    uca_frame_info_init (&info, 4, 3, 8);
+    filter = uca_roi_filter_new ();
+
+    /* Regions may overlap and come in any order */
+    g_assert (uca_roi_filter_add_region (UCA_ROI_FILTER (filter), 2, 1, 2, 2, &error));
+    g_assert (uca_roi_filter_add_region (UCA_ROI_FILTER (filter), 1, 0, 2, 1, &error));
+    g_assert_no_error (error);
+
+    g_assert (!uca_roi_filter_add_region (UCA_ROI_FILTER (filter), 0, 0, 3, 1, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT);
+    g_clear_error (&error);
+
+    g_assert (uca_filter_process (filter, data, &info, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (info.width, ==, 2);
+    g_assert_cmpuint (info.height, ==, 3);
+    g_assert_cmpuint (info.stride, ==, 2);
+    g_assert (data[0] == 12 && data[1] == 13);
+    g_assert (data[2] == 22 && data[3] == 23);
+    g_assert (data[4] == 1 && data[5] == 2);
+
+    /* The frame is now too small for the first region */
+    g_assert (!uca_filter_process (filter, data, &info, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT);
+    g_clear_error (&error);
+
+    /* Overlapping regions must not add up to more than the frame holds */
+    uca_frame_info_init (&info, 4, 3, 8);
+    uca_roi_filter_clear_regions (UCA_ROI_FILTER (filter));
+
+    for (guint x = 0; x < 3; x++)
+        g_assert (uca_roi_filter_add_region (UCA_ROI_FILTER (filter), x, 0, 2, 3, NULL));
+
+    g_assert (!uca_filter_process (filter, data, &info, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT);
+    g_assert_cmpuint (info.height, ==, 3);
+    g_error_free (error);
+
+    g_object_unref (filter);
+}
+
+static void
+test_accumulator (void)
+{
+    UcaAccumulator *accumulator;
+    UcaFrameInfo info;
+    UcaFrame *frame;
+    guint16 data[3][6] = { {  10, 100, 0, 7, 65535, 0 },
+                           {  20, 100, 0, 7, 65535, 0 },
+                           {  60, 100, 0, 7, 65535, 0 } };
+    gfloat output[4];
+    guint16 *large;
+    guint width, height;
+    GError *error = NULL;
+
+    /* Two pixels of padding per row */
+    uca_frame_info_init (&info, 2, 2, 16);
+    info.stride = 6;
+    accumulator = uca_accumulator_new ();
+
+    g_assert (!uca_accumulator_get_statistic (accumulator, UCA_ACCUMULATOR_MEAN, NULL, NULL, NULL));
+    g_assert (uca_accumulator_get_frame (accumulator, UCA_ACCUMULATOR_MEAN) == NULL);
+
+    for (guint i = 0; i < 3; i++) {
+        g_assert (uca_filter_process (UCA_FILTER (accumulator), data[i], &info, &error));
+        g_assert_no_error (error);
+    }
+
+    /* The frames themselves are not changed */
+    g_assert (data[2][0] == 60);
+    g_assert_cmpuint (uca_accumulator_get_count (accumulator), ==, 3);
+
+    g_assert (uca_accumulator_get_statistic (accumulator, UCA_ACCUMULATOR_MEAN, output, &width, &height));
+    g_assert_cmpuint (width, ==, 2);
+    g_assert_cmpuint (height, ==, 2);
+    g_assert_cmpfloat (ABS (output[0] - 30.0f), <, 1e-4);
+    g_assert_cmpfloat (ABS (output[1] - 100.0f), <, 1e-4);
+    g_assert_cmpfloat (ABS (output[2] - 7.0f), <, 1e-4);
+    g_assert_cmpfloat (ABS (output[3] - 65535.0f), <, 1e-2);
+
+    g_assert (uca_accumulator_get_statistic (accumulator, UCA_ACCUMULATOR_VARIANCE, output, NULL, NULL));
+    g_assert_cmpfloat (ABS (output[0] - 700.0f), <, 1e-3);
+    g_assert_cmpfloat (ABS (output[1]), <, 1e-6);
+
+    g_assert (uca_accumulator_get_statistic (accumulator, UCA_ACCUMULATOR_MIN, output, NULL, NULL));
+    g_assert_cmpfloat (output[0], ==, 10.0f);
+    g_assert (uca_accumulator_get_statistic (accumulator, UCA_ACCUMULATOR_MAX, output, NULL, NULL));
+    g_assert_cmpfloat (output[0], ==, 60.0f);
+
+    /* Variance rounds and clamps to 16 bits */
+    frame = uca_accumulator_get_frame (accumulator, UCA_ACCUMULATOR_VARIANCE);
+    g_assert_cmpuint (uca_frame_get_info (frame)->sequence, ==, 3);
+    g_assert (((guint16 *) uca_frame_get_data (frame))[0] == 700);
+    uca_frame_unref (frame);
+
+    uca_frame_info_init (&info, 3, 2, 16);
+    g_assert (!uca_accumulator_add (accumulator, data[0], &info, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT);
+    g_clear_error (&error);
+
+    /* After a reset, frames of any size start new statistics */
+    uca_accumulator_reset (accumulator);
+    g_assert_cmpuint (uca_accumulator_get_count (accumulator), ==, 0);
+
+    /* Rows cross the boundaries of the internal blocks */
+    uca_frame_info_init (&info, 100, 50, 8);
+    large = g_malloc (uca_frame_info_get_size (&info));
+
+    for (guint i = 1; i <= 2; i++) {
+        memset (large, i, uca_frame_info_get_size (&info));
+        g_assert (uca_accumulator_add (accumulator, large, &info, &error));
+        g_assert_no_error (error);
+    }
+
+    frame = uca_accumulator_get_frame (accumulator, UCA_ACCUMULATOR_MAX);
+    g_assert_cmpuint (uca_frame_get_info (frame)->width, ==, 100);
+
+    for (guint i = 0; i < 100 * 50; i++)
+        g_assert (((guint16 *) uca_frame_get_data (frame))[i] == 2);
+
+    uca_frame_unref (frame);
+    g_free (large);
+    g_object_unref (accumulator);
+}
+
+static void
+test_accumulator_wide (void)
+{
+    UcaAccumulator *accumulator;
+    UcaFrameInfo info;
+    guint8 data8[3][37];
+    guint16 data16[3][37];
+    gfloat output[37];
+
+    /* Wider than a vector and not a multiple of it, so that both kernels and the tail run */
+    for (guint f = 0; f < 3; f++) {
+        for (guint i = 0; i < 37; i++) {
+            data8[f][i] = (guint8) ((i * 29 + f * 101) % 256);
+            data16[f][i] = (guint16) ((i * 1777 + f * 20011) % 65536);
+        }
+    }
+
+    for (guint bits = 8; bits <= 16; bits += 8) {
+        uca_frame_info_init (&info, 37, 1, bits);
+        accumulator = uca_accumulator_new ();
+
+        for (guint f = 0; f < 3; f++) {
+            gconstpointer data = bits == 8 ? (gconstpointer) data8[f] : (gconstpointer) data16[f];
+            g_assert (uca_accumulator_add (accumulator, data, &info, NULL));
+        }
+
+        for (guint s = UCA_ACCUMULATOR_MEAN; s <= UCA_ACCUMULATOR_MAX; s++) {
+            g_assert (uca_accumulator_get_statistic (accumulator, s, output, NULL, NULL));
+
+            for (guint i = 0; i < 37; i++) {
+                gdouble x[3], mean, variance;
+
+                for (guint f = 0; f < 3; f++)
+                    x[f] = bits == 8 ? data8[f][i] : data16[f][i];
+
+                mean = (x[0] + x[1] + x[2]) / 3;
+                variance = ((x[0] - mean) * (x[0] - mean) + (x[1] - mean) * (x[1] - mean) +
+                            (x[2] - mean) * (x[2] - mean)) / 2;
+
+                if (s == UCA_ACCUMULATOR_MEAN)
+                    g_assert_cmpfloat (ABS (output[i] - mean), <, 1e-2);
+                else if (s == UCA_ACCUMULATOR_VARIANCE)
+                    g_assert_cmpfloat (ABS (output[i] - variance), <, 1e-6 * variance + 1e-2);
+                else if (s == UCA_ACCUMULATOR_MIN)
+                    g_assert_cmpfloat (output[i], ==, MIN (x[0], MIN (x[1], x[2])));
+                else
+                    g_assert_cmpfloat (output[i], ==, MAX (x[0], MAX (x[1], x[2])));
+            }
+        }
+
+        g_object_unref (accumulator);
+    }
+}
+
+static void
+test_content_trigger (void)
+{
+    UcaFilter *trigger;
+    UcaFrameInfo info;
+    guint8 data[] = { 1,  2,  3,  4, 255,
+                      5,  6,  7,  8, 255,
+                      9, 10, 11, 12, 255 };
+    guint16 frames[2][4] = { { 100, 200, 300, 400 },
+                             { 102, 198, 302, 398 } };
+    gdouble value;
+    guint64 events;
+    GError *error = NULL;
+
+    /* Padding is not part of the frame */
+    uca_frame_info_init (&info, 4, 3, 8);
+    info.stride = 5;
+    trigger = uca_content_trigger_new (UCA_CONTENT_TRIGGER_MEAN, 6.0);
+
+    g_assert (uca_filter_process (trigger, data, &info, &error));
+    g_assert_no_error (error);
+    g_object_get (G_OBJECT (trigger), "last-value", &value, NULL);
+    g_assert_cmpfloat (value, ==, 6.5);
+    g_assert (info.flags & UCA_FRAME_FLAG_TRIGGERED);
+    g_assert (data[0] == 1);
+
+    /* The maximum must exceed the threshold, reaching it is not enough */
+    info.flags = UCA_FRAME_FLAG_NONE;
+    g_object_set (G_OBJECT (trigger),
+                  "mode", UCA_CONTENT_TRIGGER_MAX,
+                  "threshold", 7.0,
+                  "roi-x", 1,
+                  "roi-y", 1,
+                  "roi-width", 2,
+                  "roi-height", 1,
+                  NULL);
+
+    g_assert (uca_filter_process (trigger, data, &info, &error));
+    g_object_get (G_OBJECT (trigger), "last-value", &value, "events", &events, NULL);
+    g_assert_cmpfloat (value, ==, 7.0);
+    g_assert (!(info.flags & UCA_FRAME_FLAG_TRIGGERED));
+    g_assert_cmpuint (events, ==, 1);
+
+    g_object_set (G_OBJECT (trigger), "roi-x", 3, NULL);
+    g_assert (!uca_filter_process (trigger, data, &info, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_FORMAT);
+    g_clear_error (&error);
+
+    /* The first frame has nothing to be compared with */
+    uca_frame_info_init (&info, 4, 1, 16);
+    g_object_set (G_OBJECT (trigger),
+                  "mode", UCA_CONTENT_TRIGGER_DIFFERENCE,
+                  "threshold", 3.0,
+                  "roi-x", 0,
+                  "roi-width", 0,
+                  "roi-y", 0,
+                  "roi-height", 0,
+                  NULL);
+
+    g_assert (uca_filter_process (trigger, frames[0], &info, &error));
+    g_assert (!(info.flags & UCA_FRAME_FLAG_TRIGGERED));
+
+    info.sequence = 2;
+    g_assert (uca_filter_process (trigger, frames[1], &info, &error));
+    g_assert_no_error (error);
+    g_object_get (G_OBJECT (trigger), "last-value", &value, "events", &events, NULL);
+    g_assert_cmpfloat (value, ==, 4.0);
+    g_assert (info.flags & UCA_FRAME_FLAG_TRIGGERED);
+    g_assert_cmpuint (events, ==, 2);
+
+    /* A frame that a slower filter thread passes in late is not compared */
+    info.flags = UCA_FRAME_FLAG_NONE;
+    info.sequence = 1;
+    g_assert (uca_filter_process (trigger, frames[0], &info, &error));
+    g_object_get (G_OBJECT (trigger), "last-value", &value, "events", &events, NULL);
+    g_assert_cmpfloat (value, ==, 4.0);
+    g_assert (!(info.flags & UCA_FRAME_FLAG_TRIGGERED));
+    g_assert_cmpuint (events, ==, 2);
+
+    /* A new recording numbers its frames from zero */
+    uca_filter_reset (trigger);
+    info.sequence = 0;
+    g_assert (uca_filter_process (trigger, frames[0], &info, &error));
+    g_assert (!(info.flags & UCA_FRAME_FLAG_TRIGGERED));
+    info.sequence = 1;
+    g_assert (uca_filter_process (trigger, frames[1], &info, &error));
+    g_assert (info.flags & UCA_FRAME_FLAG_TRIGGERED);
+
+    g_object_unref (trigger);
+}
+
+static void
+test_content_trigger_wide (void)
+{
+    UcaFilter *trigger;
+    UcaFrameInfo info;
+    guint8 *data8;
+    guint16 *data16;
+    gdouble value;
+    guint n = 70001;
+
+    /*
+     * Rows longer than the chunks of the vector kernels and not a multiple of
+     * a vector, with values at full scale so that narrow sums would overflow
+     */
+    data8 = g_malloc (n);
+    data16 = g_malloc (n * sizeof (guint16));
+    memset (data8, 0, n);
+
+    for (guint i = 0; i < n; i++)
+        data16[i] = 65535;
+
+    data16[n - 1] = 1;
+    trigger = uca_content_trigger_new (UCA_CONTENT_TRIGGER_MEAN, 0.0);
+    uca_frame_info_init (&info, n, 1, 16);
+
+    g_assert (uca_filter_process (trigger, data16, &info, NULL));
+    g_object_get (G_OBJECT (trigger), "last-value", &value, NULL);
+    g_assert_cmpfloat (value, ==, (65535.0 * (n - 1) + 1) / n);
+
+    g_object_set (G_OBJECT (trigger), "mode", UCA_CONTENT_TRIGGER_MAX, NULL);
+
+    for (guint i = 0; i < n; i++)
+        data16[i] = i == n - 2 ? 60000 : i % 50000;
+
+    g_assert (uca_filter_process (trigger, data16, &info, NULL));
+    g_object_get (G_OBJECT (trigger), "last-value", &value, NULL);
+    g_assert_cmpfloat (value, ==, 60000.0);
+
+    g_object_set (G_OBJECT (trigger), "mode", UCA_CONTENT_TRIGGER_DIFFERENCE, NULL);
+    uca_frame_info_init (&info, n, 1, 8);
+    info.sequence = 1;
+    g_assert (uca_filter_process (trigger, data8, &info, NULL));
+
+    /* All but the last pixel change by the largest possible step */
+    memset (data8, 255, n - 1);
+    info.sequence = 2;
+    g_assert (uca_filter_process (trigger, data8, &info, NULL));
+    g_object_get (G_OBJECT (trigger), "last-value", &value, NULL);
+    g_assert_cmpfloat (value, ==, 65025.0 * (n - 1) / n);
+
+    for (guint i = 0; i < n; i++)
+        data16[i] = i % 3 ? 65535 : 0;
+
+    uca_frame_info_init (&info, n, 1, 16);
+    info.sequence = 3;
+    g_assert (uca_filter_process (trigger, data16, &info, NULL));
+
+    for (guint i = 0; i < n; i++)
+        data16[i] = i % 3 ? 0 : 65535;
+
+    info.sequence = 4;
+    g_assert (uca_filter_process (trigger, data16, &info, NULL));
+    g_object_get (G_OBJECT (trigger), "last-value", &value, NULL);
+    g_assert_cmpfloat (value, ==, 65535.0 * 65535.0);
+
+    g_free (data8);
+    g_free (data16);
+    g_object_unref (trigger);
+}
+
+int
+main (int argc, char *argv[])
+{
+#if !(GLIB_CHECK_VERSION (2, 36, 0))
+    g_type_init ();
+#endif
+
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/filter/dark/8", test_dark_8);
+    g_test_add_func ("/filter/dark/16", test_dark_16);
+    g_test_add_func ("/filter/dark/wide", test_dark_wide);
+    g_test_add_func ("/filter/dark/mismatch", test_dark_mismatch);
+    g_test_add_func ("/filter/hot-pixel", test_hot_pixel);
+    g_test_add_func ("/filter/flat-field", test_flat_field);
+    g_test_add_func ("/filter/binning", test_binning);
+    g_test_add_func ("/filter/binning/wide", test_binning_wide);
+    g_test_add_func ("/filter/roi", test_roi);
+    g_test_add_func ("/filter/accumulator", test_accumulator);
+    g_test_add_func ("/filter/accumulator/wide", test_accumulator_wide);
+    g_test_add_func ("/filter/content-trigger", test_content_trigger);
+    g_test_add_func ("/filter/content-trigger/wide", test_content_trigger_wide);
+
+    return g_test_run ();
+}
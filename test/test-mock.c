@@ -1,6 +1,12 @@
 
 #include <glib.h>
+#include <string.h>
 #include "uca-camera.h"
+#include "uca-accumulator.h"
+#include "uca-binning-filter.h"
+#include "uca-content-trigger.h"
+#include "uca-dark-filter.h"
+#include "uca-flat-field-filter.h"
 #include "uca-plugin-manager.h"
 
 typedef struct {
@@ -129,30 +135,1026 @@ test_recording_async (Fixture *fixture, gconstpointer data)
     g_assert_cmpint (count, ==, 2);
 }
 
+typedef struct {
+    GMutex lock;
+    GHashTable *threads;
+    guint count;
+} DeliveryData;
+
+static void
+slow_grab_func (gpointer data, gpointer user_data)
+{
+    DeliveryData *delivery = user_data;
+
+    g_usleep (G_USEC_PER_SEC / 10);
+
+    g_mutex_lock (&delivery->lock);
+    g_hash_table_insert (delivery->threads, g_thread_self (), NULL);
+    delivery->count++;
+    g_mutex_unlock (&delivery->lock);
+}
+
+static void
+test_recording_async_delivery (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    DeliveryData delivery;
+    GError *error = NULL;
+    guint64 drops;
+
+    g_mutex_init (&delivery.lock);
+    delivery.threads = g_hash_table_new (g_direct_hash, g_direct_equal);
+    delivery.count = 0;
+
+    uca_camera_set_grab_func (camera, slow_grab_func, &delivery);
+
+    /* Buffers are only lent out while recording */
+    g_assert (uca_camera_get_delivery_buffer (camera) == NULL);
+
+    /*
+     * Four workers taking 100 ms per frame keep up with at most 40 frames per
+     * second, so they all get busy and the queue overflows
+     */
+    g_object_set (G_OBJECT (camera),
+                  "frames-per-second", 200.0,
+                  "transfer-asynchronously", TRUE,
+                  "delivery-threads", 4,
+                  "delivery-queue-length", 4,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_usleep (G_USEC_PER_SEC / 4);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_get (G_OBJECT (camera), "delivery-drops", &drops, NULL);
+    g_assert_cmpuint (drops, >, 0);
+    g_assert_cmpuint (delivery.count, >, 0);
+    g_assert_cmpuint (g_hash_table_size (delivery.threads), >, 1);
+
+    g_hash_table_destroy (delivery.threads);
+    g_mutex_clear (&delivery.lock);
+}
+
+static void
+test_recording_property (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+
+    gboolean is_recording = FALSE;
+    uca_camera_start_recording (camera, NULL);
+    g_object_get (G_OBJECT (camera), "is-recording", &is_recording, NULL);
+    g_assert (is_recording == TRUE);
+    g_assert (uca_camera_is_recording (camera));
+
+    uca_camera_stop_recording (camera, NULL);
+    g_object_get (G_OBJECT (camera), "is-recording", &is_recording, NULL);
+    g_assert (is_recording == FALSE);
+    g_assert (!uca_camera_is_recording (camera));
+}
+
+static void
+test_recording_buffered (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    gsize buffer_size;
+    gchar *buffer;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    buffer_size = width * height * (bitdepth <= 8 ? 1 : 2);
+    buffer = g_malloc0 (buffer_size);
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 5,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (int i = 0; i < 10; i++) {
+        g_assert (uca_camera_grab (camera, (gpointer) buffer, &error));
+        g_assert_no_error (error);
+    }
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (buffer);
+}
+
+static void
+test_recording_buffered_borrow (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    gpointer frame;
+    guint64 last_sequence = 0;
+    gint64 last_timestamp = 0;
+
+    g_assert (!uca_camera_grab_borrow (camera, &frame, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED);
+    g_clear_error (&error);
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 2,
+                  "exposure-time", 0.001,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (int i = 0; i < 10; i++) {
+        UcaRingBufferMetadata metadata;
+
+        g_assert (uca_camera_grab_borrow (camera, &frame, &error));
+        g_assert_no_error (error);
+        g_assert (frame != NULL);
+
+        uca_camera_get_last_metadata (camera, &metadata);
+        g_assert (i == 0 || metadata.sequence > last_sequence);
+        g_assert (metadata.timestamp > last_timestamp);
+        g_assert_cmpfloat (metadata.exposure_time, ==, 0.001);
+        last_sequence = metadata.sequence;
+        last_timestamp = metadata.timestamp;
+
+        uca_camera_grab_release (camera, frame);
+    }
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+}
+
+static void
+test_recording_grab_many (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    UcaRingBufferMetadata metadata;
+    gpointer frames[4];
+    guint width, height, bitdepth;
+    gsize size;
+    guint n_done;
+    gchar *buffer;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    size = width * height * (bitdepth <= 8 ? 1 : 2);
+    buffer = g_malloc0 (4 * size);
+
+    for (guint i = 0; i < 4; i++)
+        frames[i] = buffer + i * size;
+
+    g_assert (!uca_camera_grab_many (camera, frames, 4, &n_done, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING);
+    g_assert_cmpuint (n_done, ==, 0);
+    g_clear_error (&error);
+
+    g_object_set (G_OBJECT (camera), "exposure-time", 0.001, NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_assert (uca_camera_grab_many (camera, frames, 4, &n_done, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (n_done, ==, 4);
+
+    uca_camera_get_last_metadata (camera, &metadata);
+    g_assert_cmpuint (metadata.sequence, ==, 3);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_set (G_OBJECT (camera), "buffered", TRUE, NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_assert (uca_camera_grab_many (camera, frames, 4, NULL, &error));
+    g_assert_no_error (error);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (buffer);
+}
+
+typedef struct {
+    GMainLoop *loop;
+    gboolean success;
+    GError *error;
+} GrabAsyncData;
+
+static void
+on_grab_ready (GObject *source, GAsyncResult *result, gpointer user_data)
+{
+    GrabAsyncData *data = user_data;
+
+    data->success = uca_camera_grab_finish (UCA_CAMERA (source), result, &data->error);
+    g_main_loop_quit (data->loop);
+}
+
+static gboolean
+cancel_grab (gpointer cancellable)
+{
+    g_cancellable_cancel (G_CANCELLABLE (cancellable));
+    return FALSE;
+}
+
+static void
+test_recording_grab_async (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    GCancellable *cancellable;
+    GrabAsyncData grab_data;
+    guint width, height, bitdepth;
+    gchar *buffer;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    buffer = g_malloc0 (width * height * (bitdepth <= 8 ? 1 : 2));
+    grab_data.loop = g_main_loop_new (NULL, FALSE);
+    grab_data.error = NULL;
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    uca_camera_grab_async (camera, buffer, NULL, on_grab_ready, &grab_data);
+    g_main_loop_run (grab_data.loop);
+    g_assert (grab_data.success);
+    g_assert_no_error (grab_data.error);
+
+    cancellable = g_cancellable_new ();
+    g_cancellable_cancel (cancellable);
+
+    uca_camera_grab_async (camera, buffer, cancellable, on_grab_ready, &grab_data);
+    g_main_loop_run (grab_data.loop);
+    g_assert (!grab_data.success);
+    g_assert_error (grab_data.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_clear_error (&grab_data.error);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+    g_object_unref (cancellable);
+
+    /* Cancelling interrupts a buffered grab that waits for a frame */
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    cancellable = g_cancellable_new ();
+    g_timeout_add (50, cancel_grab, cancellable);
+    uca_camera_grab_async (camera, buffer, cancellable, on_grab_ready, &grab_data);
+    g_main_loop_run (grab_data.loop);
+    g_assert (!grab_data.success);
+    g_assert_error (grab_data.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_clear_error (&grab_data.error);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_unref (cancellable);
+    g_main_loop_unref (grab_data.loop);
+    g_free (buffer);
+}
+
+static gboolean
+on_frame_ready (UcaCamera *camera, gpointer user_data)
+{
+    guint *n_frames = user_data;
+    GError *error = NULL;
+    gpointer frame;
+
+    g_assert (uca_camera_grab_borrow (camera, &frame, &error));
+    g_assert_no_error (error);
+    uca_camera_grab_release (camera, frame);
+    (*n_frames)++;
+
+    return TRUE;
+}
+
+static void
+test_recording_buffered_frame_source (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    GMainContext *context;
+    GSource *source;
+    guint n_frames = 0;
+
+    source = uca_camera_frame_source_new (camera);
+
+    if (source == NULL) {
+        g_test_message ("Frame sources are not supported on this platform");
+        return;
+    }
+
+    g_assert_cmpint (uca_camera_get_frame_fd (camera), >=, 0);
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 4,
+                  "exposure-time", 0.001,
+                  NULL);
+
+    context = g_main_context_new ();
+    g_source_set_callback (source, (GSourceFunc) on_frame_ready, &n_frames, NULL);
+    g_source_attach (source, context);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    while (n_frames < 10)
+        g_main_context_iteration (context, TRUE);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_source_destroy (source);
+    g_source_unref (source);
+    g_main_context_unref (context);
+}
+
+static gpointer
+grab_until_stopped (UcaCamera *camera)
+{
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    gchar *buffer;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    buffer = g_malloc0 (width * height * (bitdepth <= 8 ? 1 : 2));
+    uca_camera_grab (camera, buffer, &error);
+    g_free (buffer);
+
+    return error;
+}
+
+static void
+test_recording_stop_latency (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    GThread *thread;
+    GTimer *timer;
+
+    timer = g_timer_new ();
+
+    /* A grab waiting for a software trigger that never comes */
+    g_object_set (G_OBJECT (camera),
+                  "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    thread = g_thread_new (NULL, (GThreadFunc) grab_until_stopped, camera);
+    g_usleep (G_USEC_PER_SEC / 100);
+
+    g_timer_start (timer);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    error = g_thread_join (thread);
+    g_assert_cmpfloat (g_timer_elapsed (timer, NULL), <, 0.05);
+    g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_clear_error (&error);
+
+    /* The read thread in the middle of a long exposure */
+    g_object_set (G_OBJECT (camera),
+                  "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_AUTO,
+                  "exposure-time", 10.0,
+                  "buffered", TRUE,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_usleep (G_USEC_PER_SEC / 100);
+
+    g_timer_start (timer);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert_cmpfloat (g_timer_elapsed (timer, NULL), <, 0.05);
+
+    g_timer_destroy (timer);
+}
+
+static void
+test_recording_grab_frame (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    gint64 last_end_time = 0;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    g_assert (uca_camera_grab_frame (camera, &error) == NULL);
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING);
+    g_clear_error (&error);
+
+    g_object_set (G_OBJECT (camera), "exposure-time", 0.001, NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (guint i = 0; i < 3; i++) {
+        UcaFrame *frame;
+        const UcaFrameInfo *info;
+
+        frame = uca_camera_grab_frame (camera, &error);
+        g_assert_no_error (error);
+        g_assert (frame != NULL);
+
+        info = uca_frame_get_info (frame);
+        g_assert_cmpuint (info->width, ==, width);
+        g_assert_cmpuint (info->height, ==, height);
+        g_assert_cmpuint (info->bitdepth, ==, bitdepth);
+        g_assert_cmpuint (info->stride, ==, width * (bitdepth <= 8 ? 1 : 2));
+        g_assert_cmpuint (uca_frame_get_size (frame), ==, info->stride * height);
+        g_assert_cmpuint (info->sequence, ==, i);
+        g_assert_cmpint (info->start_time, <=, info->end_time);
+        g_assert_cmpint (info->start_time, >=, last_end_time);
+
+        last_end_time = info->end_time;
+        uca_frame_unref (frame);
+    }
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+}
+
+static void
+test_recording_queued_properties (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    UcaFrame *frame;
+    UcaFrameInfo *info;
+    GError *error = NULL;
+    guint width, roi_width;
+    guint serial;
+
+    g_object_set (G_OBJECT (camera), "exposure-time", 0.001, NULL);
+    g_object_get (G_OBJECT (camera), "roi-width", &width, NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    frame = uca_camera_grab_frame (camera, &error);
+    g_assert_no_error (error);
+    serial = uca_frame_get_info (frame)->settings_serial;
+    uca_frame_unref (frame);
+
+    /* The change is only applied before the next frame */
+    g_object_set (G_OBJECT (camera), "roi-width", width / 2, NULL);
+    g_object_get (G_OBJECT (camera), "roi-width", &roi_width, NULL);
+    g_assert_cmpuint (roi_width, ==, width);
+
+    frame = uca_camera_grab_frame (camera, &error);
+    g_assert_no_error (error);
+    info = uca_frame_get_info (frame);
+    g_assert_cmpuint (info->width, ==, width / 2);
+    g_assert_cmpuint (info->settings_serial, ==, serial + 1);
+    g_assert_cmpuint (uca_frame_get_size (frame), ==, info->stride * info->height);
+    uca_frame_unref (frame);
+
+    g_object_get (G_OBJECT (camera), "roi-width", &roi_width, NULL);
+    g_assert_cmpuint (roi_width, ==, width / 2);
+
+#if (GLIB_CHECK_VERSION (2, 34, 0))
+    /* Frames must not outgrow the size they were allocated for */
+    g_object_set (G_OBJECT (camera), "roi-width", width * 2, NULL);
+    g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "Could not apply queued properties*");
+    frame = uca_camera_grab_frame (camera, &error);
+    g_test_assert_expected_messages ();
+    g_assert_no_error (error);
+    info = uca_frame_get_info (frame);
+    g_assert_cmpuint (info->width, ==, width / 2);
+    g_assert_cmpuint (info->settings_serial, ==, serial + 1);
+    uca_frame_unref (frame);
+#endif
+
+    /* Whatever is left is applied when recording stops */
+    g_object_set (G_OBJECT (camera), "roi-width", width, NULL);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_get (G_OBJECT (camera), "roi-width", &roi_width, NULL);
+    g_assert_cmpuint (roi_width, ==, width);
+}
+
+static void
+test_recording_immediate_properties (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    const gchar *names[] = { "num-buffers" };
+    GValue values[1] = {{0}};
+    GError *error = NULL;
+    gdouble fps;
+    gboolean success;
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* The frame rate changes right away as it always did */
+    g_object_set (G_OBJECT (camera), "frames-per-second", 25.0, NULL);
+    g_object_get (G_OBJECT (camera), "frames-per-second", &fps, NULL);
+    g_assert_cmpfloat (fps, >, 24.999);
+    g_assert_cmpfloat (fps, <, 25.001);
+
+    /* Recording setup cannot be queued and must not be dropped silently */
+    g_value_init (&values[0], G_TYPE_UINT);
+    g_value_set_uint (&values[0], 16);
+    success = uca_camera_set_properties (camera, 1, names, values, &error);
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY);
+    g_assert (!success);
+    g_clear_error (&error);
+    g_value_unset (&values[0]);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+}
+
+static void
+test_recording_buffered_restart (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    gchar *buffer;
+    gpointer frame;
+    gchar first;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    buffer = g_malloc0 (width * height * (bitdepth <= 8 ? 1 : 2));
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 2,
+                  "exposure-time", 0.001,
+                  NULL);
+
+    for (int i = 0; i < 3; i++) {
+        uca_camera_start_recording (camera, &error);
+        g_assert_no_error (error);
+        g_assert (uca_camera_grab (camera, (gpointer) buffer, &error));
+        g_assert_no_error (error);
+        uca_camera_stop_recording (camera, &error);
+        g_assert_no_error (error);
+    }
+
+    g_assert (!uca_camera_grab (camera, (gpointer) buffer, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING);
+    g_clear_error (&error);
+
+    /* A frame borrowed across recordings survives reallocation */
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab_borrow (camera, &frame, &error));
+    g_assert_no_error (error);
+    first = ((gchar *) frame)[0];
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* A smaller ROI must resize the buffer so that grabs copy less */
+    g_object_set (G_OBJECT (camera), "roi-width", width / 2, "num-buffers", 3, NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab (camera, (gpointer) buffer, &error));
+    g_assert_no_error (error);
+    g_assert (((gchar *) frame)[0] == first);
+    uca_camera_grab_release (camera, frame);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (buffer);
+}
+
+static void
+test_recording_buffered_overruns (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    gpointer frame;
+    guint64 overruns;
+    guint max_fill;
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 2,
+                  "exposure-time", 0.001,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Let the read thread lap the consumer */
+    g_usleep (G_USEC_PER_SEC / 10);
+
+    g_assert (uca_camera_grab_borrow (camera, &frame, &error));
+    g_assert_no_error (error);
+    uca_camera_grab_release (camera, frame);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_get (G_OBJECT (camera),
+                  "buffer-overruns", &overruns,
+                  "buffer-max-fill", &max_fill,
+                  NULL);
+
+    g_assert_cmpuint (overruns, >, 0);
+    g_assert_cmpuint (max_fill, ==, 2);
+}
+
+static void
+test_recording_buffered_filters (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    GError *error = NULL;
+    guint8 *dark;
+    guint64 last_sequence = 0;
+
+    /* Subtracting a saturated dark frame must clear every frame */
+    uca_camera_get_frame_info (camera, &info);
+    dark = g_malloc (uca_frame_info_get_size (&info));
+    memset (dark, 0xff, uca_frame_info_get_size (&info));
+
+    filter = uca_dark_filter_new ();
+    uca_dark_filter_set_dark (UCA_DARK_FILTER (filter), dark, &info);
+    uca_camera_add_filter (camera, filter);
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "buffer-policy", UCA_RING_BUFFER_POLICY_BLOCK_PRODUCER,
+                  "filter-threads", 3,
+                  "exposure-time", 0.001,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (guint i = 0; i < 10; i++) {
+        UcaRingBufferMetadata metadata;
+        gpointer frame;
+        guint8 *pixels;
+
+        g_assert (uca_camera_grab_borrow (camera, &frame, &error));
+        g_assert_no_error (error);
+
+        pixels = frame;
+        g_assert (pixels[0] == 0);
+        g_assert (pixels[uca_frame_info_get_size (&info) - 1] == 0);
+
+        /* Frames must come out in the order they were grabbed */
+        uca_camera_get_last_metadata (camera, &metadata);
+        g_assert (i == 0 || metadata.sequence == last_sequence + 1);
+        last_sequence = metadata.sequence;
+
+        uca_camera_grab_release (camera, frame);
+    }
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Removed filters are not applied to the next recording */
+    uca_camera_remove_filter (camera, filter);
+    g_object_set (G_OBJECT (camera), "buffered", FALSE, NULL);
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab (camera, dark, &error));
+    g_assert_no_error (error);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_unref (filter);
+    g_free (dark);
+}
+
 static void
-test_recording_property (Fixture *fixture, gconstpointer data)
+test_recording_flat_field (Fixture *fixture, gconstpointer data)
 {
     UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    UcaFilter *filter;
+    UcaFrameInfo info;
+    GError *error = NULL;
+    gpointer frame;
+    gfloat *output;
 
-    gboolean is_recording = FALSE;
-    uca_camera_start_recording (camera, NULL);
-    g_object_get (G_OBJECT (camera), "is-recording", &is_recording, NULL);
-    g_assert (is_recording == TRUE);
-    g_assert (uca_camera_is_recording (camera));
+    filter = uca_flat_field_filter_new ();
+    uca_camera_add_filter (camera, filter);
+    uca_camera_get_frame_info (camera, &info);
+    frame = g_malloc (uca_frame_info_get_size (&info));
+    output = g_new (gfloat, info.width * info.height);
 
-    uca_camera_stop_recording (camera, NULL);
-    g_object_get (G_OBJECT (camera), "is-recording", &is_recording, NULL);
-    g_assert (is_recording == FALSE);
-    g_assert (!uca_camera_is_recording (camera));
+    g_assert (!uca_flat_field_filter_acquire (UCA_FLAT_FIELD_FILTER (filter), camera, UCA_FLAT_FIELD_DARK, 2, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING);
+    g_clear_error (&error);
+
+    g_object_set (G_OBJECT (camera), "exposure-time", 0.001, NULL);
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_assert (uca_flat_field_filter_acquire (UCA_FLAT_FIELD_FILTER (filter), camera, UCA_FLAT_FIELD_DARK, 2, &error));
+    g_assert_no_error (error);
+    g_assert (uca_flat_field_filter_acquire (UCA_FLAT_FIELD_FILTER (filter), camera, UCA_FLAT_FIELD_FLAT, 2, &error));
+    g_assert_no_error (error);
+
+    /* Frames are corrected in the chain now */
+    g_assert (uca_camera_grab (camera, frame, &error));
+    g_assert_no_error (error);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_assert (uca_flat_field_filter_correct (UCA_FLAT_FIELD_FILTER (filter), frame, &info, output, &error));
+    g_assert_no_error (error);
+
+    g_object_unref (filter);
+    g_free (output);
+    g_free (frame);
 }
 
 static void
-test_recording_buffered (Fixture *fixture, gconstpointer data)
+test_recording_buffered_binning (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    UcaFilter *filter;
+    UcaFrame *frame;
+    UcaFrameInfo info;
+    UcaRingBufferMetadata metadata;
+    GError *error = NULL;
+    gpointer block;
+
+    uca_camera_get_frame_info (camera, &info);
+    filter = uca_binning_filter_new (2, 2);
+    uca_camera_add_filter (camera, filter);
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "exposure-time", 0.001,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Frames in the ring buffer are compact */
+    frame = uca_camera_grab_frame (camera, &error);
+    g_assert_no_error (error);
+    g_assert_cmpuint (uca_frame_get_info (frame)->width, ==, info.width / 2);
+    g_assert_cmpuint (uca_frame_get_info (frame)->height, ==, info.height / 2);
+    g_assert_cmpuint (uca_frame_get_size (frame), ==, uca_frame_info_get_size (&info) / 4);
+    g_assert_cmpuint (uca_frame_get_info (frame)->bitdepth, ==, info.bitdepth);
+    uca_frame_unref (frame);
+
+    /* Borrowed blocks record the size of the frame they hold */
+    g_assert (uca_camera_grab_borrow (camera, &block, &error));
+    g_assert_no_error (error);
+    uca_camera_get_last_metadata (camera, &metadata);
+    g_assert_cmpuint (metadata.size, ==, uca_frame_info_get_size (&info) / 4);
+    g_assert_cmpuint (metadata.bitdepth, ==, info.bitdepth);
+    uca_camera_grab_release (camera, block);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_unref (filter);
+}
+
+static void
+test_recording_accumulator (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    UcaAccumulator *accumulator;
+    UcaFilter *binning;
+    UcaFrameInfo info;
+    UcaFrame *frame;
+    guint64 count;
+    GError *error = NULL;
+
+    uca_camera_get_frame_info (camera, &info);
+    accumulator = uca_accumulator_new ();
+    uca_camera_add_filter (camera, UCA_FILTER (accumulator));
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "exposure-time", 0.001,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Every frame passing the chain has been accumulated once grabbed */
+    for (guint i = 0; i < 3; i++) {
+        frame = uca_camera_grab_frame (camera, &error);
+        g_assert_no_error (error);
+        uca_frame_unref (frame);
+    }
+
+    g_assert_cmpuint (uca_accumulator_get_count (accumulator), >=, 3);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Frames acquired while the accumulator is in the chain count once */
+    uca_accumulator_reset (accumulator);
+    g_object_set (G_OBJECT (camera), "buffered", FALSE, NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_accumulator_acquire (accumulator, camera, 4, &error));
+    g_assert_no_error (error);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    count = uca_accumulator_get_count (accumulator);
+    g_assert_cmpuint (count, ==, 4);
+    uca_camera_remove_filter (camera, UCA_FILTER (accumulator));
+
+    frame = uca_accumulator_get_frame (accumulator, UCA_ACCUMULATOR_MEAN);
+    g_assert_cmpuint (uca_frame_get_info (frame)->width, ==, info.width);
+    g_assert_cmpuint (uca_frame_get_info (frame)->height, ==, info.height);
+    uca_frame_unref (frame);
+
+    /* Outside the chain, frames are added as other filters left them */
+    binning = uca_binning_filter_new (2, 2);
+    uca_camera_add_filter (camera, binning);
+    uca_accumulator_reset (accumulator);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_accumulator_acquire (accumulator, camera, 2, &error));
+    g_assert_no_error (error);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_assert_cmpuint (uca_accumulator_get_count (accumulator), ==, 2);
+    frame = uca_accumulator_get_frame (accumulator, UCA_ACCUMULATOR_MEAN);
+    g_assert_cmpuint (uca_frame_get_info (frame)->width, ==, info.width / 2);
+    uca_frame_unref (frame);
+
+    uca_camera_remove_filter (camera, binning);
+    g_object_unref (binning);
+    g_object_unref (accumulator);
+}
+
+static void
+test_recording_buffered_event_gating (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    UcaFilter *trigger;
+    UcaFrame *frame;
+    guint64 events;
+    guint max_fill;
+    GError *error = NULL;
+
+    /* Every frame exceeds a threshold of zero */
+    trigger = uca_content_trigger_new (UCA_CONTENT_TRIGGER_MEAN, 0.0);
+    uca_camera_add_filter (camera, trigger);
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "exposure-time", 0.001,
+                  "event-gating", TRUE,
+                  "event-pre-frames", 2,
+                  "event-post-frames", 1,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    frame = uca_camera_grab_frame (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_frame_get_info (frame)->flags & UCA_FRAME_FLAG_TRIGGERED);
+    uca_frame_unref (frame);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* No frame exceeds the maximum, so none reaches the ring buffer */
+    g_object_set (G_OBJECT (trigger), "threshold", G_MAXDOUBLE, NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_usleep (G_USEC_PER_SEC / 20);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_get (G_OBJECT (trigger), "events", &events, NULL);
+    g_object_get (G_OBJECT (camera), "buffer-max-fill", &max_fill, NULL);
+    g_assert_cmpuint (events, >, 0);
+    g_assert_cmpuint (max_fill, ==, 0);
+
+    uca_camera_remove_filter (camera, trigger);
+    g_object_unref (trigger);
+}
+
+static void
+test_recording_buffered_grab_latest (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    UcaFrame *frame;
+    guint64 sequence;
+    guint64 skipped;
+    GError *error = NULL;
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 8,
+                  "exposure-time", 0.001,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Let frames pile up in the ring buffer */
+    g_usleep (G_USEC_PER_SEC / 20);
+
+    /* Switching takes effect immediately, even while recording */
+    g_object_set (G_OBJECT (camera), "grab-mode", UCA_CAMERA_GRAB_MODE_LATEST, NULL);
+
+    frame = uca_camera_grab_frame (camera, &error);
+    g_assert_no_error (error);
+    sequence = uca_frame_get_info (frame)->sequence;
+    uca_frame_unref (frame);
+
+    g_object_get (G_OBJECT (camera), "grab-skipped", &skipped, NULL);
+    g_assert_cmpuint (skipped, >, 0);
+    g_assert_cmpuint (sequence, >=, skipped);
+
+    frame = uca_camera_grab_frame (camera, &error);
+    g_assert_no_error (error);
+    g_assert_cmpuint (uca_frame_get_info (frame)->sequence, >, sequence);
+    uca_frame_unref (frame);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+}
+
+typedef struct {
+    UcaCamera *camera;
+    gboolean result;
+    GError *error;
+} FreezeData;
+
+static gpointer
+freeze_thread (FreezeData *data)
+{
+    data->result = uca_camera_freeze (data->camera, 3, &data->error);
+    return NULL;
+}
+
+static void
+test_recording_buffered_freeze (Fixture *fixture, gconstpointer data)
 {
     UcaCamera *camera = UCA_CAMERA (fixture->camera);
     GError *error = NULL;
+    UcaRingBufferMetadata metadata;
+    FreezeData freeze_data;
+    GThread *thread;
     guint width, height, bitdepth;
-    gsize buffer_size;
+    guint64 first_sequence = 0;
     gchar *buffer;
 
     g_object_get (G_OBJECT (camera),
@@ -161,29 +1163,66 @@ test_recording_buffered (Fixture *fixture, gconstpointer data)
                   "sensor-bitdepth", &bitdepth,
                   NULL);
 
-    buffer_size = width * height * (bitdepth <= 8 ? 1 : 2);
-    buffer = g_malloc0 (buffer_size);
+    buffer = g_malloc0 (width * height * (bitdepth <= 8 ? 1 : 2));
 
     g_object_set (G_OBJECT (camera),
                   "buffered", TRUE,
-                  "num-buffers", 5,
+                  "num-buffers", 8,
+                  "exposure-time", 0.001,
                   NULL);
 
+    g_assert (!uca_camera_freeze (camera, 3, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING);
+    g_clear_error (&error);
+
     uca_camera_start_recording (camera, &error);
     g_assert_no_error (error);
 
-    for (int i = 0; i < 10; i++) {
-        g_assert (uca_camera_grab (camera, (gpointer) buffer, &error));
+    /* Fill the buffer with pre-event frames */
+    g_usleep (G_USEC_PER_SEC / 20);
+
+    g_assert (uca_camera_freeze (camera, 3, &error));
+    g_assert_no_error (error);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (guint i = 0; i < 8; i++) {
+        g_assert (uca_camera_readout (camera, buffer, i, &error));
         g_assert_no_error (error);
+
+        uca_camera_get_last_metadata (camera, &metadata);
+
+        if (i == 0)
+            first_sequence = metadata.sequence;
+
+        g_assert_cmpuint (metadata.sequence, ==, first_sequence + i);
     }
 
+    g_assert (!uca_camera_readout (camera, buffer, 8, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM);
+    g_clear_error (&error);
+
+    /* Stopping must not wait for post-event frames that never come */
+    g_object_set (G_OBJECT (camera), "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE, NULL);
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    freeze_data.camera = camera;
+    freeze_data.error = NULL;
+    thread = g_thread_new ("freeze", (GThreadFunc) freeze_thread, &freeze_data);
+    g_usleep (G_USEC_PER_SEC / 20);
+
     uca_camera_stop_recording (camera, &error);
     g_assert_no_error (error);
+    g_thread_join (thread);
+    g_assert (!freeze_data.result);
+    g_assert (freeze_data.error != NULL);
+    g_clear_error (&freeze_data.error);
 
     g_free (buffer);
 }
 
-
 static void
 test_base_properties (Fixture *fixture, gconstpointer data)
 {
@@ -201,6 +1240,99 @@ test_base_properties (Fixture *fixture, gconstpointer data)
     g_free (properties);
 }
 
+static void
+test_geometry (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    UcaCameraGeometry geometry;
+    guint width, height, bitdepth;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    uca_camera_get_geometry (camera, &geometry);
+    g_assert_cmpuint (geometry.width, ==, width);
+    g_assert_cmpuint (geometry.height, ==, height);
+    g_assert_cmpuint (geometry.bitdepth, ==, bitdepth);
+    g_assert_cmpuint (geometry.pixel_size, ==, bitdepth <= 8 ? 1 : 2);
+    g_assert_cmpuint (uca_camera_get_frame_size (camera), ==, width * height * geometry.pixel_size);
+
+    /* The cached geometry must follow property changes */
+    g_object_set (G_OBJECT (camera), "roi-width", width / 2, NULL);
+    uca_camera_get_geometry (camera, &geometry);
+    g_assert_cmpuint (geometry.width, ==, width / 2);
+    g_assert_cmpuint (uca_camera_get_frame_size (camera), ==, width / 2 * height * geometry.pixel_size);
+
+    g_object_set (G_OBJECT (camera), "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE, NULL);
+    g_assert_cmpint (uca_camera_get_trigger_source (camera), ==, UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE);
+}
+
+static void
+test_set_properties (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    const gchar *names[] = { "roi-x0", "roi-width", "exposure-time" };
+    GValue values[3] = {{0}};
+    GError *error = NULL;
+    guint sensor_width, roi_x, roi_width;
+    gdouble exposure_time;
+    gboolean success;
+
+    g_object_get (G_OBJECT (camera), "sensor-width", &sensor_width, NULL);
+
+    g_value_init (&values[0], G_TYPE_UINT);
+    g_value_init (&values[1], G_TYPE_UINT);
+    g_value_init (&values[2], G_TYPE_DOUBLE);
+    g_value_set_uint (&values[0], sensor_width / 4);
+    g_value_set_uint (&values[1], sensor_width / 2);
+    g_value_set_double (&values[2], 0.25);
+
+    success = uca_camera_set_properties (camera, 3, names, values, &error);
+    g_assert_no_error (error);
+    g_assert (success);
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-x0", &roi_x,
+                  "roi-width", &roi_width,
+                  "exposure-time", &exposure_time,
+                  NULL);
+    g_assert_cmpuint (roi_x, ==, sensor_width / 4);
+    g_assert_cmpuint (roi_width, ==, sensor_width / 2);
+    g_assert_cmpfloat (exposure_time, ==, 0.25);
+
+    /* A region outside the sensor is rejected as a whole */
+    g_value_set_uint (&values[1], sensor_width);
+    g_value_set_double (&values[2], 0.5);
+    success = uca_camera_set_properties (camera, 3, names, values, &error);
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY);
+    g_assert (!success);
+    g_clear_error (&error);
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &roi_width,
+                  "exposure-time", &exposure_time,
+                  NULL);
+    g_assert_cmpuint (roi_width, ==, sensor_width / 2);
+    g_assert_cmpfloat (exposure_time, ==, 0.25);
+
+    /* Unknown properties are caught before anything is set */
+    names[1] = "no-such-property";
+    success = uca_camera_set_properties (camera, 3, names, values, &error);
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY);
+    g_assert (!success);
+    g_clear_error (&error);
+
+    g_object_get (G_OBJECT (camera), "exposure-time", &exposure_time, NULL);
+    g_assert_cmpfloat (exposure_time, ==, 0.25);
+    g_assert (!uca_camera_is_batch_pending (camera));
+
+    for (guint i = 0; i < 3; i++)
+        g_value_unset (&values[i]);
+}
+
 static void
 test_fps_property (Fixture *fixture, gconstpointer data)
 {
@@ -248,10 +1380,34 @@ test_overwriting_units (Fixture *fixture, gconstpointer data)
     uca_camera_register_unit (fixture->camera, "sensor-width", UCA_UNIT_PIXEL);
 }
 
+static void
+test_thread_setup (Fixture *fixture, gconstpointer data)
+{
+    GError *error = NULL;
+    gint numa_node;
+
+    /* Threads are left alone by default */
+    g_object_get (fixture->camera, "thread-numa-node", &numa_node, NULL);
+    g_assert_cmpint (numa_node, ==, -1);
+    g_assert (uca_camera_setup_thread (fixture->camera, &error));
+    g_assert_no_error (error);
+
+    g_object_set (fixture->camera, "thread-cpus", "3-1", NULL);
+    g_assert (!uca_camera_setup_thread (fixture->camera, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY);
+    g_clear_error (&error);
+
+    g_object_set (fixture->camera, "thread-cpus", "0,", NULL);
+    g_assert (!uca_camera_setup_thread (fixture->camera, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_PROPERTY);
+    g_clear_error (&error);
+}
+
 static void
 test_can_be_written (Fixture *fixture, gconstpointer data)
 {
     GError *error = NULL;
+    guint roi_x;
 
     /* read-only cannot ever be written */
     g_assert (!uca_camera_is_writable_during_acquisition (fixture->camera, "name"));
@@ -271,14 +1427,18 @@ test_can_be_written (Fixture *fixture, gconstpointer data)
     uca_camera_start_recording (fixture->camera, &error);
     g_assert_no_error (error);
     g_object_set (fixture->camera, "roi-height", 128, NULL);
-#if (GLIB_CHECK_VERSION (2, 34, 0))
+
+    /* Other properties are queued until the recording stops */
     uca_camera_set_writable (fixture->camera, "roi-x0", FALSE);
-    g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "Property 'roi-x0' cant be changed during acquisition");
     g_object_set (fixture->camera, "roi-x0", 64, NULL);
-    g_test_assert_expected_messages ();
-#endif
+    g_object_get (fixture->camera, "roi-x0", &roi_x, NULL);
+    g_assert_cmpuint (roi_x, ==, 0);
+
     uca_camera_stop_recording (fixture->camera, &error);
     g_assert_no_error (error);
+
+    g_object_get (fixture->camera, "roi-x0", &roi_x, NULL);
+    g_assert_cmpuint (roi_x, ==, 64);
 }
 
 static void
@@ -316,6 +1476,78 @@ test_factory_hashtable (Fixture *fixture, gconstpointer data)
     g_object_unref(camera);
 }
 
+#define N_CAMERAS           4
+#define N_FRAMES_PER_CAMERA 10
+#define MULTI_EXPOSURE_TIME 0.01
+
+static gpointer
+grab_frames (UcaCamera *camera)
+{
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    gchar *buffer;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    buffer = g_malloc0 (width * height * (bitdepth <= 8 ? 1 : 2));
+
+    for (guint i = 0; i < N_FRAMES_PER_CAMERA; i++) {
+        g_assert (uca_camera_grab (camera, buffer, &error));
+        g_assert_no_error (error);
+    }
+
+    g_free (buffer);
+    return NULL;
+}
+
+static void
+test_recording_multiple_cameras (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *cameras[N_CAMERAS];
+    GThread *threads[N_CAMERAS];
+    GError *error = NULL;
+    GTimer *timer;
+    gdouble elapsed;
+    gdouble serial;
+
+    for (guint i = 0; i < N_CAMERAS; i++) {
+        cameras[i] = uca_plugin_manager_get_camera (fixture->manager, "mock", &error, NULL);
+        g_assert_no_error (error);
+
+        g_object_set (G_OBJECT (cameras[i]),
+                      "exposure-time", MULTI_EXPOSURE_TIME,
+                      NULL);
+
+        uca_camera_start_recording (cameras[i], &error);
+        g_assert_no_error (error);
+    }
+
+    timer = g_timer_new ();
+
+    for (guint i = 0; i < N_CAMERAS; i++)
+        threads[i] = g_thread_new (NULL, (GThreadFunc) grab_frames, cameras[i]);
+
+    for (guint i = 0; i < N_CAMERAS; i++)
+        g_thread_join (threads[i]);
+
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+
+    for (guint i = 0; i < N_CAMERAS; i++) {
+        uca_camera_stop_recording (cameras[i], &error);
+        g_assert_no_error (error);
+        g_object_unref (cameras[i]);
+    }
+
+    /* Independent cameras must not serialize on a shared lock */
+    serial = N_CAMERAS * N_FRAMES_PER_CAMERA * MULTI_EXPOSURE_TIME;
+    g_assert_cmpfloat (elapsed, <, 0.75 * serial);
+}
+
 int main (int argc, char *argv[])
 {
     gsize n_tests;
@@ -338,13 +1570,35 @@ int main (int argc, char *argv[])
         {"/recording", test_recording},
         {"/recording/signal", test_recording_signal},
         {"/recording/asynchronous", test_recording_async},
+        {"/recording/asynchronous/delivery", test_recording_async_delivery},
+        {"/recording/grab-many", test_recording_grab_many},
+        {"/recording/grab-async", test_recording_grab_async},
+        {"/recording/grab-frame", test_recording_grab_frame},
+        {"/recording/queued-properties", test_recording_queued_properties},
+        {"/recording/immediate-properties", test_recording_immediate_properties},
+        {"/recording/flat-field", test_recording_flat_field},
+        {"/recording/accumulator", test_recording_accumulator},
+        {"/recording/buffered/event-gating", test_recording_buffered_event_gating},
+        {"/recording/buffered/grab-latest", test_recording_buffered_grab_latest},
+        {"/recording/stop-latency", test_recording_stop_latency},
         {"/recording/buffered", test_recording_buffered},
+        {"/recording/buffered/borrow", test_recording_buffered_borrow},
+        {"/recording/buffered/restart", test_recording_buffered_restart},
+        {"/recording/buffered/overruns", test_recording_buffered_overruns},
+        {"/recording/buffered/freeze", test_recording_buffered_freeze},
+        {"/recording/buffered/filters", test_recording_buffered_filters},
+        {"/recording/buffered/binning", test_recording_buffered_binning},
+        {"/recording/buffered/frame-source", test_recording_buffered_frame_source},
+        {"/recording/multiple-cameras", test_recording_multiple_cameras},
         {"/properties/base", test_base_properties},
         {"/properties/recording", test_recording_property},
         {"/properties/frames-per-second", test_fps_property},
+        {"/properties/geometry", test_geometry},
+        {"/properties/set-many", test_set_properties},
         {"/properties/units", test_property_units},
         {"/properties/units/overwrite", test_overwriting_units},
         {"/properties/can-be-written", test_can_be_written},
+        {"/properties/thread-setup", test_thread_setup},
     };
 
     n_tests = sizeof(tests) / sizeof(tests[0]);
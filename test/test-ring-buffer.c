@@ -66,6 +66,72 @@ test_ring (void)
     g_assert (uca_ring_buffer_get_num_blocks (buffer) == 0);
 }
 
+static void
+test_proceed (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+
+    buffer = uca_ring_buffer_new (512, 2);
+
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 0xBADF00D;
+    uca_ring_buffer_write_advance (buffer);
+
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 0xDEADBEEF;
+    uca_ring_buffer_write_advance (buffer);
+
+    uca_ring_buffer_proceed (buffer);
+    g_assert (uca_ring_buffer_available (buffer));
+
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (data[0] == 0xDEADBEEF);
+
+    /* Proceeding on an empty buffer is a no-op */
+    uca_ring_buffer_proceed (buffer);
+    g_assert (!uca_ring_buffer_available (buffer));
+    g_object_unref (buffer);
+}
+
+static void
+test_stage (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+
+    buffer = uca_ring_buffer_new (512, 2);
+
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 0xBADF00D;
+    g_assert (uca_ring_buffer_write_stage (buffer));
+
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 0xDEADBEEF;
+    g_assert (uca_ring_buffer_write_stage (buffer));
+
+    /* Staged blocks are neither readable nor overwritten */
+    g_assert (!uca_ring_buffer_available (buffer));
+    g_assert (!uca_ring_buffer_wait_writable (buffer, 0));
+
+    uca_ring_buffer_commit (buffer);
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (data[0] == 0xBADF00D);
+    g_assert (!uca_ring_buffer_available (buffer));
+
+    /* The first block was read, so it can be reused */
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+
+    uca_ring_buffer_commit (buffer);
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (data[0] == 0xDEADBEEF);
+    g_assert (uca_ring_buffer_get_sequence (buffer, data) == 1);
+    g_assert (uca_ring_buffer_get_overruns (buffer) == 0);
+    g_object_unref (buffer);
+}
+
 static void
 test_overwrite (void)
 {
@@ -84,6 +150,404 @@ test_overwrite (void)
 
     data = uca_ring_buffer_get_read_pointer (buffer);
     g_assert (data[0] == 0xDEADBEEF);
+    g_assert (uca_ring_buffer_get_sequence (buffer, data) == 1);
+    g_assert (uca_ring_buffer_get_overruns (buffer) == 1);
+}
+
+static gpointer
+delayed_producer (UcaRingBuffer *buffer)
+{
+    guint32 *data;
+
+    g_usleep (G_USEC_PER_SEC / 20);
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 0xBADF00D;
+    uca_ring_buffer_write_advance (buffer);
+    return NULL;
+}
+
+static void
+test_wait_readable (void)
+{
+    UcaRingBuffer *buffer;
+    GThread *thread;
+    guint32 *data;
+
+    buffer = uca_ring_buffer_new (512, 2);
+
+    g_assert (!uca_ring_buffer_wait_readable (buffer, 0));
+    g_assert (!uca_ring_buffer_wait_readable (buffer, G_USEC_PER_SEC / 100));
+
+    thread = g_thread_new (NULL, (GThreadFunc) delayed_producer, buffer);
+    g_assert (uca_ring_buffer_wait_readable (buffer, -1));
+
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (data[0] == 0xBADF00D);
+
+    g_thread_join (thread);
+    g_object_unref (buffer);
+}
+
+static void
+test_borrow (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+    guint32 *borrowed;
+
+    buffer = uca_ring_buffer_new (512, 2);
+
+    for (guint32 i = 0; i < 2; i++) {
+        g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        data[0] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    borrowed = uca_ring_buffer_borrow_read_pointer (buffer);
+    g_assert (borrowed[0] == 0);
+
+    /* The write location wrapped around to the borrowed block */
+    g_assert (!uca_ring_buffer_wait_writable (buffer, 0));
+    g_assert (!uca_ring_buffer_wait_writable (buffer, G_USEC_PER_SEC / 100));
+
+    uca_ring_buffer_release_read_pointer (buffer, borrowed);
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 2;
+    uca_ring_buffer_write_advance (buffer);
+
+    /* Buffer is full, the producer drops the oldest unread block */
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+
+    borrowed = uca_ring_buffer_borrow_read_pointer (buffer);
+    g_assert (borrowed[0] == 2);
+    uca_ring_buffer_release_read_pointer (buffer, borrowed);
+    g_assert (uca_ring_buffer_borrow_read_pointer (buffer) == NULL);
+
+    g_object_unref (buffer);
+}
+
+static void
+test_borrow_newest (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+    guint32 *borrowed;
+    guint64 skipped;
+
+    buffer = uca_ring_buffer_new (512, 4);
+    g_assert (uca_ring_buffer_borrow_newest_pointer (buffer, &skipped) == NULL);
+    g_assert_cmpuint (skipped, ==, 0);
+
+    for (guint32 i = 0; i < 3; i++) {
+        g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        data[0] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    borrowed = uca_ring_buffer_borrow_newest_pointer (buffer, &skipped);
+    g_assert (borrowed[0] == 2);
+    g_assert_cmpuint (skipped, ==, 2);
+    g_assert_cmpuint (uca_ring_buffer_get_sequence (buffer, borrowed), ==, 2);
+
+    /* Skipped blocks are not read anymore */
+    g_assert (!uca_ring_buffer_available (buffer));
+    g_assert (uca_ring_buffer_borrow_read_pointer (buffer) == NULL);
+
+    /* The producer wraps around to the borrowed block and waits for it */
+    for (guint32 i = 3; i < 6; i++) {
+        g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        data[0] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    g_assert (!uca_ring_buffer_wait_writable (buffer, 0));
+    uca_ring_buffer_release_read_pointer (buffer, borrowed);
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+
+    borrowed = uca_ring_buffer_borrow_newest_pointer (buffer, NULL);
+    g_assert (borrowed[0] == 5);
+    uca_ring_buffer_release_read_pointer (buffer, borrowed);
+
+    g_object_unref (buffer);
+}
+
+static void
+test_alloc_flags (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+    const guint alignment = 1 << 20;
+
+    buffer = g_object_new (UCA_TYPE_RING_BUFFER,
+                           "block-size", (guint64) 4096,
+                           "num-blocks", 16,
+                           "alignment", alignment,
+                           "alloc-flags", UCA_RING_BUFFER_ALLOC_HUGE_PAGES |
+                                          UCA_RING_BUFFER_ALLOC_PREFAULT_BACKGROUND,
+                           NULL);
+
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    g_assert (((guintptr) data % alignment) == 0);
+
+    for (guint32 i = 0; i < 16; i++) {
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        data[1023] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    for (guint32 i = 0; i < 16; i++) {
+        data = uca_ring_buffer_get_read_pointer (buffer);
+        g_assert (data[1023] == i);
+    }
+
+    g_assert (uca_ring_buffer_alignment_is_valid (0));
+    g_assert (uca_ring_buffer_alignment_is_valid (alignment));
+    g_assert (!uca_ring_buffer_alignment_is_valid (alignment + 4096));
+    g_assert (!uca_ring_buffer_alignment_is_valid (64));
+
+#if (GLIB_CHECK_VERSION (2, 34, 0))
+    guint current;
+
+    /* Alignments that would trim inside a page are rejected */
+    g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "Alignment of*");
+    g_object_set (buffer, "alignment", alignment + 4096, NULL);
+    g_test_assert_expected_messages ();
+    g_assert (uca_ring_buffer_get_write_pointer (buffer) != NULL);
+    g_object_get (buffer, "alignment", &current, NULL);
+    g_assert_cmpuint (current, ==, alignment);
+#endif
+
+    g_object_unref (buffer);
+}
+
+static void
+test_resize (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+    guint32 *old_data;
+
+    buffer = uca_ring_buffer_new (512, 2);
+    old_data = uca_ring_buffer_get_write_pointer (buffer);
+    old_data[0] = 1;
+    uca_ring_buffer_write_advance (buffer);
+
+    /* Same geometry keeps the memory but empties the buffer */
+    uca_ring_buffer_resize (buffer, 512, 2);
+    g_assert (!uca_ring_buffer_available (buffer));
+    g_assert (uca_ring_buffer_get_write_pointer (buffer) == old_data);
+
+    uca_ring_buffer_resize (buffer, 1024, 4);
+    g_assert (uca_ring_buffer_get_block_size (buffer) == 1024);
+    g_assert (!uca_ring_buffer_available (buffer));
+
+    for (guint32 i = 0; i < 4; i++) {
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        data[255] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    g_assert (uca_ring_buffer_get_num_blocks (buffer) == 4);
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (data[255] == 0);
+
+    g_object_unref (buffer);
+}
+
+static void
+test_reset_borrowed (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+    guint32 *borrowed;
+
+    buffer = uca_ring_buffer_new (512, 2);
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 42;
+    uca_ring_buffer_write_advance (buffer);
+
+    borrowed = uca_ring_buffer_borrow_read_pointer (buffer);
+    g_assert (uca_ring_buffer_contains (buffer, borrowed));
+    g_assert (!uca_ring_buffer_contains (buffer, &data));
+    g_assert_cmpuint (uca_ring_buffer_get_num_borrowed (buffer), ==, 1);
+
+    /* Resetting keeps the borrowed block protected */
+    uca_ring_buffer_reset (buffer);
+    g_assert_cmpuint (uca_ring_buffer_get_num_borrowed (buffer), ==, 1);
+    g_assert (!uca_ring_buffer_wait_writable (buffer, 0));
+
+    /* Its memory cannot be reallocated */
+    g_assert (!uca_ring_buffer_resize (buffer, 1024, 2));
+    g_assert_cmpuint (uca_ring_buffer_get_block_size (buffer), ==, 512);
+    g_assert (borrowed[0] == 42);
+
+    uca_ring_buffer_release_read_pointer (buffer, borrowed);
+    g_assert_cmpuint (uca_ring_buffer_get_num_borrowed (buffer), ==, 0);
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+    g_assert (uca_ring_buffer_resize (buffer, 1024, 2));
+    g_assert_cmpuint (uca_ring_buffer_get_block_size (buffer), ==, 1024);
+
+    g_object_unref (buffer);
+}
+
+static void
+write_frames (UcaRingBuffer *buffer, guint32 n_frames)
+{
+    for (guint32 i = 0; i < n_frames; i++) {
+        guint32 *data;
+
+        if (!uca_ring_buffer_wait_writable (buffer, 0))
+            continue;
+
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        data[0] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+}
+
+static void
+test_policy (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+
+    buffer = uca_ring_buffer_new (512, 2);
+
+    /* Overwrite oldest keeps the two newest frames */
+    write_frames (buffer, 5);
+    g_assert (uca_ring_buffer_get_overruns (buffer) == 3);
+    g_assert (uca_ring_buffer_get_max_fill (buffer) == 2);
+
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (data[0] == 3);
+    g_assert (uca_ring_buffer_get_sequence (buffer, data) == 3);
+
+    /* Drop newest keeps the two oldest frames */
+    uca_ring_buffer_reset (buffer);
+    g_object_set (buffer, "policy", UCA_RING_BUFFER_POLICY_DROP_NEWEST, NULL);
+    write_frames (buffer, 5);
+    g_assert (uca_ring_buffer_get_overruns (buffer) == 3);
+
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (data[0] == 0);
+    g_assert (uca_ring_buffer_get_sequence (buffer, data) == 0);
+
+    /* A slot became free, the next frame is stored with a gap in sequence */
+    write_frames (buffer, 1);
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (uca_ring_buffer_get_sequence (buffer, data) == 1);
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (uca_ring_buffer_get_sequence (buffer, data) == 5);
+
+    /* Block producer refuses to write into a full buffer */
+    uca_ring_buffer_reset (buffer);
+    g_object_set (buffer, "policy", UCA_RING_BUFFER_POLICY_BLOCK_PRODUCER, NULL);
+    write_frames (buffer, 2);
+    g_assert (!uca_ring_buffer_wait_writable (buffer, 0));
+    g_assert (!uca_ring_buffer_wait_writable (buffer, G_USEC_PER_SEC / 100));
+    g_assert (uca_ring_buffer_get_overruns (buffer) == 0);
+
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (data[0] == 0);
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+
+    g_object_unref (buffer);
+}
+
+static void
+test_readers (void)
+{
+    UcaRingBuffer *buffer;
+    UcaRingBufferReader *lossless;
+    UcaRingBufferReader *lossy;
+    guint32 *data;
+
+    buffer = uca_ring_buffer_new (512, 4);
+    g_object_set (buffer, "policy", UCA_RING_BUFFER_POLICY_BLOCK_PRODUCER, NULL);
+
+    lossless = uca_ring_buffer_add_reader (buffer, UCA_RING_BUFFER_READER_LOSSLESS);
+    lossy = uca_ring_buffer_add_reader (buffer, UCA_RING_BUFFER_READER_LOSSY);
+    g_assert (lossless != NULL && lossy != NULL);
+
+    write_frames (buffer, 3);
+    g_assert (uca_ring_buffer_reader_wait_readable (buffer, lossy, 0));
+
+    /* The lossy reader skips to the newest frame */
+    data = uca_ring_buffer_reader_borrow (buffer, lossy);
+    g_assert (data[0] == 2);
+    g_assert (uca_ring_buffer_reader_get_drops (buffer, lossy) == 2);
+    uca_ring_buffer_release_read_pointer (buffer, data);
+    g_assert (uca_ring_buffer_reader_borrow (buffer, lossy) == NULL);
+
+    /* Lossless readers see every frame with the same memory */
+    data = uca_ring_buffer_reader_borrow (buffer, lossless);
+    g_assert (data[0] == 0);
+    g_assert (data == uca_ring_buffer_get_read_pointer (buffer));
+    uca_ring_buffer_release_read_pointer (buffer, data);
+    g_assert (uca_ring_buffer_reader_get_lag (buffer, lossless) == 2);
+
+    /* The producer is held back by the slowest lossless reader */
+    write_frames (buffer, 2);
+    g_assert (!uca_ring_buffer_wait_writable (buffer, 0));
+
+    data = uca_ring_buffer_reader_borrow (buffer, lossless);
+    uca_ring_buffer_release_read_pointer (buffer, data);
+    g_assert (!uca_ring_buffer_wait_writable (buffer, 0));
+
+    g_assert (uca_ring_buffer_get_read_pointer (buffer) != NULL);
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+
+    /* Without the lossless reader, only the default read position counts */
+    write_frames (buffer, 1);
+    g_assert (!uca_ring_buffer_wait_writable (buffer, 0));
+    uca_ring_buffer_remove_reader (buffer, lossless);
+    g_assert (!uca_ring_buffer_wait_writable (buffer, 0));
+    uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+    g_assert (uca_ring_buffer_get_overruns (buffer) == 0);
+
+    uca_ring_buffer_remove_reader (buffer, lossy);
+    g_object_unref (buffer);
+}
+
+static void
+test_metadata (void)
+{
+    UcaRingBuffer *buffer;
+    const UcaRingBufferMetadata *metadata;
+    gpointer data;
+
+    buffer = uca_ring_buffer_new (512, 2);
+
+    for (guint i = 0; i < 3; i++) {
+        UcaRingBufferMetadata *write_metadata;
+
+        g_assert (uca_ring_buffer_wait_writable (buffer, 0));
+        write_metadata = uca_ring_buffer_get_write_metadata (buffer);
+        write_metadata->timestamp = 1000 + i;
+        write_metadata->roi_width = 512;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    metadata = uca_ring_buffer_get_metadata (buffer, 0);
+    g_assert (metadata->sequence == 1);
+    g_assert (metadata->timestamp == 1001);
+    g_assert (metadata->roi_width == 512);
+
+    data = uca_ring_buffer_borrow_read_pointer (buffer);
+    g_assert (uca_ring_buffer_get_pointer_metadata (buffer, data) == metadata);
+    uca_ring_buffer_release_read_pointer (buffer, data);
+
+    metadata = uca_ring_buffer_get_metadata (buffer, 0);
+    g_assert (metadata->sequence == 2);
+    g_assert (metadata->timestamp == 1002);
+
+    g_object_unref (buffer);
 }
 
 int
@@ -98,7 +562,18 @@ main (int argc, char *argv[])
     g_test_add_func ("/ringbuffer/new/constructor", test_new_constructor);
     g_test_add_func ("/ringbuffer/new/func", test_new_func);
     g_test_add_func ("/ringbuffer/functionality ", test_ring);
+    g_test_add_func ("/ringbuffer/proceed", test_proceed);
+    g_test_add_func ("/ringbuffer/stage", test_stage);
     g_test_add_func ("/ringbuffer/overwrite ", test_overwrite);
+    g_test_add_func ("/ringbuffer/wait-readable", test_wait_readable);
+    g_test_add_func ("/ringbuffer/borrow", test_borrow);
+    g_test_add_func ("/ringbuffer/borrow-newest", test_borrow_newest);
+    g_test_add_func ("/ringbuffer/alloc-flags", test_alloc_flags);
+    g_test_add_func ("/ringbuffer/resize", test_resize);
+    g_test_add_func ("/ringbuffer/reset-borrowed", test_reset_borrowed);
+    g_test_add_func ("/ringbuffer/policy", test_policy);
+    g_test_add_func ("/ringbuffer/readers", test_readers);
+    g_test_add_func ("/ringbuffer/metadata", test_metadata);
 
     return g_test_run ();
 }